@@ -0,0 +1,89 @@
+#include "io/cldera_pnetcdf.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <mpi.h>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Tile the ipcc mask (on ne4pg2) to grids of increasing size, and read it
+// back with a cyclic decomposition (every column is a separate run), which
+// is the worst case for the reads of masks and reference data in the stats,
+// and report the read bandwidth. Run with different numbers of ranks,
+// e.g.: mpiexec -n 64 ./pnetcdf_read_benchmark
+
+void run_benchmark (const ekat::Comm& comm)
+{
+  using namespace cldera::io::pnetcdf;
+
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  auto mask_file = open_file (CLDERA_DATA_DIR "/ipcc_mask_ne4pg2.nc",comm,IOMode::Read);
+  const int nmask = mask_file->dims.at("ncol")->len;
+  std::vector<int> mask(nmask);
+  read_var (*mask_file,"mask",mask.data());
+  close_file (*mask_file);
+
+  for (const int ntiles : {1, 64, 512}) {
+    const int ngcols = ntiles*nmask;
+    auto get_cols = [&](const bool cyclic) {
+      std::vector<int> cols;
+      for (int gid=0; gid<ngcols; ++gid) {
+        const int owner = cyclic ? gid % size
+                                 : static_cast<long long>(gid)*size/ngcols;
+        if (owner==rank) {
+          cols.push_back(gid);
+        }
+      }
+      return cols;
+    };
+
+    const std::string fname = "read_bw_tiles" + std::to_string(ntiles) +
+                              "_np" + std::to_string(size) + ".nc";
+    auto block_cols = get_cols(false);
+    std::vector<int> data(block_cols.size());
+    for (size_t i=0; i<block_cols.size(); ++i) {
+      data[i] = mask[block_cols[i] % nmask];
+    }
+    auto file = open_file (fname,comm,IOMode::Write);
+    add_dim (*file,"ncol",block_cols.size(),true);
+    add_var (*file,"mask","int",{"ncol"},false);
+    enddef (*file);
+    add_decomp (*file,"ncol",block_cols);
+    write_var (*file,"mask",data.data());
+    close_file (*file);
+
+    auto cyclic_cols = get_cols(true);
+    std::vector<int> read_data(cyclic_cols.size());
+    comm.barrier();
+    const double t0 = MPI_Wtime();
+    file = open_file (fname,comm,IOMode::Read);
+    add_decomp (*file,"ncol",cyclic_cols);
+    read_var (*file,"mask",read_data.data());
+    close_file (*file);
+    comm.barrier();
+    const double elapsed = MPI_Wtime() - t0;
+
+    if (comm.am_i_root()) {
+      const double mb = double(sizeof(int))*ngcols / (1024*1024);
+      std::cout << " read bandwidth (ncol=" << std::setw(7) << ngcols
+                << ", np=" << size << "): "
+                << std::setprecision(4) << mb/elapsed << " MB/s\n";
+    }
+  }
+}
+
+int main (int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  {
+    ekat::Comm comm(MPI_COMM_WORLD);
+    run_benchmark(comm);
+  }
+  MPI_Finalize();
+  return 0;
+}
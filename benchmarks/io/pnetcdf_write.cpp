@@ -0,0 +1,83 @@
+#include "io/cldera_pnetcdf.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <mpi.h>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Write a decomposed (ncol,lev) variable of roughly the size of an ne30
+// 3d field, with a block decomposition (one contiguous run of columns per
+// rank) and a cyclic one (every column is a separate run), and report the
+// write bandwidth. Run with different numbers of ranks to see how it scales,
+// e.g.: mpiexec -n 64 ./pnetcdf_write_benchmark
+
+void run_benchmark (const ekat::Comm& comm)
+{
+  using namespace cldera::io::pnetcdf;
+
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  constexpr int ngcols = 48602;
+  constexpr int nlevs  = 72;
+  constexpr int nsteps = 3;
+
+  for (const bool cyclic : {false, true}) {
+    std::vector<int> my_cols;
+    for (int gid=0; gid<ngcols; ++gid) {
+      const int owner = cyclic ? gid % size
+                               : static_cast<long long>(gid)*size/ngcols;
+      if (owner==rank) {
+        my_cols.push_back(gid);
+      }
+    }
+    const int ncols = my_cols.size();
+
+    const std::string decomp_name = cyclic ? "cyclic" : "block";
+    const std::string fname = "write_bw_" + decomp_name + "_np" + std::to_string(size) + ".nc";
+    auto file = open_file (fname,comm,IOMode::Write);
+    add_dim (*file,"ncol",ncols,true);
+    add_dim (*file,"lev",nlevs);
+    add_var (*file,"T","double",{"ncol","lev"},true);
+    enddef (*file);
+    add_decomp (*file,"ncol",my_cols);
+
+    std::vector<double> data(ncols*nlevs);
+    double elapsed = 0;
+    for (int step=0; step<nsteps; ++step) {
+      for (int i=0; i<ncols; ++i) {
+        for (int k=0; k<nlevs; ++k) {
+          data[i*nlevs+k] = step*ngcols*nlevs + my_cols[i]*nlevs + k;
+        }
+      }
+      comm.barrier();
+      const double t0 = MPI_Wtime();
+      write_var (*file,"T",data.data());
+      comm.barrier();
+      elapsed += MPI_Wtime() - t0;
+    }
+    close_file (*file);
+
+    if (comm.am_i_root()) {
+      const double mb = double(sizeof(double))*ngcols*nlevs*nsteps / (1024*1024);
+      std::cout << " write bandwidth (" << std::setw(6) << decomp_name
+                << " decomp, np=" << size << "): "
+                << std::setprecision(4) << mb/elapsed << " MB/s\n";
+    }
+  }
+}
+
+int main (int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  {
+    ekat::Comm comm(MPI_COMM_WORLD);
+    run_benchmark(comm);
+  }
+  MPI_Finalize();
+  return 0;
+}
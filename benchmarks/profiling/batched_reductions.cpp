@@ -0,0 +1,177 @@
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/cldera_reduction_batch.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+#include <ekat/ekat_session.hpp>
+
+#include <mpi.h>
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+// Compare the time spent in the global reductions of a typical set of stats
+// when doing one reduction per stat, one batched reduction per step, and
+// one batched non-blocking reduction per step (completed at the next step).
+// Run with different numbers of ranks, e.g.: mpiexec -n 64 ./batched_reductions_benchmark
+
+void run_benchmark (const ekat::Comm& comm)
+{
+  using namespace cldera;
+
+  register_stats();
+
+  const int rank = comm.rank();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Local part of a 3d field, split in chunks of 16 columns, like EAM
+  // does with physics chunks
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  constexpr int nparts = 100;
+  constexpr int ncols = nparts*pcols;
+  constexpr int nsteps = 100;
+
+  Field f   ("f",   {nlevs,ncols}, {"lev","ncol"}, nparts, 1, DataAccess::Copy);
+  Field lat ("lat", {ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  Field area("area",{ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  for (int i = 0; i < nparts; ++i) {
+    f.set_part_extent(i, pcols);
+    lat.set_part_extent(i, pcols);
+    area.set_part_extent(i, pcols);
+  }
+  f.commit();
+  lat.commit();
+  area.commit();
+
+  std::vector<Real> fdata(pcols*nlevs), lat_data(pcols), area_data(pcols);
+  for (int i = 0; i < nparts; ++i) {
+    std::iota(fdata.begin(),fdata.end(),rank*nlevs*ncols + i*nlevs*pcols);
+    for (int icol=0; icol<pcols; ++icol) {
+      lat_data[icol] = (icol % 2)==0 ? -0.5 : 0.5;
+      area_data[icol] = 1 + icol;
+    }
+    f.copy_part_data(i, fdata.data());
+    lat.copy_part_data(i, lat_data.data());
+    area.copy_part_data(i, area_data.data());
+  }
+
+  // Create identical sets of stats, one for each approach
+  auto create_stats = [&] () {
+    auto& factory = StatFactory::instance();
+    std::vector<std::shared_ptr<FieldStat>> stats;
+    for (std::string type : {"global_max", "global_min", "global_sum", "global_avg",
+                             "max_along_columns", "min_along_columns",
+                             "sum_along_columns", "avg_along_columns"}) {
+      ekat::ParameterList pl(type);
+      stats.push_back(factory.create(type,comm,pl));
+    }
+    ekat::ParameterList zm_pl("zonal_mean");
+    zm_pl.set<std::vector<Real>>("Latitude Bounds", {0.0, 1.0});
+    stats.push_back(factory.create("zonal_mean",comm,zm_pl));
+
+    ekat::ParameterList pipe_pl ("pipe");
+    pipe_pl.sublist("outer").set<std::string>("type","global_max");
+    pipe_pl.sublist("inner").set<std::string>("type","vertical_contraction");
+    pipe_pl.sublist("inner").set<std::vector<int>>("level_bounds",{0,nlevs-1});
+    stats.push_back(factory.create("pipe",comm,pipe_pl));
+
+    for (auto& s : stats) {
+      s->set_field(f);
+      if (s->get_aux_fields_names().size()>0) {
+        s->set_aux_fields(lat,area);
+      }
+      s->create_stat_field();
+    }
+    return stats;
+  };
+
+  auto single_stats = create_stats();
+  auto batch_stats  = create_stats();
+  auto async_stats  = create_stats();
+
+  ReductionBatch batch;
+
+  using clock = std::chrono::high_resolution_clock;
+  using secs  = std::chrono::duration<double>;
+
+  // Warm up (creates scratch buffers)
+  for (auto& s : single_stats) {
+    s->compute(time);
+  }
+
+  comm.barrier();
+  auto start = clock::now();
+  for (int step=0; step<nsteps; ++step) {
+    for (auto& s : single_stats) {
+      s->compute(time);
+    }
+  }
+  secs single_time = clock::now() - start;
+
+  comm.barrier();
+  start = clock::now();
+  for (int step=0; step<nsteps; ++step) {
+    for (auto& s : batch_stats) {
+      s->compute_local(time,batch);
+    }
+    batch.reduce(comm);
+    for (auto& s : batch_stats) {
+      s->finalize_compute();
+    }
+  }
+  secs batch_time = clock::now() - start;
+
+  // For async reductions, measure only the time spent in this function.
+  // In a real run, MPI can progress the reductions while the host
+  // app is busy with its time step.
+  comm.barrier();
+  secs async_time (0);
+  for (int step=0; step<nsteps; ++step) {
+    start = clock::now();
+    batch.wait();
+    if (step>0) {
+      for (auto& s : async_stats) {
+        s->finalize_compute();
+      }
+    }
+    for (auto& s : async_stats) {
+      s->compute_local(time,batch);
+    }
+    batch.post(comm);
+    async_time += clock::now() - start;
+  }
+  batch.wait();
+  for (auto& s : async_stats) {
+    s->finalize_compute();
+  }
+
+  double times[3] = {single_time.count(), batch_time.count(), async_time.count()};
+  comm.all_reduce(times,3,MPI_MAX);
+  if (comm.am_i_root()) {
+    std::cout << " Time for " << nsteps << " steps of " << single_stats.size() << " stats"
+              << " on " << comm.size() << " ranks:\n"
+              << "   - one reduction per stat: " << times[0] << "s\n"
+              << "   - batched reductions    : " << times[1] << "s\n"
+              << "   - async reductions      : " << times[2] << "s\n";
+  }
+}
+
+int main (int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  {
+    ekat::Comm comm(MPI_COMM_WORLD);
+    ekat::initialize_ekat_session(argc,argv,comm.am_i_root());
+
+    run_benchmark(comm);
+
+    ekat::finalize_ekat_session();
+  }
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,177 @@
+#include "profiling/stats/cldera_fused_field_stats.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/cldera_reduction_batch.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+#include <ekat/ekat_session.hpp>
+
+#include <mpi.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+
+// Compare the time needed to compute a set of stats on the same field with
+// one traversal per stat and with a single fused traversal of the field.
+// E.g.: ./fused_stats_benchmark --kokkos-num-threads=4
+
+void run_benchmark (const ekat::Comm& comm)
+{
+  using namespace cldera;
+
+  register_stats();
+
+  const int rank = comm.rank();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Field dimensions: parts of 16 columns, like EAM physics chunks
+  constexpr int ncols = 2048;
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  constexpr int nparts = ncols / pcols;
+  constexpr int nregions = 7;
+  constexpr int nsteps = 20;
+
+  auto create_field = [&](const std::string& name, const std::vector<int>& dims,
+                          const std::vector<std::string>& names) {
+    Field f(name,dims,names,nparts,0,DataAccess::Copy);
+    for (int p=0; p<nparts; ++p) {
+      f.set_part_extent(p,pcols);
+    }
+    f.commit();
+    return f;
+  };
+
+  Field f    = create_field("f",{ncols,nlevs},{"ncol","lev"});
+  Field lat  = create_field("lat",{ncols},{"ncol"});
+  Field area = create_field("area",{ncols},{"ncol"});
+  for (int p=0; p<nparts; ++p) {
+    const int n = f.part_layout(p).size();
+    auto data = f.part_data_nonconst<Real>(p);
+    for (int i=0; i<n; ++i) {
+      data[i] = std::sin(p*n + i + rank) * 1000 / 7;
+    }
+    auto l = lat.part_data_nonconst<Real>(p);
+    auto a = area.part_data_nonconst<Real>(p);
+    for (int i=0; i<pcols; ++i) {
+      l[i] = (p*pcols+i) % 89;
+      a[i] = 1 + (p*pcols+i) % 3;
+    }
+  }
+
+  Field mask    ("mask",    FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  Field col_gids("col_gids",FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  mask.commit();
+  col_gids.commit();
+  for (int icol=0; icol<ncols; ++icol) {
+    mask.data_nonconst<int>()[icol] = icol % nregions;
+    col_gids.data_nonconst<int>()[icol] = rank*ncols + icol + 1;
+  }
+
+  // Create the same (fusable) stats twice: one set is computed one stat
+  // at a time, the other with a single traversal of the field
+  auto create_stats = [&]() {
+    auto& factory = StatFactory::instance();
+    std::vector<std::shared_ptr<FieldStat>> stats;
+    for (std::string type : {"global_max", "global_min", "global_sum", "global_avg",
+                             "max_along_columns", "min_along_columns",
+                             "sum_along_columns", "avg_along_columns"}) {
+      ekat::ParameterList pl(type);
+      stats.push_back(factory.create(type,comm,pl));
+    }
+    ekat::ParameterList mi_pl("masked_integral");
+    mi_pl.set<std::string>("mask_field","mask");
+    mi_pl.set("average",false);
+    stats.push_back(factory.create("masked_integral",comm,mi_pl));
+    ekat::ParameterList wmi_pl("weighted_masked_integral");
+    wmi_pl.set<std::string>("mask_field","mask");
+    wmi_pl.set<std::string>("weight_field","area");
+    wmi_pl.set("average",false);
+    stats.push_back(factory.create("masked_integral",comm,wmi_pl));
+
+    std::map<std::string,Field> aux = {
+      {"lat",lat}, {"area",area}, {"mask",mask}, {"col_gids",col_gids}
+    };
+    for (auto& s : stats) {
+      s->set_field(f);
+      s->set_aux_fields(aux);
+      s->create_stat_field();
+    }
+    return stats;
+  };
+
+  auto single_stats = create_stats();
+  auto fused_stats  = create_stats();
+
+  FusedFieldStats fused(f);
+  for (auto& s : fused_stats) {
+    fused.add_stat(s);
+  }
+
+  ReductionBatch batch;
+
+  using clock = std::chrono::high_resolution_clock;
+  using secs  = std::chrono::duration<double>;
+
+  // Warm up (creates scratch buffers)
+  for (auto& s : single_stats) {
+    s->compute(time);
+  }
+  fused.compute_local(time,batch);
+  batch.reduce(comm);
+  for (auto& s : fused.get_stats()) {
+    s->finalize_compute();
+  }
+
+  comm.barrier();
+  auto start = clock::now();
+  for (int step=0; step<nsteps; ++step) {
+    for (auto& s : single_stats) {
+      s->compute_local(time,batch);
+    }
+    batch.reduce(comm);
+    for (auto& s : single_stats) {
+      s->finalize_compute();
+    }
+  }
+  secs single_time = clock::now() - start;
+
+  comm.barrier();
+  start = clock::now();
+  for (int step=0; step<nsteps; ++step) {
+    fused.compute_local(time,batch);
+    batch.reduce(comm);
+    for (auto& s : fused.get_stats()) {
+      s->finalize_compute();
+    }
+  }
+  secs fused_time = clock::now() - start;
+
+  double times[2] = {single_time.count(), fused_time.count()};
+  comm.all_reduce(times,2,MPI_MAX);
+  if (comm.am_i_root()) {
+    std::cout << " Time for " << nsteps << " steps of " << fused.num_stats() << " stats"
+              << " on a " << ncols << "x" << nlevs << " field:\n"
+              << "   - one traversal per stat: " << times[0] << "s\n"
+              << "   - fused traversal       : " << times[1] << "s\n";
+  }
+}
+
+int main (int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  {
+    ekat::Comm comm(MPI_COMM_WORLD);
+    ekat::initialize_ekat_session(argc,argv,comm.am_i_root());
+
+    run_benchmark(comm);
+
+    ekat::finalize_ekat_session();
+  }
+  MPI_Finalize();
+  return 0;
+}
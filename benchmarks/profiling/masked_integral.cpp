@@ -0,0 +1,151 @@
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "io/cldera_pnetcdf.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+#include <ekat/ekat_session.hpp>
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <numeric>
+
+// Compare the time of a masked integral on a ne120pg2 sized field, using the
+// region-sorted index of the stat vs looking up the region of each column in
+// a map. The mask is the ipcc mask on ne4pg2, tiled to the ne120pg2 size.
+// Run with different numbers of ranks, e.g.: mpiexec -n 8 ./masked_integral_benchmark
+
+void run_benchmark (const ekat::Comm& comm)
+{
+  using namespace cldera;
+
+  register_stats ();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Read the whole ne4pg2 mask on all ranks
+  std::string mask_filename = CLDERA_DATA_DIR "/ipcc_mask_ne4pg2.nc";
+  auto mask_file = io::pnetcdf::open_file(mask_filename,comm,io::pnetcdf::IOMode::Read);
+  const int ne4_ncols = mask_file->dims.at("ncol")->len;
+  std::vector<int> all_cols(ne4_ncols);
+  std::iota(all_cols.begin(),all_cols.end(),0);
+  io::pnetcdf::add_decomp(*mask_file,"ncol",all_cols);
+  std::vector<int> ne4_mask(ne4_ncols);
+  io::pnetcdf::read_var(*mask_file,"mask",ne4_mask.data());
+  io::pnetcdf::close_file(*mask_file);
+
+  // Tile the mask to ne120pg2 sizes, distributed over the ranks in
+  // parts of 16 columns, like EAM physics chunks
+  constexpr int ne120_ncols = 6*120*120*4;
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  constexpr int nsteps = 20;
+  const int my_ncols = (ne120_ncols / comm.size() / pcols) * pcols;
+  const int nparts = my_ncols / pcols;
+
+  Field mask    ("mask",    FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  Field col_gids("col_gids",FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  mask.commit();
+  col_gids.commit();
+  for (int icol=0; icol<my_ncols; ++icol) {
+    const int gid = comm.rank()*my_ncols + icol;
+    col_gids.data_nonconst<int>()[icol] = gid + 1;
+    mask.data_nonconst<int>()[icol] = ne4_mask[gid % ne4_ncols];
+  }
+
+  Field f("f",{my_ncols,nlevs},{"ncol","lev"},nparts,0,DataAccess::Copy);
+  for (int p=0; p<nparts; ++p) {
+    f.set_part_extent(p,pcols);
+  }
+  f.commit();
+  for (int p=0; p<nparts; ++p) {
+    auto v = f.part_nd_view_nonconst<Real,2>(p);
+    for (int i=0; i<pcols; ++i) {
+      for (int k=0; k<nlevs; ++k) {
+        v(i,k) = (p*pcols + i + k) % 7;
+      }
+    }
+  }
+
+  ekat::ParameterList pl("masked_integral");
+  pl.set<std::string>("mask_field","mask");
+  pl.set("average",false);
+  auto stat = StatFactory::instance().create("masked_integral",comm,pl);
+  stat->set_field(f);
+  stat->set_aux_fields({{"mask",mask},{"col_gids",col_gids}});
+  stat->create_stat_field();
+
+  // Reference: look up the region of each column in a map, one column at a time
+  std::map<int,int> mask_val_to_idx;
+  for (auto v : ne4_mask) {
+    mask_val_to_idx[v] = 0;
+  }
+  int num_regions = 0;
+  for (auto& it : mask_val_to_idx) {
+    it.second = num_regions++;
+  }
+  std::vector<Real> ref(num_regions*nlevs);
+  auto compute_ref = [&]() {
+    std::fill(ref.begin(),ref.end(),0);
+    for (int p=0; p<nparts; ++p) {
+      auto v = f.part_nd_view<Real,2>(p);
+      for (int i=0; i<pcols; ++i) {
+        const int r = mask_val_to_idx.at(mask.data<int>()[p*pcols+i]);
+        for (int k=0; k<nlevs; ++k) {
+          ref[r*nlevs+k] += v(i,k);
+        }
+      }
+    }
+    comm.all_reduce(ref.data(),ref.size(),MPI_SUM);
+  };
+
+  using clock = std::chrono::high_resolution_clock;
+  using secs  = std::chrono::duration<double>;
+
+  // Warm up (creates scratch buffers)
+  compute_ref();
+  stat->compute(time);
+
+  comm.barrier();
+  auto start = clock::now();
+  for (int step=0; step<nsteps; ++step) {
+    compute_ref();
+  }
+  secs ref_time = clock::now() - start;
+
+  comm.barrier();
+  start = clock::now();
+  for (int step=0; step<nsteps; ++step) {
+    stat->compute(time);
+  }
+  secs stat_time = clock::now() - start;
+
+  double times[2] = {ref_time.count(), stat_time.count()};
+  comm.all_reduce(times,2,MPI_MAX);
+  if (comm.am_i_root()) {
+    std::cout << " Time for " << nsteps << " masked integrals of a " << ne120_ncols << "x" << nlevs
+              << " field over " << num_regions << " regions, on " << comm.size() << " ranks:\n"
+              << "   - per-column map lookup: " << times[0] << "s\n"
+              << "   - region-sorted index  : " << times[1] << "s\n";
+  }
+}
+
+int main (int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  {
+    ekat::Comm comm(MPI_COMM_WORLD);
+    ekat::initialize_ekat_session(argc,argv,comm.am_i_root());
+
+    run_benchmark(comm);
+
+    ekat::finalize_ekat_session();
+  }
+  MPI_Finalize();
+  return 0;
+}
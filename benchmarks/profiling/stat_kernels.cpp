@@ -0,0 +1,165 @@
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+#include <ekat/ekat_session.hpp>
+
+#include <mpi.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+
+// Strong scaling of the threaded stat kernels: time each stat on a ne30pg2
+// sized field. Run on one rank with different numbers of threads, e.g.:
+//   ./stat_kernels_benchmark --kokkos-num-threads=1
+//   ./stat_kernels_benchmark --kokkos-num-threads=8
+
+void run_benchmark (const ekat::Comm& comm)
+{
+  using namespace cldera;
+
+  register_stats();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  const int nthreads = HostExecSpace().concurrency();
+
+  // Sizes of a ne30pg2 grid, with 72 levels, split in chunks
+  // of 16 columns, like EAM does with physics chunks
+  constexpr int ncols = 21600;
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  constexpr int nparts = ncols / pcols;
+  constexpr int nregions = 10;
+  constexpr int nsteps = 20;
+
+  Field f   ("f",   {ncols,nlevs}, {"ncol","lev"}, nparts, 0, DataAccess::Copy);
+  Field lat ("lat", {ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  Field lon ("lon", {ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  Field area("area",{ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  for (int p=0; p<nparts; ++p) {
+    f.set_part_extent(p, pcols);
+    lat.set_part_extent(p, pcols);
+    lon.set_part_extent(p, pcols);
+    area.set_part_extent(p, pcols);
+  }
+  f.commit();
+  lat.commit();
+  lon.commit();
+  area.commit();
+
+  // Masked integral wants single-part mask and col gids
+  Field mask    ("mask",    FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  Field col_gids("col_gids",FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  mask.commit();
+  col_gids.commit();
+
+  std::vector<Real> fdata(ncols*nlevs), lat_data(ncols), lon_data(ncols), area_data(ncols);
+  std::mt19937_64 engine(1234);
+  std::uniform_real_distribution<Real> pdf(0,1);
+  for (auto& v : fdata) {
+    v = 100*pdf(engine);
+  }
+  for (int icol=0; icol<ncols; ++icol) {
+    lat_data[icol]  = -90 + 180*pdf(engine);
+    lon_data[icol]  = 360*pdf(engine);
+    area_data[icol] = 1 + pdf(engine);
+    mask.data_nonconst<int>()[icol] = icol % nregions;
+    col_gids.data_nonconst<int>()[icol] = icol+1;
+  }
+  for (int p=0; p<nparts; ++p) {
+    f.copy_part_data(p, fdata.data()+p*pcols*nlevs);
+    lat.copy_part_data(p, lat_data.data()+p*pcols);
+    lon.copy_part_data(p, lon_data.data()+p*pcols);
+    area.copy_part_data(p, area_data.data()+p*pcols);
+  }
+
+  auto& factory = StatFactory::instance();
+  auto create_stat = [&](const std::string& type, ekat::ParameterList pl) {
+    pl.set<std::string>("type",type);
+    auto stat = factory.create(type,comm,pl);
+    stat->set_field(f);
+    std::map<std::string,Field> aux = {
+      {"lat",lat}, {"lon",lon}, {"area",area}, {"mask",mask}, {"col_gids",col_gids}
+    };
+    stat->set_aux_fields(aux);
+    stat->create_stat_field();
+    return stat;
+  };
+
+  const Bounds<Real> lat_bounds (-30,30);
+  const Bounds<Real> lon_bounds (0,180);
+
+  std::map<std::string,std::shared_ptr<FieldStat>> stats;
+  stats["global_sum"] = create_stat("global_sum",ekat::ParameterList("global_sum"));
+  stats["global_max"] = create_stat("global_max",ekat::ParameterList("global_max"));
+  stats["global_min"] = create_stat("global_min",ekat::ParameterList("global_min"));
+  stats["sum_along_columns"] = create_stat("sum_along_columns",ekat::ParameterList("sum_along_columns"));
+  stats["max_along_columns"] = create_stat("max_along_columns",ekat::ParameterList("max_along_columns"));
+  {
+    ekat::ParameterList pl("zonal_mean");
+    pl.set("Latitude Bounds",lat_bounds.to_vector());
+    stats["zonal_mean"] = create_stat("zonal_mean",pl);
+  }
+  {
+    ekat::ParameterList pl("bounding_box");
+    pl.set("Latitude Bounds",lat_bounds.to_vector());
+    pl.set("Longitude Bounds",lon_bounds.to_vector());
+    stats["bounding_box"] = create_stat("bounding_box",pl);
+  }
+  {
+    ekat::ParameterList pl("vertical_contraction");
+    pl.set<std::vector<int>>("level_bounds",{0,nlevs-1});
+    stats["vertical_contraction"] = create_stat("vertical_contraction",pl);
+  }
+  {
+    ekat::ParameterList pl("masked_integral");
+    pl.set<std::string>("mask_field","mask");
+    pl.set("average",false);
+    stats["masked_integral"] = create_stat("masked_integral",pl);
+  }
+
+  using clock = std::chrono::high_resolution_clock;
+  using secs  = std::chrono::duration<double>;
+
+  if (comm.am_i_root()) {
+    std::cout << " Time per step on " << ncols << "x" << nlevs << " field,"
+              << " with " << nthreads << " thread(s):\n";
+  }
+  for (auto& it : stats) {
+    // Warm up (creates scratch buffers)
+    it.second->compute(time);
+
+    comm.barrier();
+    auto start = clock::now();
+    for (int step=0; step<nsteps; ++step) {
+      it.second->compute(time);
+    }
+    secs elapsed = clock::now() - start;
+
+    double t = elapsed.count()/nsteps;
+    comm.all_reduce(&t,1,MPI_MAX);
+    if (comm.am_i_root()) {
+      std::cout << "   - " << it.first << ": " << t << "s\n";
+    }
+  }
+}
+
+int main (int argc, char** argv)
+{
+  MPI_Init(&argc,&argv);
+  {
+    ekat::Comm comm(MPI_COMM_WORLD);
+    ekat::initialize_ekat_session(argc,argv,comm.am_i_root());
+
+    run_benchmark(comm);
+
+    ekat::finalize_ekat_session();
+  }
+  MPI_Finalize();
+  return 0;
+}
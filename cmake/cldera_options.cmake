@@ -2,10 +2,13 @@
 
 option (CLDERA_ENABLE_TESTS "Whether to enable CLDERA tests" ON)
 option (CLDERA_ENABLE_PROFILING_TOOL "Whether to build the cldera profiling tool" ON)
+option (CLDERA_ENABLE_BENCHMARKS "Whether to build CLDERA benchmarks (not run by ctest)" OFF)
+option (CLDERA_ENABLE_ALLOC_COUNTER "Whether to count heap allocations (replaces global operator new, for testing)" OFF)
 
 if (CLDERA_ENABLE_TESTS)
   # Cache vars used for testing
   set (CLDERA_TESTS_MAX_RANKS 1 CACHE STRING "Max number of ranks to use in testing")
+  set (CLDERA_TESTS_MAX_THREADS 1 CACHE STRING "Max number of host threads to use in testing")
   set (CLDERA_TESTS_MPI_EXEC_NAME mpiexec CACHE STRING "Command to be used to run MPI executables")
   set (CLDERA_TESTS_MPI_NP_FLAG -n CACHE STRING "Flag to be used to specify number of ranks")
 endif()
@@ -23,5 +23,6 @@ cmake \
   -D CLDERA_PNETCDF_PATH:PATH=${PNETCDF_ROOT} \
   -D CLDERA_ENABLE_TESTS:BOOL=ON              \
   -D CLDERA_ENABLE_PROFILING_TOOL:BOOL=ON     \
+  -D CLDERA_ENABLE_ALLOC_COUNTER:BOOL=ON      \
   -D CLDERA_TESTS_MAX_RANKS:STRING=4          \
   ${SRC_DIR}
@@ -9,93 +9,42 @@
 
 #include <pnetcdf.h>
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
 namespace cldera {
 namespace io {
 namespace pnetcdf {
 
 int UNLIMITED = NC_UNLIMITED;
 
+// Pack num_records records of a decomposed var in the order of the varn
+// requests: for each run, for each record, the chunks of that run
 template<typename T>
-void pack_1d (const T* input, const int* dims, int idim, int slice, T* output) {
-  EKAT_REQUIRE_MSG (idim==0, "Invalid idim for pack_1d.\n");
-  EKAT_REQUIRE_MSG (slice>=0 && slice<dims[0], "Invalid slice for pack_1d.\n");
-
-  *output = input[slice];
-}
-
-template<typename T>
-void pack_2d (const T* input, const int* dims, int idim, int slice, T* output) {
-  EKAT_REQUIRE_MSG (idim==0 || idim==1, "Invalid idim for pack_2d.\n");
-  EKAT_REQUIRE_MSG (slice>=0 && slice<dims[idim], "Invalid slice for pack_2d.\n");
-
-  std::vector<int> beg(2,0);
-  std::vector<int> end = {dims[0], dims[1]};
-  beg[idim] = slice;
-  end[idim] = slice+1;
-  for (int i=beg[0]; i<end[0]; ++i) {
-    for (int j=beg[1]; j<end[1]; ++j,++output) {
-      *output = input[i*dims[1]+j];
-    }
-  }
-}
-
-template<typename T>
-void pack_3d (const T* input, const int* dims, int idim, int slice, T* output) {
-  EKAT_REQUIRE_MSG (idim==0 || idim==1 || idim==2, "Invalid idim for pack_3d.\n");
-  EKAT_REQUIRE_MSG (slice>=0 && slice<dims[idim], "Invalid slice for pack_3d.\n");
-
-  std::vector<int> beg(3,0);
-  std::vector<int> end = {dims[0], dims[1], dims[2]};
-  beg[idim] = slice;
-  end[idim] = slice+1;
-  for (int i=beg[0]; i<end[0]; ++i) {
-    for (int j=beg[1]; j<end[1]; ++j) {
-      for (int k=beg[2]; k<end[2]; ++k,++output) {
-        *output = input[i*dims[1]*dims[2]+j*dims[2]+k];
+void pack (const IODecomp& decomp, const T* data, const int record_size,
+           const int num_records, T* packed)
+{
+  const auto& chunks = decomp.chunks;
+  for (int r=0; r<decomp.num_runs(); ++r) {
+    for (int t=0; t<num_records; ++t) {
+      const T* record = data + static_cast<long long>(t)*record_size;
+      for (int c=decomp.chunk_offsets[r]; c<decomp.chunk_offsets[r+1]; ++c) {
+        std::memcpy(packed,record+chunks[c].offset,chunks[c].size*sizeof(T));
+        packed += chunks[c].size;
       }
     }
   }
 }
 
+// Inverse of pack, for a single record
 template<typename T>
-void unpack_1d (const T* input, const int* dims, int idim, int slice, T* output) {
-  EKAT_REQUIRE_MSG (idim==0, "Invalid idim for unpack_1d.\n");
-  EKAT_REQUIRE_MSG (slice>=0 && slice<dims[0], "Invalid slice for unpack_1d.\n");
-
-  output[slice] = *input;
-}
-
-template<typename T>
-void unpack_2d (const T* input, const int* dims, int idim, int slice, T* output) {
-  EKAT_REQUIRE_MSG (idim==0 || idim==1, "Invalid idim for unpack_2d.\n");
-  EKAT_REQUIRE_MSG (slice>=0 && slice<dims[idim], "Invalid slice for unpack_2d.\n");
-
-  std::vector<int> beg(2,0);
-  std::vector<int> end = {dims[0], dims[1]};
-  beg[idim] = slice;
-  end[idim] = slice+1;
-  for (int i=beg[0]; i<end[0]; ++i) {
-    for (int j=beg[1]; j<end[1]; ++j,++input) {
-      output[i*dims[1]+j] = *input;
-    }
-  }
-}
-
-template<typename T>
-void unpack_3d (const T* input, const int* dims, int idim, int slice, T* output) {
-  EKAT_REQUIRE_MSG (idim==0 || idim==1 || idim==2, "Invalid idim for unpack_3d.\n");
-  EKAT_REQUIRE_MSG (slice>=0 && slice<dims[idim], "Invalid slice for unpack_3d.\n");
-
-  std::vector<int> beg(3,0);
-  std::vector<int> end = {dims[0], dims[1], dims[2]};
-  beg[idim] = slice;
-  end[idim] = slice+1;
-  for (int i=beg[0]; i<end[0]; ++i) {
-    for (int j=beg[1]; j<end[1]; ++j) {
-      for (int k=beg[2]; k<end[2]; ++k,++input) {
-        output[i*dims[1]*dims[2]+j*dims[2]+k] = *input;
-      }
-    }
+void unpack (const IODecomp& decomp, const T* packed, T* data)
+{
+  for (const auto& c : decomp.chunks) {
+    std::memcpy(data+c.offset,packed,c.size*sizeof(T));
+    packed += c.size;
   }
 }
 
@@ -307,7 +256,19 @@ open_file (const std::string& fname, const ekat::Comm& comm, const IOMode mode)
 
 void close_file (NCFile& file)
 {
-  int ret = ncmpi_close(file.ncid);
+  int ret;
+  if (file.buffer_size>0) {
+    // Complete any pending write, before detaching the buffer
+    wait_all(file);
+    ret = ncmpi_buffer_detach(file.ncid);
+    EKAT_REQUIRE_MSG (ret==NC_NOERR,
+        "Error! Could not detach write buffer from NC file.\n"
+        "   - file name: " + file.name + "\n"
+        "   - err code : " + std::to_string(ret) + "\n");
+    file.buffer_size = 0;
+  }
+
+  ret = ncmpi_close(file.ncid);
 
   EKAT_REQUIRE_MSG (ret==NC_NOERR,
       "Error! Could not close NC file.\n"
@@ -402,9 +363,67 @@ void add_dim (NCFile& file, const std::string& dname, const int len, const bool
   file.dims[dname] = dim;
 }
 
-void add_decomp (      NCFile& file, 
+std::shared_ptr<const DimDecomp>
+make_dim_decomp (const ekat::Comm& comm, const std::vector<int>& entries)
+{
+  auto dd = std::make_shared<DimDecomp>();
+  dd->entries = entries;
+
+  // Count entries, so we can check correctness against the dims
+  // of the files, and, for Read mode, adjust their local length
+  int count = entries.size();
+  comm.all_reduce(&count,&dd->global_count,1,MPI_SUM);
+
+  // Ensure indices are 0-based
+  int min = entries.size()>0 ? *std::min_element(entries.begin(),entries.end())
+                             : std::numeric_limits<int>::max();
+  comm.all_reduce(&min,1,MPI_MIN);
+  EKAT_REQUIRE_MSG (min==0,
+      "Error! Invalid index base for dim decomp enries.\n"
+      "   - min entry  : " + std::to_string(min) + "\n");
+
+  // Sort local entries by global index, and split them in runs
+  // of consecutive global indices
+  const int nentries = entries.size();
+  auto& perm = dd->perm;
+  perm.resize(nentries);
+  std::iota(perm.begin(),perm.end(),0);
+  std::sort(perm.begin(),perm.end(),
+            [&](const int i, const int j) { return entries[i]<entries[j]; });
+  auto& runs = dd->run_offsets;
+  runs.push_back(0);
+  for (int k=1; k<nentries; ++k) {
+    if (entries[perm[k]]!=entries[perm[k-1]]+1) {
+      runs.push_back(k);
+    }
+  }
+  if (nentries>0) {
+    runs.push_back(nentries);
+  }
+  return dd;
+}
+
+void add_decomp (      NCFile& file,
                  const std::string& dim_name,
                  const std::vector<int>& entries)
+{
+  auto dim = file.dims.find(dim_name);
+  if (dim!=file.dims.end() and dim->second->decomp_set) {
+    // Skip the collectives, and just check the entries
+    EKAT_REQUIRE_MSG (dim->second->entries==entries,
+        "Error! Decomposition was already added for this dimension, with different entries.\n"
+        "   - file name : " + file.name + "\n"
+        "   - dim name  : " + dim_name + "\n"
+        "   - decomp entries: [" + ekat::join(dim->second->entries," ") + "]\n"
+        "   - input entries: [" + ekat::join(entries," ") + "]\n");
+    return;
+  }
+  add_dim_decomp (file,dim_name,make_dim_decomp(file.comm,entries));
+}
+
+void add_dim_decomp (      NCFile& file,
+                     const std::string& dim_name,
+                     const std::shared_ptr<const DimDecomp>& dim_decomp)
 {
   // Sanity checks
   EKAT_REQUIRE_MSG (file.enddef,
@@ -419,6 +438,7 @@ void add_decomp (      NCFile& file,
       "   - decomp dim : " + dim_name + "\n");
   auto dim = file.dims.at(dim_name);
 
+  const auto& entries = dim_decomp->entries;
   EKAT_REQUIRE_MSG (not dim->decomp_set || dim->entries==entries,
       "Error! Decomposition was already added for this dimension, with different entries.\n"
       "   - file name : " + file.name + "\n"
@@ -431,13 +451,8 @@ void add_decomp (      NCFile& file,
     return;
   }
 
-  // Count entries, so we can check correctness, and, for Read mode,
-  // we can adjust the local length of dimensions
-  const auto& comm = file.comm;
-  int count = entries.size();
-  int gcount;
-  comm.all_reduce(&count,&gcount,1,MPI_SUM);
-
+  const int count = entries.size();
+  const int gcount = dim_decomp->global_count;
   EKAT_REQUIRE_MSG (gcount==dim->glen,
       "Error! Invalid global count for decomposition.\n"
       "   - file name    : " + file.name + "\n"
@@ -470,20 +485,11 @@ void add_decomp (      NCFile& file,
         "Error! Invalid local count for decomposition.\n"
         "   - file name    : " + file.name + "\n"
         "   - decomp dim   : " + dim_name + "\n"
-        "   - mpi rank     : " + std::to_string(comm.rank()) + "\n"
+        "   - mpi rank     : " + std::to_string(file.comm.rank()) + "\n"
         "   - local count  : " + std::to_string(count) + "\n"
         "   - dim length   : " + std::to_string(dim->len) + "\n");
   }
 
-  // Ensure indices are 1-based (for netcdf)
-  int min = *std::min_element(entries.begin(),entries.end());
-  comm.all_reduce(&min,1,MPI_MIN);
-  EKAT_REQUIRE_MSG (min==0,
-      "Error! Invalid index base for dim decomp enries.\n"
-      "   - file name  : " + file.name + "\n"
-      "   - decomp dim : " + dim_name + "\n"
-      "   - min entry  : " + std::to_string(min) + "\n");
-
   dim->decomp_set = true;
   dim->entries = entries;
 
@@ -527,10 +533,72 @@ void add_decomp (      NCFile& file,
         decomp->layout = dims;
         decomp->dim = file.dims.at(dim_name);
         decomp->dim_idx = idecomp;
-        decomp->hyperslab_size = var->size / decomp->dim->len;
 
-        // Make buf large enough for any data type
-        decomp->buf.resize(sizeof(double)*decomp->hyperslab_size*sizeof(int));
+        decomp->outer_size = decomp->inner_size = 1;
+        for (int i=0; i<rank; ++i) {
+          if (dims[i]->name=="time") {
+            continue;
+          }
+          if (i<idecomp) {
+            decomp->outer_size *= dims[i]->len;
+          } else if (i>idecomp) {
+            decomp->inner_size *= dims[i]->len;
+          }
+        }
+
+        decomp->dim_decomp = dim_decomp;
+        const auto& gids = dim_decomp->entries;
+        const auto& perm = dim_decomp->perm;
+        const auto& runs = dim_decomp->run_offsets;
+        const int nruns = decomp->num_runs();
+
+        // Copy plan of the packing of one record. Chunks of a run are merged
+        // if they are adjacent in the local data too. The data is already in
+        // run order if the chunks, one after the other, span the whole record.
+        const long long len   = decomp->dim->len;
+        const long long inner = decomp->inner_size;
+        auto& chunks = decomp->chunks;
+        auto& chunk_offsets = decomp->chunk_offsets;
+        chunk_offsets.push_back(0);
+        for (int r=0; r<nruns; ++r) {
+          for (long long o=0; o<decomp->outer_size and inner>0; ++o) {
+            for (int k=runs[r]; k<runs[r+1]; ++k) {
+              const long long offset = (o*len + perm[k])*inner;
+              if (static_cast<int>(chunks.size())>chunk_offsets.back() and
+                  chunks.back().offset+chunks.back().size==offset) {
+                chunks.back().size += inner;
+              } else {
+                chunks.push_back({offset,inner});
+              }
+            }
+          }
+          chunk_offsets.push_back(chunks.size());
+        }
+        long long pos = 0;
+        decomp->in_order = true;
+        for (const auto& c : chunks) {
+          decomp->in_order &= c.offset==pos;
+          pos += c.size;
+        }
+
+        decomp->starts.resize(nruns*rank);
+        decomp->counts.resize(nruns*rank);
+        for (int r=0; r<nruns; ++r) {
+          auto start = decomp->starts.data() + r*rank;
+          auto count = decomp->counts.data() + r*rank;
+          for (int i=0; i<rank; ++i) {
+            start[i] = 0;
+            count[i] = dims[i]->len;
+            if (dims[i]->name=="time") {
+              count[i] = 1;
+            } else if (i==idecomp) {
+              start[i] = gids[perm[runs[r]]];
+              count[i] = runs[r+1] - runs[r];
+            }
+          }
+          decomp->starts_ptrs.push_back(start);
+          decomp->counts_ptrs.push_back(count);
+        }
 
         file.decomps[name] = decomp;
       }
@@ -649,6 +717,7 @@ void add_var (      NCFile& file,
 
 void NCVar::compute_extents () {
   size = 1;
+  dimlens.clear();
   dimlens.reserve(has_time() ? dims.size()-1 : dims.size());
   for (const auto& dim : dims) {
     if (dim->name!="time") {
@@ -665,14 +734,93 @@ void add_time (      NCFile& file,
   add_var(file,"time",dtype,{"time"},true);
 }
 
+// ============== BUFFERED WRITES ============== //
+
+int get_dtype_size (const std::string& dtype) {
+  int size = 0;
+  if (dtype=="int") {
+    size = sizeof(int);
+  } else if (dtype=="long long") {
+    size = sizeof(long long);
+  } else if (dtype=="float") {
+    size = sizeof(float);
+  } else if (dtype=="double") {
+    size = sizeof(double);
+  } else {
+    EKAT_ERROR_MSG ("Error! Unrecognized/unsupported data type: " + dtype + "\n");
+  }
+  return size;
+}
+
+void attach_buffer (NCFile& file, const int num_records)
+{
+  EKAT_REQUIRE_MSG (file.enddef,
+      "Error! Cannot attach a write buffer until enddef has been called.\n"
+      "  - file name: " + file.name + "\n");
+  EKAT_REQUIRE_MSG (file.buffer_size==0,
+      "Error! A write buffer was already attached to this file.\n"
+      "  - file name: " + file.name + "\n");
+
+  // num_records records of each time-dependent var
+  MPI_Offset size = 0;
+  for (const auto& it : file.vars) {
+    const auto& var = *it.second;
+    if (var.has_time()) {
+      size += static_cast<MPI_Offset>(var.size)*get_dtype_size(var.dtype)*num_records;
+    }
+  }
+  if (size==0) {
+    return;
+  }
+
+  int ret = ncmpi_buffer_attach(file.ncid,size);
+  EKAT_REQUIRE_MSG (ret==NC_NOERR,
+      "Error! Could not attach write buffer to NC file.\n"
+      "  - file name  : " + file.name + "\n"
+      "  - buffer size: " + std::to_string(size) + "\n"
+      "  - err code   : " + std::to_string(ret) + "\n");
+  file.buffer_size = size;
+}
+
+void wait_all (const NCFile& file, const bool timed)
+{
+  auto& ts = timing::TimingSession::instance();
+  if (timed) {
+    ts.start_timer("io::wait_all");
+  }
+
+  std::vector<int> statuses(file.requests.size());
+  int ret = ncmpi_wait_all(file.ncid,file.requests.size(),
+                           file.requests.data(),statuses.data());
+  EKAT_REQUIRE_MSG (ret==NC_NOERR,
+      "Error! Could not complete pending writes.\n"
+      "  - file name : " + file.name + "\n"
+      "  - num writes: " + std::to_string(file.requests.size()) + "\n"
+      "  - err code  : " + std::to_string(ret) + "\n");
+  for (auto s : statuses) {
+    EKAT_REQUIRE_MSG (s==NC_NOERR,
+        "Error! One of the pending writes failed.\n"
+        "  - file name : " + file.name + "\n"
+        "  - err code  : " + std::to_string(s) + "\n");
+  }
+  file.requests.clear();
+  file.buffer_usage = 0;
+
+  if (timed) {
+    ts.stop_timer("io::wait_all");
+  }
+}
+
 // ================== READ OPS ================ //
 
 template<typename T>
 void read_var (const NCFile& file, const std::string& vname,
-                     T* const  data, const int record)
+                     T* const  data, const int record, const bool timed)
 {
   auto& ts = timing::TimingSession::instance();
-  ts.start_timer("io::read_var");
+  if (timed) {
+    ts.start_timer("io::read_var");
+  }
 
   EKAT_REQUIRE_MSG (file.vars.find(vname)!=file.vars.end(),
       "Error! Variable not found in output NC file.\n"
@@ -722,57 +870,35 @@ void read_var (const NCFile& file, const std::string& vname,
   int ret;
 
   auto mpi_dtype = get_io_mpi_dtype<T>();
-  // If partitioned, write one decomposed-dim entry at a time
+  // If partitioned, read all the runs of all ranks with a single collective call
   if (var->decomp) {
     auto decomp = var->decomp;
-    auto dim = decomp->dim;
-
-    // This dim_idx is for pack_Nd, which only uses the non-time dims of the array
-    int non_time_dim_offset = var->has_time() ? 1 : 0;
-    int dim_idx = decomp->dim_idx-non_time_dim_offset;
-    int num_nontime_dims = var->dims.size() - non_time_dim_offset;
-
-    // We read only one entry at a time along the decomp dim
-    count[decomp->dim_idx] = 1;
-
-    T* buf = reinterpret_cast<T*>(decomp->buf.data());
-
-    ret = ncmpi_begin_indep_data(file.ncid);
-    EKAT_REQUIRE_MSG (ret==NC_NOERR,
-        "Error! Could not begin independent data mode for read.\n"
-        "  - file name : " + file.name + "\n"
-        "  - var name  : " + var->name + "\n"
-        "  - err code : " + std::to_string(ret) + "\n");
-    for (unsigned i=0; i<dim->entries.size(); ++i) {
-      int gid = dim->entries[i];
-      start[decomp->dim_idx] = gid;
-      ret = ncmpi_get_vara(file.ncid,var->ncid,
-                           start.data(),count.data(),
-                           buf,decomp->hyperslab_size,mpi_dtype);
-      switch (num_nontime_dims) {
-        case 1: unpack_1d(buf,var->dimlens.data(),dim_idx,i,data); break;
-        case 2: unpack_2d(buf,var->dimlens.data(),dim_idx,i,data); break;
-        case 3: unpack_3d(buf,var->dimlens.data(),dim_idx,i,data); break;
-        default:
-          EKAT_ERROR_MSG ("Error! Max number of non-time dims for decomposed vars is 3.\n"
-                          " - file name: " + file.name + "\n"
-                          " - var name : " + var->name + "\n"
-                          " - var dims : " + dims_str(var->dims) + "\n");
+    const int nruns = decomp->num_runs();
+    const int ndims = dims.size();
+    if (has_time) {
+      for (int r=0; r<nruns; ++r) {
+        decomp->starts[r*ndims] = start[0];
+        decomp->counts[r*ndims] = 1;
       }
-#ifdef CLDERA_DEBUG
-      EKAT_REQUIRE_MSG (ret==NC_NOERR,
-          "Error! Could not read decomposed variable.\n"
-          "  - file name : " + file.name + "\n"
-          "  - var name  : " + var->name + "\n"
-          "  - err code : " + std::to_string(ret) + "\n");
-#endif
     }
-    ret = ncmpi_end_indep_data(file.ncid);
+
+    // Data comes in run order, so it may need to be unpacked
+    T* buf = data;
+    if (not decomp->in_order) {
+      decomp->buf.resize(sizeof(T)*var->size);
+      buf = reinterpret_cast<T*>(decomp->buf.data());
+    }
+    ret = ncmpi_get_varn_all(file.ncid,var->ncid,nruns,
+                             decomp->starts_ptrs.data(),decomp->counts_ptrs.data(),
+                             buf,var->size,mpi_dtype);
     EKAT_REQUIRE_MSG (ret==NC_NOERR,
-        "Error! Could not end independent data mode for read.\n"
+        "Error! Could not read partitioned variable.\n"
         "  - file name : " + file.name + "\n"
         "  - var name  : " + var->name + "\n"
         "  - err code : " + std::to_string(ret) + "\n");
+    if (not decomp->in_order) {
+      unpack(*decomp,buf,data);
+    }
   } else {
     ret = ncmpi_get_vara_all(file.ncid,var->ncid,
                              start.data(),count.data(),
@@ -785,27 +911,31 @@ void read_var (const NCFile& file, const std::string& vname,
         "  - err code : " + std::to_string(ret) + "\n");
 #endif
   }
-  ts.stop_timer("io::read_var");
+  if (timed) {
+    ts.stop_timer("io::read_var");
+  }
 }
 
 // Instantiations 
 template void read_var (const NCFile& file, const std::string& vname,
-                        int* const data, const int record);
+                        int* const data, const int record, const bool timed);
 template void read_var (const NCFile& file, const std::string& vname,
-                        long long* const data, const int record);
+                        long long* const data, const int record, const bool timed);
 template void read_var (const NCFile& file, const std::string& vname,
-                        float* const data, const int record);
+                        float* const data, const int record, const bool timed);
 template void read_var (const NCFile& file, const std::string& vname,
-                        double* const data, const int record);
+                        double* const data, const int record, const bool timed);
 
 // ====================== WRITE OPS ==================== //
 
 template<typename T>
 void write_var (const NCFile& file,const std::string& vname,
-                const T* const  data)
+                const T* const  data, const int num_records, const bool timed)
 {
   auto& ts = timing::TimingSession::instance();
-  ts.start_timer("io::write_var");
+  if (timed) {
+    ts.start_timer("io::write_var");
+  }
   EKAT_REQUIRE_MSG (file.vars.find(vname)!=file.vars.end(),
       "Error! Variable not found in output NC file.\n"
       "  - file name : " + file.name + "\n"
@@ -823,6 +953,13 @@ void write_var (const NCFile& file,const std::string& vname,
       "  - file name : " + file.name + "\n"
       "  - var name  : " + vname + "\n");
 
+  EKAT_REQUIRE_MSG (num_records==1 or (num_records>1 and var->has_time()),
+      "Error! Invalid number of records.\n"
+      "  - file name  : " + file.name + "\n"
+      "  - var name   : " + vname + "\n"
+      "  - time dep   : " + (var->has_time() ? "yes" : "no") + "\n"
+      "  - num records: " + std::to_string(num_records) + "\n");
+
   const auto& dims = var->dims;
   const int ndims = dims.size();
   std::vector<MPI_Offset> start(ndims), count(ndims);
@@ -830,8 +967,9 @@ void write_var (const NCFile& file,const std::string& vname,
   const int has_non_time_dims = first_non_time_idx<ndims;
   if (var->has_time()) {
     start[0] = var->nrecords;
-    count[0] = 1;
+    count[0] = num_records;
   }
+  const MPI_Offset size = static_cast<MPI_Offset>(var->size)*num_records;
   if (has_non_time_dims) {
     for (size_t idim=first_non_time_idx; idim<dims.size(); ++idim) {
       start[idim] = 0;
@@ -841,93 +979,109 @@ void write_var (const NCFile& file,const std::string& vname,
 
   int ret;
 
-  ret = ncmpi_begin_indep_data(file.ncid);
-  EKAT_REQUIRE_MSG (ret==NC_NOERR,
-      "Error! Could not begin independent data mode for write.\n"
-      "  - file name : " + file.name + "\n"
-      "  - var name  : " + var->name + "\n"
-      "  - err code : " + std::to_string(ret) + "\n");
-
   auto mpi_dtype = get_io_mpi_dtype<T>();
 
+  // If a buffer is attached, writes of time-dependent vars are only queued,
+  // and completed in wait_all. The buffer holds one record of each of them.
+  const bool buffered = file.buffer_size>0 and var->has_time();
+  if (buffered) {
+    const MPI_Offset bytes = size*sizeof(T);
+    EKAT_REQUIRE_MSG (file.buffer_usage+bytes<=file.buffer_size,
+        "Error! Not enough space in the write buffer. Call wait_all first.\n"
+        "  - file name   : " + file.name + "\n"
+        "  - var name    : " + var->name + "\n"
+        "  - buffer size : " + std::to_string(file.buffer_size) + "\n"
+        "  - buffer usage: " + std::to_string(file.buffer_usage) + "\n");
+    file.buffer_usage += bytes;
+  }
+  int req = NC_REQ_NULL;
+
   // If a decomposition was provided that impacts this var, we need to do things differently
   if (var->decomp) {
     auto decomp = var->decomp;
-    auto dim = decomp->dim;
-
-    // This dim_idx is for pack_Nd, which only uses the non-time dims of the array
-    int non_time_dim_offset = var->has_time() ? 1 : 0;
-    int dim_idx = decomp->dim_idx-non_time_dim_offset;
-    int num_nontime_dims = var->dims.size() - non_time_dim_offset;
-
-    // We write only one entry at a time along the decomp dim
-    count[decomp->dim_idx] = 1;
-
-    T* buf = reinterpret_cast<T*>(decomp->buf.data());
-    for (unsigned i=0; i<dim->entries.size(); ++i) {
-      int gid = dim->entries[i];
-      start[decomp->dim_idx] = gid;
-      switch (num_nontime_dims) {
-        case 1: pack_1d(data,var->dimlens.data(),dim_idx,i,buf); break;
-        case 2: pack_2d(data,var->dimlens.data(),dim_idx,i,buf); break;
-        case 3: pack_3d(data,var->dimlens.data(),dim_idx,i,buf); break;
-        default:
-          EKAT_ERROR_MSG ("Error! Max number of non-time dims for decomposed vars is 3.\n"
-                          " - file name: " + file.name + "\n"
-                          " - var name : " + var->name + "\n"
-                          " - var dims : " + dims_str(var->dims) + "\n");
+    const int nruns = decomp->num_runs();
+
+    // Only the time records change from one write to the next
+    if (var->has_time()) {
+      for (int r=0; r<nruns; ++r) {
+        decomp->starts[r*ndims] = var->nrecords;
+        decomp->counts[r*ndims] = num_records;
       }
-      ret = ncmpi_put_vara(file.ncid,var->ncid,
-                           start.data(),count.data(),
-                           buf,decomp->hyperslab_size,mpi_dtype);
-#ifdef CLDERA_DEBUG
-      EKAT_REQUIRE_MSG (ret==NC_NOERR,
-          "Error! Could not write partitioned variable.\n"
-          "  - file name : " + file.name + "\n"
-          "  - var name  : " + var->name + "\n"
-          "  - err code : " + std::to_string(ret) + "\n");
-#endif
     }
+
+    // Pack data in the order of the requests, unless it already is. With more
+    // than one run, records are interleaved differently in the requests.
+    const T* buf = data;
+    if (not decomp->in_order or (num_records>1 and nruns>1)) {
+      decomp->buf.resize(sizeof(T)*size);
+      pack(*decomp,data,var->size,num_records,reinterpret_cast<T*>(decomp->buf.data()));
+      buf = reinterpret_cast<const T*>(decomp->buf.data());
+    }
+
+    // A single collective call writes all the runs of all ranks
+    if (buffered) {
+      ret = ncmpi_bput_varn(file.ncid,var->ncid,nruns,
+                            decomp->starts_ptrs.data(),decomp->counts_ptrs.data(),
+                            buf,size,mpi_dtype,&req);
+    } else {
+      ret = ncmpi_put_varn_all(file.ncid,var->ncid,nruns,
+                               decomp->starts_ptrs.data(),decomp->counts_ptrs.data(),
+                               buf,size,mpi_dtype);
+    }
+    EKAT_REQUIRE_MSG (ret==NC_NOERR,
+        "Error! Could not write partitioned variable.\n"
+        "  - file name : " + file.name + "\n"
+        "  - var name  : " + var->name + "\n"
+        "  - err code : " + std::to_string(ret) + "\n");
   } else {
     // No partitioned data: simply write to file from root rank.
     // WARNING: if the data is not partitioned, we assume that all
     //          ranks store the same data, and therefore we can
-    //          pick any rank to do the write.
-    if (file.comm.am_i_root()) {
-      ret = ncmpi_put_vara(file.ncid,var->ncid,
-                           start.data(),count.data(),
-                           data,var->size,mpi_dtype);
-#ifdef CLDERA_DEBUG
-      EKAT_REQUIRE_MSG (ret==NC_NOERR,
-          "Error! Could not write non-partitioned variable.\n"
-          "  - file name : " + file.name + "\n"
-          "  - var name  : " + var->name + "\n"
-          "  - err code : " + std::to_string(ret) + "\n");
-#endif
+    //          pick any rank to do the write. The other ranks still
+    //          take part in the collective call, with an empty request.
+    const bool root = file.comm.am_i_root();
+    if (buffered) {
+      ret = NC_NOERR;
+      if (root) {
+        ret = ncmpi_bput_vara(file.ncid,var->ncid,
+                              start.data(),count.data(),
+                              data,size,mpi_dtype,&req);
+      }
+    } else {
+      if (not root) {
+        std::fill(count.begin(),count.end(),0);
+      }
+      ret = ncmpi_put_vara_all(file.ncid,var->ncid,
+                               start.data(),count.data(),
+                               data,root ? size : 0,mpi_dtype);
     }
+    EKAT_REQUIRE_MSG (ret==NC_NOERR,
+        "Error! Could not write non-partitioned variable.\n"
+        "  - file name : " + file.name + "\n"
+        "  - var name  : " + var->name + "\n"
+        "  - err code : " + std::to_string(ret) + "\n");
   }
 
-  ret = ncmpi_end_indep_data(file.ncid);
-  EKAT_REQUIRE_MSG (ret==NC_NOERR,
-      "Error! Could not end independent data mode for write.\n"
-      "  - file name : " + file.name + "\n"
-      "  - var name  : " + var->name + "\n"
-      "  - err code : " + std::to_string(ret) + "\n");
+  if (req!=NC_REQ_NULL) {
+    file.requests.push_back(req);
+  }
 
   // Update number of records
-  ++var->nrecords;
-  ts.stop_timer("io::write_var");
+  var->nrecords += num_records;
+  if (timed) {
+    ts.stop_timer("io::write_var");
+  }
 }
 
 // Instantiations
 template void write_var (const NCFile& file, const std::string& vname,
-                         const int* const data);
+                         const int* const data, const int num_records, const bool timed);
 template void write_var (const NCFile& file, const std::string& vname,
-                         const long long* const data);
+                         const long long* const data, const int num_records, const bool timed);
 template void write_var (const NCFile& file, const std::string& vname,
-                         const float* const data);
+                         const float* const data, const int num_records, const bool timed);
 template void write_var (const NCFile& file, const std::string& vname,
-                         const double* const data);
+                         const double* const data, const int num_records, const bool timed);
 
 // ======================== ATTRIBUTES =========================== //
 
@@ -26,6 +26,9 @@ enum class IOMode {
 template<typename T>
 std::string get_io_dtype_name ();
 
+// Size in bytes of an io data type (e.g., "float"->4)
+int get_dtype_size (const std::string& dtype);
+
 inline std::string e2str (const IOMode m) {
   std::string name;
   switch (m) {
@@ -56,6 +59,19 @@ struct NCDim {
   bool          decomp_set = false;
 };
 
+// Decomposition of a dimension across ranks: the (0-based) global indices of
+// the local entries, their global count, and the local entries sorted by global
+// index (perm[k] is the local index of the k-th one), split in runs of
+// consecutive global indices (the r-th run is [run_offsets[r],run_offsets[r+1])).
+// Building it requires collectives (to check the entries), while adding it to
+// a file does not, so it can be built once, and added to several files.
+struct DimDecomp {
+  std::vector<int>  entries;
+  int               global_count;
+  std::vector<int>  perm;
+  std::vector<int>  run_offsets;
+};
+
 // A decomposition tells which entries of a global
 // array this rank is in charge of. Each different
 // n-dim layout yields a new decomp, since the offsets
@@ -71,11 +87,34 @@ struct IODecomp {
   std::vector<dim_ptr_t>  layout;
   dim_ptr_t               dim;
   int dim_idx;
-  int hyperslab_size;
 
-  // This will be used if the var is decomposed. At write time, data for each
-  // of the hyperslices (along the decomp dim) will be copied into this contiguous buf,
-  // and then pnetcdf write routines will be called.
+  // Product of the (local) lengths of the non-time dims before/after the decomp dim
+  int outer_size;
+  int inner_size;
+
+  // Reads/writes are done with a single collective call, with one request for each run
+  // of consecutive global indices along the decomp dim (see DimDecomp).
+  // The start/count of each request are built once, except for the time record (if any).
+  std::shared_ptr<const DimDecomp> dim_decomp;
+
+  // Copy plan to pack one record of local data in run order: each chunk is a
+  // contiguous range of the record, the chunks of the r-th run are
+  // [chunk_offsets[r],chunk_offsets[r+1]), and the packed data is the chunks
+  // one after the other. Chunks adjacent in the local data are merged.
+  struct CopyChunk {
+    long long offset;
+    long long size;
+  };
+  std::vector<CopyChunk>  chunks;
+  std::vector<int>        chunk_offsets;
+  bool                    in_order; // If true, packing data in run order is a no-op
+  mutable std::vector<MPI_Offset>   starts, counts;
+  mutable std::vector<MPI_Offset*>  starts_ptrs, counts_ptrs;
+
+  int num_runs () const { return dim_decomp->run_offsets.size()-1; }
+
+  // Unless the local data is already in run order, on write it is packed here
+  // before calling pnetcdf, while on read it is read here, and then unpacked.
   mutable std::vector<char> buf;
 };
 
@@ -121,6 +160,12 @@ struct NCFile {
   bool enddef = false;
 
   ekat::Comm    comm;
+
+  // Buffered nonblocking writes (see attach_buffer): size of the attached
+  // buffer (0 if none), bytes used by the pending requests, and their ids
+  MPI_Offset                buffer_size = 0;
+  mutable MPI_Offset        buffer_usage = 0;
+  mutable std::vector<int>  requests;
 };
 
 // ================= FUNCTIONS ================ //
@@ -141,9 +186,18 @@ void add_var (      NCFile& file,
 void add_time (      NCFile& file,
                const std::string& dtype);
 
+std::shared_ptr<const DimDecomp>
+make_dim_decomp (const ekat::Comm& comm, const std::vector<int>& entries);
+
+// The second version does no collective, so the same decomp can be cheaply
+// added to all the files that share it. It has a different name, so that
+// add_decomp(file,dim,{}) is not ambiguous.
 void add_decomp (      NCFile& file,
                  const std::string& dim_name,
                  const std::vector<int>& entries);
+void add_dim_decomp (      NCFile& file,
+                     const std::string& dim_name,
+                     const std::shared_ptr<const DimDecomp>& dim_decomp);
 
 void enddef (NCFile& file);
 void redef  (NCFile& file);
@@ -154,17 +208,34 @@ void update_time (      NCFile& file,
   write_var (file,"time",&time);
 }
 
+// --- Buffered nonblocking writes
+// Attach a buffer large enough to hold num_records records of each time-dependent
+// var. From then on, write_var only queues the writes of time-dependent vars (data
+// is copied in the buffer, so it can be modified right away), and wait_all
+// completes all the queued writes at once (it must be called on all ranks).
+// Must be called after enddef. The buffer is detached when the file is closed.
+void attach_buffer (NCFile& file, const int num_records = 1);
+void wait_all (const NCFile& file, const bool timed = true);
+
 // --- Variable read/write operations
+// For time-dependent vars, num_records consecutive records can be written at
+// once, with data storing them one after the other
+// If timed is false, the operation is not clocked in its "io::" timer, which
+// must be the case for reads/writes done on a helper thread (timers can only
+// be used by one thread at a time). Same for wait_all.
 template<typename T>
 void write_var (const NCFile& file,
                 const std::string& vname,
-                const T* const  data);
+                const T* const  data,
+                const int num_records = 1,
+                const bool timed = true);
 
 template<typename T>
 void read_var (const NCFile& file,
                const std::string& vname,
                      T* const data,
-               const int record = -1);
+               const int record = -1,
+               const bool timed = true);
 
 // --- Attribute read/write operations
 
@@ -22,7 +22,7 @@ BoundsFieldTest::BoundsFieldTest(const std::string& name,
 
 bool BoundsFieldTest::test(const TimeStamp& t)
 {
-  const auto field_min = m_min_stat->compute(t);
+  const auto& field_min = m_min_stat->compute(t);
   if (field_min.data<Real>()[0] < m_bounds.min)
   {
     if(m_save_history_on_failure)
@@ -32,7 +32,7 @@ bool BoundsFieldTest::test(const TimeStamp& t)
     return false;
   }
 
-  const auto field_max = m_max_stat->compute(t);
+  const auto& field_max = m_max_stat->compute(t);
   if (field_max.data<Real>()[0] > m_bounds.max)
   {
     if(m_save_history_on_failure)
@@ -0,0 +1,77 @@
+#include "profiling/cldera_column_decomp.hpp"
+
+#include <ekat/ekat_assert.hpp>
+#include <ekat/util/ekat_string_utils.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <tuple>
+
+namespace cldera {
+
+ColumnDecomp::
+ColumnDecomp (const ekat::Comm& comm, const Field& col_gids)
+{
+  EKAT_REQUIRE_MSG (col_gids.layout().rank()==1,
+      "Error! Wrong layout for field 'col_gids'.\n"
+      "  - expected layout: (ncol)\n"
+      "  - actual layout  : (" + ekat::join(col_gids.layout().names(),",") + ")\n");
+  EKAT_REQUIRE_MSG (col_gids.data_type()==IntType,
+      "Error! Wrong data type for field 'col_gids'.\n"
+      "  - expected data type: " + e2str(IntType) + "\n"
+      "  - actual data type  : " + e2str(col_gids.data_type()) + "\n");
+
+  // Gather the gids of all parts, and find the min gid
+  std::vector<int> offsets;
+  offsets.reserve(col_gids.layout().size());
+  for (int p=0; p<col_gids.nparts(); ++p) {
+    const int n = col_gids.part_layout(p).size();
+    const auto data = col_gids.part_data<int>(p);
+    offsets.insert(offsets.end(),data,data+n);
+  }
+  m_min_gid = offsets.size()>0 ? *std::min_element(offsets.begin(),offsets.end())
+                               : std::numeric_limits<int>::max();
+  comm.all_reduce(&m_min_gid,1,MPI_MIN);
+
+  for (auto& o : offsets) {
+    o -= m_min_gid;
+  }
+  m_dim_decomp = io::pnetcdf::make_dim_decomp(comm,offsets);
+}
+
+std::shared_ptr<const ColumnDecomp>
+ColumnDecomp::get (const ekat::Comm& comm, const Field& col_gids)
+{
+  // A col_gids field is identified by the data of its parts
+  using key_t = std::tuple<MPI_Comm,std::vector<const int*>,std::vector<int>>;
+  static std::map<key_t,std::weak_ptr<const ColumnDecomp>> cache;
+
+  key_t key;
+  std::get<0>(key) = comm.mpi_comm();
+  for (int p=0; p<col_gids.nparts(); ++p) {
+    std::get<1>(key).push_back(col_gids.part_data<int>(p));
+    std::get<2>(key).push_back(col_gids.part_layout(p).size());
+  }
+
+  // Decomps are built and released collectively, so the cache state (hence
+  // the decision to build a new decomp) is the same on all ranks
+  auto it = cache.find(key);
+  if (it!=cache.end()) {
+    if (auto decomp = it->second.lock()) {
+      return decomp;
+    }
+  }
+
+  auto decomp = std::make_shared<const ColumnDecomp>(comm,col_gids);
+  cache[key] = decomp;
+  return decomp;
+}
+
+void ColumnDecomp::
+attach (io::pnetcdf::NCFile& file, const std::string& dim_name) const
+{
+  io::pnetcdf::add_dim_decomp(file,dim_name,m_dim_decomp);
+}
+
+} // namespace cldera
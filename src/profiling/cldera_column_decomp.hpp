@@ -0,0 +1,54 @@
+#ifndef CLDERA_COLUMN_DECOMP_HPP
+#define CLDERA_COLUMN_DECOMP_HPP
+
+#include "profiling/cldera_field.hpp"
+
+#include "io/cldera_pnetcdf.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <memory>
+#include <string>
+
+namespace cldera {
+
+/*
+ * Decomposition of the columns across ranks, for pnetcdf files
+ *
+ * Built from the col_gids field: the offset of each local column in the
+ * global arrays is its gid minus the min gid over all ranks (1 in E3SM), in
+ * the order of the field parts. Building it needs a few collectives, while
+ * attaching it to a file needs none.
+ *
+ * Output, mask, and reference files all use the same decomposition, so the
+ * decomps are cached: 'get' only builds the decomp of a col_gids field (on a
+ * given comm) the first time it is called, and must be called on all ranks.
+ * The cache holds weak references, and each ProfilingContext keeps the decomp
+ * of its col_gids field alive until it is cleaned up.
+ */
+
+class ColumnDecomp
+{
+public:
+  ColumnDecomp (const ekat::Comm& comm, const Field& col_gids);
+
+  static std::shared_ptr<const ColumnDecomp>
+  get (const ekat::Comm& comm, const Field& col_gids);
+
+  int min_gid () const { return m_min_gid; }
+  int num_global_cols () const { return m_dim_decomp->global_count; }
+
+  // Offset of each local column in the global arrays
+  const std::vector<int>& offsets () const { return m_dim_decomp->entries; }
+
+  // Set the decomposition of dim 'dim_name' of the file (no collectives)
+  void attach (io::pnetcdf::NCFile& file, const std::string& dim_name = "ncol") const;
+
+private:
+  int                                           m_min_gid;
+  std::shared_ptr<const io::pnetcdf::DimDecomp> m_dim_decomp;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_COLUMN_DECOMP_HPP
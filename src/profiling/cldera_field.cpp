@@ -1,4 +1,5 @@
 #include "cldera_field.hpp"
+#include "cldera_field_arena.hpp"
 
 #include <ekat/util/ekat_string_utils.hpp>
 
@@ -68,6 +69,7 @@ Field (const std::string& n, const FieldLayout& fl,
   m_part_dim = part_dim;
   m_data.resize(nparts);
   m_part_extents.resize(nparts,-1);
+  m_part_layouts.resize(nparts);
 }
 
 Field::
@@ -82,7 +84,7 @@ Field (const std::string& n,
   // Nothing to do here
 }
 
-FieldLayout Field::
+const FieldLayout& Field::
 part_layout (const int ipart) const {
   check_part_idx(ipart);
   EKAT_REQUIRE_MSG (m_part_extents[ipart]!=-1,
@@ -91,19 +93,7 @@ part_layout (const int ipart) const {
       "    - Field name: " + m_name + "\n"
       "    - Part index: " + std::to_string(ipart) + "\n");
 
-  if (m_layout.rank()==0) {
-    return FieldLayout();
-  } else {
-    std::vector<int> dims = m_layout.dims();
-    dims[m_part_dim] = m_part_extents[ipart];
-    if (m_part_dim_alloc_size==-1) {
-      return FieldLayout(dims,m_layout.names());
-    } else {
-      std::vector<int> alloc_dims = m_layout.dims();
-      alloc_dims[m_part_dim] = m_part_dim_alloc_size;
-      return FieldLayout(dims,alloc_dims,m_layout.names());
-    }
-  }
+  return m_part_layouts[ipart];
 }
 
 void Field::
@@ -132,9 +122,30 @@ set_part_extent (const int ipart, const int part_extent)
       "    - Part alloc size: " + std::to_string(m_part_dim_alloc_size) + "\n");
 
   m_part_extents[ipart] = part_extent;
+
+  // Build the part layout once, since it is needed at every data access
+  if (m_layout.rank()>0) {
+    std::vector<int> dims = m_layout.dims();
+    dims[m_part_dim] = part_extent;
+    if (m_part_dim_alloc_size==-1) {
+      m_part_layouts[ipart] = FieldLayout(dims,m_layout.names());
+    } else {
+      std::vector<int> alloc_dims = m_layout.dims();
+      alloc_dims[m_part_dim] = m_part_dim_alloc_size;
+      m_part_layouts[ipart] = FieldLayout(dims,alloc_dims,m_layout.names());
+    }
+  }
 }
 
 void Field::commit () {
+  commit_impl(nullptr,"");
+}
+
+void Field::commit (FieldArena& arena, const std::string& pool) {
+  commit_impl(&arena,pool);
+}
+
+void Field::commit_impl (FieldArena* arena, const std::string& pool) {
   if (m_committed) {
     // It's better to allow this, in case we commit one field, and later
     // call commit_all_fields in the profiling interface.
@@ -145,17 +156,29 @@ void Field::commit () {
     // Allocate the views
     m_data_nonconst.resize(m_nparts);
     for (int i=0; i<m_nparts; ++i) {
-      auto pl = part_layout(i);
-      auto iname = m_name + "_" + std::to_string(i);
-      m_data_nonconst[i] = view_1d_host<char> (iname,size_of(m_data_type)*pl.alloc_size());
+      const auto& pl = part_layout(i);
+      const auto nbytes = size_of(m_data_type)*pl.alloc_size();
+      if (arena) {
+        m_data_nonconst[i] = arena->allocate(pool,nbytes,size_of(m_data_type));
+      } else {
+        auto iname = m_name + "_" + std::to_string(i);
+        m_data_nonconst[i] = view_1d_host<char> (iname,nbytes);
+      }
       m_data[i] = m_data_nonconst[i];
     }
   }
 
   // Checks
   int part_extents_sum = 0;
-  m_part_offsets.resize(m_nparts);
+  m_part_offsets.resize(m_nparts+1);
   for (int ipart=0; ipart<m_nparts; ++ipart) {
+    m_part_offsets[ipart] = part_extents_sum;
+    part_extents_sum += m_part_extents[ipart];
+
+    // An empty part (e.g., a chunk with no columns) has nothing to point to
+    if (m_part_extents[ipart]==0) {
+      continue;
+    }
     EKAT_REQUIRE_MSG (m_data[ipart].data()!=nullptr,
         "[Field::commit]\n"
         "  Error! Part data was not set for at least one partition.\n"
@@ -164,16 +187,15 @@ void Field::commit () {
 
     // Note: the following should be automatically true for Copy fields
     for (int jpart=0; jpart<ipart; ++jpart) {
-      EKAT_REQUIRE_MSG (m_data[ipart].data()!=m_data[jpart].data(),
+      EKAT_REQUIRE_MSG (m_part_extents[jpart]==0 || m_data[ipart].data()!=m_data[jpart].data(),
         "[Field::commit]\n"
         "  Error! Found two partitions that have the same data pointer.\n"
         "    - Field name: " + m_name + "\n"
         "    - Part 1 index: " + std::to_string(ipart) + "\n"
         "    - Part 2 index: " + std::to_string(jpart) + "\n");
     }
-    m_part_offsets[ipart] = part_extents_sum;
-    part_extents_sum += m_part_extents[ipart];
   }
+  m_part_offsets[m_nparts] = part_extents_sum;
   EKAT_REQUIRE_MSG (part_extents_sum==(m_layout.rank()==0 ? 1 : m_layout.extent(m_part_dim)),
       "[Field::commit]\n"
       "  Error! Partition extents do not add up to layout dimension.\n"
@@ -194,6 +216,8 @@ Field Field::clone() const {
   // access f's members
   f.m_part_dim_alloc_size = m_part_dim_alloc_size;
   f.m_part_extents = m_part_extents;
+  f.m_part_offsets = m_part_offsets;
+  f.m_part_layouts = m_part_layouts;
   f.m_committed = true;
   f.m_data_nonconst.resize(m_nparts);
   f.m_data.resize(m_nparts);
@@ -251,9 +275,9 @@ part_offset (const int ipart) const {
 }
 
 void Field::
-check_single_part (const std::string& method_name) const {
+check_single_part (const char* method_name) const {
   EKAT_REQUIRE_MSG (m_nparts==1,
-      "Error! Method Field::" + method_name + " only available for single-part fields.\n");
+      "Error! Method Field::" + std::string(method_name) + " only available for single-part fields.\n");
 }
 
 void Field::
@@ -266,13 +290,13 @@ check_part_idx (const int ipart) const {
 }
 
 void Field::
-check_committed (const bool expected, const std::string& context) const {
+check_committed (const bool expected, const char* context) const {
   EKAT_REQUIRE_MSG (m_committed==expected,
       "Error! Field was not in the expected committed state.\n"
       "  - Field Name: " + m_name + "\n"
       "  - Expected  : " + std::string(expected ? "committed" : "not committed") + "\n"
       "  - Actual    : " + std::string(m_committed ? "committed" : "not committed") + "\n"
-      "  - Context   : " + context + "\n");
+      "  - Context   : " + std::string(context) + "\n");
 }
 
 void Field::
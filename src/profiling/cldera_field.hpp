@@ -25,11 +25,14 @@ namespace cldera
  *
  * Notice that each partition is stored contiguously in memory.
  * The method part_layout allows to get the layout of the partition,
- * so that one can safely iterate over the partition.
+ * so that one can safely iterate over the partition. Part layouts are
+ * built once, when the part extent is set, so getting them is cheap.
  *
  * Note: a contiguous/non-partitioned field simply has nparts=1.
  */
 
+class FieldArena;
+
 enum class DataAccess {
   Copy,
   View
@@ -78,7 +81,7 @@ public:
 
   // Get rank-global (not partitioned) and part layouts
   const FieldLayout& layout () const { return m_layout; }
-        FieldLayout part_layout (const int ipart) const;
+  const FieldLayout& part_layout (const int ipart) const;
 
   // Set part specs
   void set_part_extent  (const int ipart, const int part_extent);
@@ -89,6 +92,10 @@ public:
 
   void commit ();
 
+  // Same as above, but, if m_data_access=Copy, the parts are allocated
+  // consecutively from the given pool of the arena (see FieldArena)
+  void commit (FieldArena& arena, const std::string& pool);
+
   void rename (const std::string& name) { m_name = name; }
 
   // Copy into managed views, if m_data_access=Copy
@@ -129,6 +136,7 @@ public:
   // Query status
   int nparts () const { return m_nparts; }
   int part_dim () const { return m_part_dim; }
+  int part_dim_alloc_size () const { return m_part_dim_alloc_size; }
   int part_offset (const int ipart) const;
   bool committed () const { return m_committed; }
   DataAccess data_access () const { return m_data_access; }
@@ -161,6 +169,8 @@ private:
   template<typename T>
   const T* char2ptr (const char* p) const { return reinterpret_cast<const T*>(p); }
 
+  void commit_impl (FieldArena* arena, const std::string& pool);
+
   template<typename T>
   void update_impl (const Field& x, const T alpha, const T beta);
   template<typename T>
@@ -169,9 +179,11 @@ private:
   // Check methods are called with the right inputs for this field
   template<typename T>
   void check_data_type () const;
-  void check_single_part (const std::string& method_name) const;
+  // NOTE: these are called at every data access, so take C strings,
+  //       to avoid building a std::string when no error occurs
+  void check_single_part (const char* method_name) const;
   void check_part_idx (const int i) const;
-  void check_committed (const bool expected, const std::string& context) const;
+  void check_committed (const bool expected, const char* context) const;
   void check_rank (const int N) const;
 
   std::string       m_name;
@@ -179,7 +191,8 @@ private:
   int               m_nparts   = -1;  // Set to something invalid for default ctor
   int               m_part_dim = -1;
   std::vector<int>  m_part_extents;
-  std::vector<int>  m_part_offsets;
+  std::vector<int>  m_part_offsets;   // Set at commit, with the total extent as last entry
+  std::vector<FieldLayout>  m_part_layouts;
   int               m_part_dim_alloc_size;
   bool              m_committed = false;
   DataAccess        m_data_access;
@@ -188,6 +201,10 @@ private:
   // Store data as char
   std::vector<view_1d_host<const char>>   m_data;
   std::vector<view_1d_host<      char>>   m_data_nonconst;
+
+  // Stat kernels access the parts data directly (see FieldParts)
+  template<typename T, int N>
+  friend struct FieldParts;
 };
 
 // =================== IMPLEMENTATION =================== //
@@ -475,7 +492,7 @@ void Field::update_impl (const Field& x, const T alpha, const T beta)
   for (int p=0; p<m_nparts; ++p) {
     auto yv = part_view_nonconst<T>(p);
     auto xv = x.part_view<T>(p);
-    auto pl = part_layout(p);
+    const auto& pl = part_layout(p);
     for (int i=0; i<pl.size(); ++i) {
       yv(i) = beta*yv(i) + alpha*xv(i);
     }
@@ -487,7 +504,7 @@ void Field::scale_impl (const T alpha)
 {
   for (int p=0; p<m_nparts; ++p) {
     auto yv = part_view_nonconst<T>(p);
-    auto pl = part_layout(p);
+    const auto& pl = part_layout(p);
     for (int i=0; i<pl.size(); ++i) {
       yv(i) *= alpha;
     }
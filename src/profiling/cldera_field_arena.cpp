@@ -0,0 +1,63 @@
+#include "profiling/cldera_field_arena.hpp"
+
+#include <ekat/ekat_assert.hpp>
+
+#include <algorithm>
+
+namespace cldera {
+
+FieldArena::
+FieldArena (const long long slab_size)
+ : m_slab_size (slab_size)
+{
+  EKAT_REQUIRE_MSG (slab_size>0,
+      "Error! Invalid slab size for field arena (" + std::to_string(slab_size) + ").\n");
+}
+
+view_1d_host<char> FieldArena::
+allocate (const std::string& pool, const long long nbytes, const int alignment)
+{
+  EKAT_REQUIRE_MSG (nbytes>=0 and alignment>0,
+      "Error! Invalid chunk specs for field arena.\n"
+      "  - pool     : " + pool + "\n"
+      "  - nbytes   : " + std::to_string(nbytes) + "\n"
+      "  - alignment: " + std::to_string(alignment) + "\n");
+
+  // Slabs are allocated by Kokkos, so their start is (over) aligned
+  auto& slabs = m_pools[pool];
+  long long beg = 0;
+  if (not slabs.empty()) {
+    const auto& s = slabs.back();
+    beg = (s.used + alignment - 1) / alignment * alignment;
+  }
+  if (slabs.empty() or beg+nbytes>static_cast<long long>(slabs.back().data.extent(0))) {
+    // Chunks larger than a slab get a slab of their own
+    Slab s;
+    s.data = view_1d_host<char>("cldera_arena_" + pool,std::max(m_slab_size,nbytes));
+    slabs.push_back(s);
+    beg = 0;
+  }
+
+  auto& s = slabs.back();
+  s.used = beg + nbytes;
+  m_size += nbytes;
+  return Kokkos::subview(s.data,std::make_pair(beg,beg+nbytes));
+}
+
+int FieldArena::
+num_slabs () const
+{
+  int n = 0;
+  for (const auto& it : m_pools) {
+    n += it.second.size();
+  }
+  return n;
+}
+
+long long FieldArena::
+size () const
+{
+  return m_size;
+}
+
+} // namespace cldera
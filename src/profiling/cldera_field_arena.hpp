@@ -0,0 +1,56 @@
+#ifndef CLDERA_FIELD_ARENA_HPP
+#define CLDERA_FIELD_ARENA_HPP
+
+#include "profiling/cldera_profiling_types.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cldera {
+
+/*
+ * A slab allocator for field data
+ *
+ * Rather than allocating one view per field part, fields can get their
+ * storage from an arena (see Field::commit), which hands out consecutive
+ * chunks of a few large slabs. Chunks are grouped in named pools (e.g., one
+ * per MPI op and data type for stats), each with its own slabs, so that
+ * fields that are used together are adjacent in memory. E.g., a batch of
+ * reductions on adjacent stat fields needs no packing (see ReductionBatch).
+ *
+ * Chunks are only aligned to the given alignment (typically the size of the
+ * data type), so that chunks of the same pool are back-to-back. Slabs are
+ * never freed by the arena: the returned views keep a reference to their
+ * slab, which is freed once the last field using it is gone.
+ */
+
+class FieldArena
+{
+public:
+  // Slabs have (at least) this size, in bytes
+  explicit FieldArena (const long long slab_size = 1024*1024);
+
+  // Get a chunk of nbytes from the given pool
+  view_1d_host<char> allocate (const std::string& pool, const long long nbytes,
+                               const int alignment);
+
+  // Number of slabs, and bytes handed out, across all pools
+  int num_slabs () const;
+  long long size () const;
+
+private:
+
+  struct Slab {
+    view_1d_host<char>  data;
+    long long           used = 0;
+  };
+
+  long long                                 m_slab_size;
+  std::map<std::string,std::vector<Slab>>   m_pools;
+  long long                                 m_size = 0;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_FIELD_ARENA_HPP
@@ -11,8 +11,9 @@ FieldLayout (const std::vector<int>& dims,
              const std::vector<int>& alloc_dims,
              const std::vector<std::string>& names)
 {
+  // Note: 0 is a valid extent (e.g., the layout of a field part with no columns)
   for (auto d : dims) {
-    EKAT_REQUIRE_MSG (d>0, "Error! Invalid dimension (" + std::to_string(d) + "\n");
+    EKAT_REQUIRE_MSG (d>=0, "Error! Invalid dimension (" + std::to_string(d) + "\n");
   }
   m_dims = dims;
 
@@ -0,0 +1,384 @@
+#include "cldera_in_transit.hpp"
+#include "cldera_profiling_archive.hpp"
+
+#include <ekat/util/ekat_string_utils.hpp>
+#include <ekat/ekat_assert.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <sstream>
+
+namespace cldera {
+
+namespace {
+
+const char* part_bytes (const Field& f, const int ipart) {
+  if (f.data_type()==DataType::IntType) {
+    return reinterpret_cast<const char*>(f.part_data<int>(ipart));
+  }
+  return reinterpret_cast<const char*>(f.part_data<Real>(ipart));
+}
+
+char* part_bytes_nonconst (Field& f, const int ipart) {
+  if (f.data_type()==DataType::IntType) {
+    return reinterpret_cast<char*>(f.part_data_nonconst<int>(ipart));
+  }
+  return reinterpret_cast<char*>(f.part_data_nonconst<Real>(ipart));
+}
+
+// Metadata of a field, as sent by a client
+struct FieldInfo {
+  std::string               name;
+  std::vector<int>          dims;
+  std::vector<std::string>  dimnames;
+  int                       nparts;
+  int                       part_dim;
+  int                       part_dim_alloc_size;
+  DataType                  data_type;
+  bool                      tracked;
+  std::vector<int>          part_extents;
+};
+
+// Blocking receive of a message of unknown size
+std::vector<char> recv_any_size (const int src, const int tag, const MPI_Comm comm)
+{
+  MPI_Status status;
+  MPI_Probe(src,tag,comm,&status);
+  int count;
+  MPI_Get_count(&status,MPI_CHAR,&count);
+  std::vector<char> buf(count);
+  MPI_Recv(buf.data(),count,MPI_CHAR,src,tag,comm,MPI_STATUS_IGNORE);
+  return buf;
+}
+
+void check_msg_size (const size_t bytes) {
+  EKAT_REQUIRE_MSG (bytes<=static_cast<size_t>(INT_MAX),
+      "Error! In-transit message exceeds the max MPI message size.\n"
+      "  - message size: " + std::to_string(bytes) + "\n");
+}
+
+} // anonymous namespace
+
+InTransitChannel::
+InTransitChannel (const ekat::Comm& comm, const int num_servers)
+{
+  const int num_clients = comm.size() - num_servers;
+  EKAT_REQUIRE_MSG (num_servers>0 and num_servers<=num_clients,
+      "Error! Invalid number of in-transit ranks.\n"
+      "  - in-transit ranks: " + std::to_string(num_servers) + "\n"
+      "  - total ranks     : " + std::to_string(comm.size()) + "\n"
+      "  - constraint      : 0 < in-transit ranks <= model ranks\n");
+
+  // Use a separate comm for the messages, so they can't match the model ones
+  MPI_Comm dup;
+  MPI_Comm_dup(comm.mpi_comm(),&dup);
+  m_comm = ekat::Comm(dup);
+
+  m_is_server = comm.rank()>=num_clients;
+
+  // Note: the local comm is not freed here, since clients keep using it for the model
+  MPI_Comm local;
+  MPI_Comm_split(comm.mpi_comm(),m_is_server ? 1 : 0,comm.rank(),&local);
+  m_local_comm = ekat::Comm(local);
+
+  // Server s handles the clients in [block_beg(s),block_beg(s+1))
+  auto block_beg = [&](const int s) {
+    return static_cast<int>(static_cast<long long>(s)*num_clients/num_servers);
+  };
+  if (m_is_server) {
+    const int s = comm.rank() - num_clients;
+    for (int r=block_beg(s); r<block_beg(s+1); ++r) {
+      m_clients.push_back(r);
+    }
+  } else {
+    int s = 0;
+    while (block_beg(s+1)<=comm.rank()) {
+      ++s;
+    }
+    m_server = num_clients + s;
+    m_first_in_block = comm.rank()==block_beg(s);
+  }
+}
+
+InTransitChannel::
+~InTransitChannel ()
+{
+  MPI_Waitall(2,m_send_reqs,MPI_STATUSES_IGNORE);
+  for (auto& req : m_recv_reqs) {
+    if (req!=MPI_REQUEST_NULL) {
+      MPI_Cancel(&req);
+      MPI_Request_free(&req);
+    }
+  }
+
+  auto comm = m_comm.mpi_comm();
+  MPI_Comm_free(&comm);
+}
+
+void InTransitChannel::
+send_fields (const ProfilingArchive& archive,
+             const std::vector<std::string>& tracked)
+{
+  EKAT_REQUIRE_MSG (not m_is_server,
+      "Error! InTransitChannel::send_fields can only be called on model ranks.\n");
+
+  // Metadata goes in a text message, data of non tracked fields in a binary one
+  std::ostringstream meta;
+  std::vector<char> data;
+  const auto& names = archive.get_fields_names();
+  meta << names.size() << "\n";
+  for (const auto& n : names) {
+    const auto& f = archive.get_field(n);
+    const auto& fl = f.layout();
+    const bool is_tracked = std::find(tracked.begin(),tracked.end(),n)!=tracked.end();
+
+    meta << n << " " << fl.rank();
+    for (int i=0; i<fl.rank(); ++i) {
+      meta << " " << fl.extent(i) << " " << fl.name(i);
+    }
+    meta << " " << f.nparts() << " " << f.part_dim() << " " << f.part_dim_alloc_size()
+         << " " << static_cast<int>(f.data_type()) << " " << is_tracked;
+    for (int p=0; p<f.nparts(); ++p) {
+      meta << " " << (fl.rank()==0 ? 1 : f.part_layout(p).extent(f.part_dim()));
+    }
+    meta << "\n";
+
+    // Replicated fields are only needed from one client
+    if (not fl.has_dim("ncol") and not m_first_in_block) {
+      continue;
+    }
+    for (int p=0; p<f.nparts(); ++p) {
+      const size_t bytes = size_of(f.data_type())*f.part_layout(p).alloc_size();
+      if (is_tracked) {
+        m_slots.push_back(PartSlot{f,p,bytes});
+        m_step_bytes += bytes;
+      } else {
+        const auto src = part_bytes(f,p);
+        data.insert(data.end(),src,src+bytes);
+      }
+    }
+  }
+
+  const auto meta_str = meta.str();
+  check_msg_size(data.size());
+  MPI_Send(meta_str.data(),meta_str.size(),MPI_CHAR,m_server,MetaTag,m_comm.mpi_comm());
+  MPI_Send(data.data(),data.size(),MPI_CHAR,m_server,DataTag,m_comm.mpi_comm());
+
+  const size_t step_msg_size = HdrSize*sizeof(int) + m_step_bytes;
+  check_msg_size(step_msg_size);
+  for (auto& buf : m_send_bufs) {
+    buf.resize(step_msg_size);
+  }
+}
+
+void InTransitChannel::
+send_step (const TimeStamp& time)
+{
+  // Only wait if the send of two steps ago is still in flight
+  const int ibuf = m_num_steps % 2;
+  auto& buf = m_send_bufs[ibuf];
+  MPI_Wait(&m_send_reqs[ibuf],MPI_STATUS_IGNORE);
+
+  const int hdr[HdrSize] = {0, time.ymd(), time.tod()};
+  std::memcpy(buf.data(),hdr,sizeof(hdr));
+  size_t offset = sizeof(hdr);
+  for (const auto& s : m_slots) {
+    std::memcpy(buf.data()+offset,part_bytes(s.field,s.part),s.bytes);
+    offset += s.bytes;
+  }
+
+  MPI_Isend(buf.data(),buf.size(),MPI_CHAR,m_server,StepTag,m_comm.mpi_comm(),&m_send_reqs[ibuf]);
+  ++m_num_steps;
+}
+
+void InTransitChannel::
+send_done ()
+{
+  MPI_Waitall(2,m_send_reqs,MPI_STATUSES_IGNORE);
+
+  const int hdr[HdrSize] = {1, 0, 0};
+  MPI_Send(hdr,sizeof(hdr),MPI_CHAR,m_server,StepTag,m_comm.mpi_comm());
+}
+
+void InTransitChannel::
+recv_fields (ProfilingArchive& archive)
+{
+  EKAT_REQUIRE_MSG (m_is_server,
+      "Error! InTransitChannel::recv_fields can only be called on in-transit ranks.\n");
+
+  const int nclients = m_clients.size();
+  std::vector<std::vector<FieldInfo>> infos(nclients);
+  std::vector<std::vector<char>> data(nclients);
+  for (int k=0; k<nclients; ++k) {
+    const auto meta_buf = recv_any_size(m_clients[k],MetaTag,m_comm.mpi_comm());
+    data[k] = recv_any_size(m_clients[k],DataTag,m_comm.mpi_comm());
+
+    std::istringstream meta (std::string(meta_buf.begin(),meta_buf.end()));
+    size_t nfields;
+    meta >> nfields;
+    infos[k].resize(nfields);
+    for (auto& info : infos[k]) {
+      int rank, dt;
+      meta >> info.name >> rank;
+      info.dims.resize(rank);
+      info.dimnames.resize(rank);
+      for (int i=0; i<rank; ++i) {
+        meta >> info.dims[i] >> info.dimnames[i];
+      }
+      meta >> info.nparts >> info.part_dim >> info.part_dim_alloc_size >> dt >> info.tracked;
+      info.data_type = static_cast<DataType>(dt);
+      info.part_extents.resize(info.nparts);
+      for (auto& e : info.part_extents) {
+        meta >> e;
+      }
+    }
+    EKAT_REQUIRE_MSG (infos[k].size()==infos[0].size(),
+        "Error! Model ranks registered a different number of fields.\n"
+        "  - rank " + std::to_string(m_clients[0]) + ": " + std::to_string(infos[0].size()) + "\n"
+        "  - rank " + std::to_string(m_clients[k]) + ": " + std::to_string(infos[k].size()) + "\n");
+  }
+
+  m_client_slots.resize(nclients);
+  std::vector<size_t> data_offset(nclients,0);
+  for (size_t i=0; i<infos[0].size(); ++i) {
+    const auto& info0 = infos[0][i];
+    for (int k=1; k<nclients; ++k) {
+      const auto& info = infos[k][i];
+      EKAT_REQUIRE_MSG (info.name==info0.name and info.dimnames==info0.dimnames and
+                        info.part_dim==info0.part_dim and info.data_type==info0.data_type and
+                        info.part_dim_alloc_size==info0.part_dim_alloc_size and
+                        info.tracked==info0.tracked,
+          "Error! Model ranks registered inconsistent fields.\n"
+          "  - rank " + std::to_string(m_clients[0]) + " field: " + info0.name + "\n"
+          "  - rank " + std::to_string(m_clients[k]) + " field: " + info.name + "\n");
+    }
+
+    // Fields with an 'ncol' dimension are concatenated along it. Fields partitioned
+    // along another dimension cannot be concatenated this way.
+    auto it = std::find(info0.dimnames.begin(),info0.dimnames.end(),"ncol");
+    const bool decomposed = it!=info0.dimnames.end();
+    const int col_dim = std::distance(info0.dimnames.begin(),it);
+    const bool split_cols = decomposed and info0.part_dim==col_dim;
+
+    Field f;
+    std::vector<int> extents;
+    if (decomposed) {
+      auto dims = info0.dims;
+      dims[col_dim] = 0;
+      for (int k=0; k<nclients; ++k) {
+        const auto& info = infos[k][i];
+        EKAT_REQUIRE_MSG (split_cols or (info.nparts==1 and info.part_dim_alloc_size==-1),
+            "Error! In-transit ranks only support fields partitioned along 'ncol'.\n"
+            "  - field name: " + info.name + "\n"
+            "  - part dim  : " + info.dimnames[info.part_dim] + "\n");
+        dims[col_dim] += info.dims[col_dim];
+        if (split_cols) {
+          extents.insert(extents.end(),info.part_extents.begin(),info.part_extents.end());
+        } else {
+          extents.push_back(info.dims[col_dim]);
+        }
+      }
+      f = Field(info0.name,FieldLayout(dims,info0.dimnames),extents.size(),col_dim,
+                DataAccess::Copy,info0.data_type,split_cols ? info0.part_dim_alloc_size : -1);
+    } else {
+      extents = info0.part_extents;
+      f = Field(info0.name,FieldLayout(info0.dims,info0.dimnames),info0.nparts,info0.part_dim,
+                DataAccess::Copy,info0.data_type,info0.part_dim_alloc_size);
+    }
+    for (size_t p=0; p<extents.size(); ++p) {
+      f.set_part_extent(p,extents[p]);
+    }
+    archive.commit_field(f);
+
+    // Parts are stored one client after the other
+    int ipart = 0;
+    for (int k=0; k<(decomposed ? nclients : 1); ++k) {
+      for (int p=0; p<infos[k][i].nparts; ++p, ++ipart) {
+        const size_t bytes = size_of(f.data_type())*f.part_layout(ipart).alloc_size();
+        if (info0.tracked) {
+          m_client_slots[k].push_back(PartSlot{f,ipart,bytes});
+        } else {
+          EKAT_REQUIRE_MSG (data_offset[k]+bytes<=data[k].size(),
+              "Error! Not enough data received for field '" + f.name() + "'.\n");
+          std::memcpy(part_bytes_nonconst(f,ipart),data[k].data()+data_offset[k],bytes);
+          data_offset[k] += bytes;
+        }
+      }
+    }
+
+    archive.add_field(f);
+  }
+
+  // Size the buffers, and post the receives of the first step
+  m_recv_bufs.resize(nclients);
+  m_recv_reqs.resize(nclients,MPI_REQUEST_NULL);
+  for (int k=0; k<nclients; ++k) {
+    size_t size = HdrSize*sizeof(int);
+    for (const auto& s : m_client_slots[k]) {
+      size += s.bytes;
+    }
+    m_recv_bufs[k].resize(size);
+  }
+  post_recvs();
+}
+
+bool InTransitChannel::
+recv_step (TimeStamp& time)
+{
+  const int nclients = m_clients.size();
+  MPI_Waitall(nclients,m_recv_reqs.data(),MPI_STATUSES_IGNORE);
+
+  int hdr0[HdrSize];
+  std::memcpy(hdr0,m_recv_bufs[0].data(),sizeof(hdr0));
+  for (int k=1; k<nclients; ++k) {
+    int hdr[HdrSize];
+    std::memcpy(hdr,m_recv_bufs[k].data(),sizeof(hdr));
+    EKAT_REQUIRE_MSG (std::equal(hdr,hdr+HdrSize,hdr0),
+        "Error! Model ranks are out of sync.\n"
+        "  - rank " + std::to_string(m_clients[0]) + " step: " +
+          (hdr0[HdrDone] ? "done" : TimeStamp(hdr0[HdrYmd],hdr0[HdrTod]).to_string()) + "\n"
+        "  - rank " + std::to_string(m_clients[k]) + " step: " +
+          (hdr[HdrDone] ? "done" : TimeStamp(hdr[HdrYmd],hdr[HdrTod]).to_string()) + "\n");
+  }
+  if (hdr0[HdrDone]) {
+    return false;
+  }
+  time = TimeStamp(hdr0[HdrYmd],hdr0[HdrTod]);
+
+  for (int k=0; k<nclients; ++k) {
+    size_t offset = HdrSize*sizeof(int);
+    for (auto& s : m_client_slots[k]) {
+      std::memcpy(part_bytes_nonconst(s.field,s.part),m_recv_bufs[k].data()+offset,s.bytes);
+      offset += s.bytes;
+    }
+  }
+
+  // Data of the next step can arrive while this step's stats are computed
+  post_recvs();
+  return true;
+}
+
+void InTransitChannel::post_recvs ()
+{
+  for (size_t k=0; k<m_clients.size(); ++k) {
+    MPI_Irecv(m_recv_bufs[k].data(),m_recv_bufs[k].size(),MPI_CHAR,
+              m_clients[k],StepTag,m_comm.mpi_comm(),&m_recv_reqs[k]);
+  }
+}
+
+void InTransitChannel::report () const
+{
+  const double times[2] = {m_is_server ? 0 : m_busy_time, m_is_server ? m_busy_time : 0};
+  double max_times[2];
+  MPI_Reduce(times,max_times,2,MPI_DOUBLE,MPI_MAX,0,m_comm.mpi_comm());
+  if (m_comm.am_i_root()) {
+    printf(" [CLDERA] In-transit analysis:\n"
+           "   - time spent by model ranks shipping fields: %.3f s\n"
+           "   - time spent by in-transit ranks on stats  : %.3f s\n"
+           "   - time saved on model ranks                : %.3f s\n",
+           max_times[0],max_times[1],max_times[1]-max_times[0]);
+  }
+}
+
+} // namespace cldera
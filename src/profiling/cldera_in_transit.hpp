@@ -0,0 +1,115 @@
+#ifndef CLDERA_IN_TRANSIT_HPP
+#define CLDERA_IN_TRANSIT_HPP
+
+#include "cldera_field.hpp"
+#include "cldera_time_stamp.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace cldera {
+
+class ProfilingArchive;
+
+/*
+ * Channel between model ranks and in-transit analysis ranks
+ *
+ * The ranks of the input comm are split in two groups: the first ones keep
+ * running the model (clients), while the last 'num_servers' ones (servers)
+ * only compute stats, store them in the archive, and run pathway tests.
+ * Each server handles a contiguous block of clients, and assembles their
+ * fields as if it owned all their columns: fields with an 'ncol' dimension
+ * are concatenated along it (one part for each client part), while fields
+ * without it are assumed to be replicated across ranks, and are only sent
+ * by the first client of the block.
+ *
+ * Clients send the fields metadata once, when fields are committed, together
+ * with the data of the fields that are not tracked (e.g., lat, area, col_gids),
+ * which are assumed not to change during the run. At each step, clients copy
+ * the tracked fields in a send buffer, and ship it with a nonblocking send,
+ * so the model can go on right away. There are two send buffers, so a client
+ * only waits if its server is more than one step behind. Servers post the
+ * receives for the next step before computing the stats of the current one.
+ */
+
+class InTransitChannel
+{
+public:
+  InTransitChannel (const ekat::Comm& comm, const int num_servers);
+
+  ~InTransitChannel ();
+
+  bool is_server () const { return m_is_server; }
+
+  // On clients, the comm of the model ranks, on servers the comm of the analysis ranks
+  const ekat::Comm& get_local_comm () const { return m_local_comm; }
+
+  // Client side
+  void send_fields (const ProfilingArchive& archive,
+                    const std::vector<std::string>& tracked);
+  void send_step (const TimeStamp& time);
+  void send_done ();
+
+  // Server side. Fields are added to the archive already committed.
+  // recv_step returns false once the clients are done.
+  void recv_fields (ProfilingArchive& archive);
+  bool recv_step (TimeStamp& time);
+
+  // Time spent shipping fields (on clients) or computing stats (on servers)
+  void add_busy_time (const double t) { m_busy_time += t; }
+
+  // Print (on root) the max busy time of clients and of servers.
+  // Must be called by all ranks.
+  void report () const;
+
+private:
+  enum : int {
+    MetaTag = 0,
+    DataTag = 1,
+    StepTag = 2
+  };
+
+  // Header of a step message
+  enum : int {
+    HdrDone = 0,
+    HdrYmd  = 1,
+    HdrTod  = 2,
+    HdrSize = 3
+  };
+
+  void post_recvs ();
+
+  // A field part shipped at every step
+  struct PartSlot {
+    Field   field;
+    int     part;
+    size_t  bytes;
+  };
+
+  ekat::Comm                          m_comm;       // Duplicate of the input comm
+  ekat::Comm                          m_local_comm;
+  bool                                m_is_server;
+
+  // Client side: server rank (in m_comm), slots to pack, and double buffering
+  int                                 m_server = -1;
+  bool                                m_first_in_block = false;
+  std::vector<PartSlot>               m_slots;
+  size_t                              m_step_bytes = 0;
+  std::vector<char>                   m_send_bufs[2];
+  MPI_Request                         m_send_reqs[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+  int                                 m_num_steps = 0;
+
+  // Server side: clients ranks (in m_comm), and slots to unpack for each of them
+  std::vector<int>                    m_clients;
+  std::vector<std::vector<PartSlot>>  m_client_slots;
+  std::vector<std::vector<char>>      m_recv_bufs;
+  std::vector<MPI_Request>            m_recv_reqs;
+
+  double                              m_busy_time = 0;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_IN_TRANSIT_HPP
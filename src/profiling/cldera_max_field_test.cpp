@@ -18,7 +18,7 @@ MaxFieldTest::MaxFieldTest(const std::string& name,
 
 bool MaxFieldTest::test(const TimeStamp& t)
 {
-  const auto field_max = m_max_stat->compute(t);
+  const auto& field_max = m_max_stat->compute(t);
   if (field_max.data<Real>()[0] > m_max)
   {
     if(m_save_history_on_failure)
@@ -18,7 +18,7 @@ MinFieldTest::MinFieldTest(const std::string& name,
 
 bool MinFieldTest::test(const TimeStamp& t)
 {
-  const auto field_min = m_min_stat->compute(t);
+  const auto& field_min = m_min_stat->compute(t);
   if (field_min.data<Real>()[0] < m_min)
   {
     if(m_save_history_on_failure)
@@ -1,4 +1,5 @@
 #include "cldera_profiling_archive.hpp"
+#include "profiling/cldera_column_decomp.hpp"
 #include "profiling/stats/cldera_field_stat.hpp"
 #include "profiling/cldera_mpi_timing_wrappers.hpp"
 #include "timing/cldera_timing_session.hpp"
@@ -8,11 +9,62 @@
 #include <ekat/util/ekat_string_utils.hpp>
 #include <ekat/ekat_assert.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <numeric>
 #include <fstream>
+#include <sstream>
+#include <type_traits>
 
 namespace cldera {
 
+namespace {
+
+// Round the mantissa of the input values to the number of bits needed to store
+// nsd significant decimal digits (bit rounding), zeroing the trailing bits.
+template<typename T>
+void bit_round (T* data, const int n, const int nsd)
+{
+  using uint_t = typename std::conditional<sizeof(T)==4,std::uint32_t,std::uint64_t>::type;
+  constexpr int mantissa_bits = std::numeric_limits<T>::digits - 1;
+  const int keep = std::ceil(nsd*std::log2(10.0));
+  if (nsd<=0 or keep>=mantissa_bits) {
+    return;
+  }
+  const int drop = mantissa_bits - keep;
+  const uint_t half = uint_t(1) << (drop-1);
+  const uint_t mask = ~((uint_t(1) << drop) - 1);
+  for (int i=0; i<n; ++i) {
+    if (not std::isfinite(data[i])) {
+      continue;
+    }
+    uint_t bits;
+    std::memcpy(&bits,&data[i],sizeof(T));
+    bits = (bits + half) & mask;
+    std::memcpy(&data[i],&bits,sizeof(T));
+  }
+}
+
+// Store size values in the slot-th record of a records buffer (holding
+// capacity records), converting to the data type on file
+template<typename T, typename ST>
+void store_record (const ST* data, const int size, const int slot,
+                   const int capacity, const int nsd, std::vector<char>& records)
+{
+  records.resize(sizeof(T)*size*capacity);
+  auto out = reinterpret_cast<T*>(records.data()) + slot*size;
+  std::copy(data,data+size,out);
+  if (std::is_floating_point<T>::value) {
+    bit_round(out,size,nsd);
+  }
+}
+
+} // anonymous namespace
+
 ProfilingArchive::
 ProfilingArchive(const ekat::Comm& comm,
                  const TimeStamp& case_t0,
@@ -21,51 +73,275 @@ ProfilingArchive(const ekat::Comm& comm,
  : m_comm (comm)
  , m_params (params)
  , m_case_t0 (case_t0)
+ , m_run_t0 (run_t0)
 {
   using intvec_t = std::vector<int>;
+  using strvec_t = std::vector<std::string>;
+  m_output_format.dtype = m_params.get<std::string>("Output Precision",io::pnetcdf::get_io_dtype_name<Real>());
+  m_output_format.nsd   = m_params.get<int>("Significant Digits",0);
+  EKAT_REQUIRE_MSG (m_output_format.dtype=="double" or m_output_format.dtype=="float",
+      "[ProfilingArchive] Error! Invalid Output Precision (must be 'double' or 'float').\n"
+      "  - Output Precision: " + m_output_format.dtype + "\n");
+
+  const auto& time_avg_sizes = m_params.get<intvec_t>("time_averaging_window_sizes",intvec_t(1,1));
+  const auto& calendar_windows = m_params.get<strvec_t>("time_averaging_calendar_windows",strvec_t());
+  for (const auto& cal : calendar_windows) {
+    EKAT_REQUIRE_MSG (cal=="daily" or cal=="monthly",
+        "[ProfilingArchive] Error! Invalid calendar averaging window (must be 'daily' or 'monthly').\n"
+        "  - window: " + cal + "\n");
+  }
+
   if (m_params.get<bool>("Enable Output",true)) {
-    const auto& prefix = m_params.get<std::string>("filename_prefix","cldera_stats");
-    std::string filename;
-    io::pnetcdf::IOMode mode = io::pnetcdf::IOMode::Invalid;
+    // Async output needs to call MPI from the I/O thread, on a separate comm
+    m_io_comm = m_comm;
+    m_async = m_params.get("Async Output",false);
+    if (m_async) {
+      int provided;
+      MPI_Query_thread(&provided);
+      if (provided<MPI_THREAD_MULTIPLE) {
+        if (m_comm.am_i_root()) {
+          printf(" [CLDERA] WARNING: async output requires MPI_THREAD_MULTIPLE. Using sync output.\n");
+        }
+        m_async = false;
+      } else {
+        MPI_Comm io_comm;
+        MPI_Comm_dup(m_comm.mpi_comm(),&io_comm);
+        m_io_comm = ekat::Comm(io_comm);
+        m_io_thread = std::thread(&ProfilingArchive::io_thread_loop,this);
+      }
+    }
 
-    const auto& time_avg_sizes = m_params.get<intvec_t>("time_averaging_window_sizes",intvec_t(1,1));
-    m_num_streams = time_avg_sizes.size();
+    m_num_streams = time_avg_sizes.size() + calendar_windows.size();
     for (auto s : time_avg_sizes) {
-
       auto suffix = s==1 ? std::string(".INSTANT") : ".AVERAGE.nsteps_x" + std::to_string(s);
-      if (m_case_t0==run_t0) {
-        filename = prefix + suffix + "." + m_case_t0.to_string();
-        mode = io::pnetcdf::IOMode::Write;
-      } else {
-        filename = prefix + suffix + "." + m_case_t0.to_string();
-        mode = io::pnetcdf::IOMode::Append;
-        if (not std::ifstream(filename).good() or m_params.get("force_new_file",true)) {
-          filename = prefix + suffix + "." + run_t0.to_string();
-          mode = io::pnetcdf::IOMode::Write;
+      add_stream(open_output_file(suffix),s,"",run_t0);
+    }
+    for (const auto& cal : calendar_windows) {
+      add_stream(open_output_file(".AVERAGE." + cal),0,cal,run_t0);
+    }
+    setup_streams_hierarchy();
+  }
+}
+
+ProfilingArchive::
+~ProfilingArchive()
+{
+  flush();
+
+  if (m_async) {
+    {
+      std::lock_guard<std::mutex> lock(m_io_mutex);
+      m_io_stop = true;
+    }
+    m_io_cv.notify_all();
+    m_io_thread.join();
+
+    if (m_comm.am_i_root()) {
+      printf(" [CLDERA] Async output: %.3f s spent writing, %.3f s waiting for the I/O thread\n",
+             m_io_time,m_io_wait_time);
+    }
+  }
+
+  for (auto& f : m_output_files) {
+    if (f) {
+      io::pnetcdf::close_file(*f);
+    }
+  }
+
+  if (m_async) {
+    auto io_comm = m_io_comm.mpi_comm();
+    MPI_Comm_free(&io_comm);
+  }
+}
+
+void ProfilingArchive::
+add_stream (const ncfile_ptr& file, const int time_avg_window_size,
+            const std::string& calendar, const TimeStamp& beg)
+{
+  m_output_files.push_back(file);
+  m_time_avg_window_size.push_back(time_avg_window_size);
+  m_time_avg_curr_count.push_back(0);
+  m_time_avg_beg.push_back(beg);
+  m_time_avg_end.push_back(beg);
+  m_time_avg_calendar.push_back(calendar);
+  m_time_avg_parent.push_back(-1);
+  m_fields_stats.emplace_back();
+  m_stream_updated.push_back(false);
+  m_flush_capacity.push_back(0);
+  m_pending.emplace_back();
+  m_ready.emplace_back();
+  m_packed_scalars.emplace_back();
+  m_io_dtypes.emplace_back();
+}
+
+void ProfilingArchive::setup_streams_hierarchy ()
+{
+  // Fixed-size windows nest in the windows of any size dividing theirs, while
+  // months are made of days. Among the candidates, pick the coarsest parent.
+  // Instantaneous streams are never parents, since they hold no sums.
+  for (int i=0; i<m_num_streams; ++i) {
+    const auto& cal = m_time_avg_calendar[i];
+    const int n = m_time_avg_window_size[i];
+    auto& parent = m_time_avg_parent[i];
+    for (int j=0; j<m_num_streams; ++j) {
+      if (cal=="monthly") {
+        if (m_time_avg_calendar[j]=="daily") {
+          parent = j;
+        }
+      } else if (cal=="" and m_time_avg_calendar[j]=="") {
+        const int nj = m_time_avg_window_size[j];
+        if (nj>1 and nj<n and n%nj==0 and (parent==-1 or nj>m_time_avg_window_size[parent])) {
+          parent = j;
         }
       }
-      m_output_files.push_back(open_file (filename+".nc", m_comm, mode));
+    }
+  }
 
-      // Init the beg/end vector of each averaging window
-      m_time_avg_beg.resize(m_num_streams,run_t0);
-      m_time_avg_end.resize(m_num_streams);
+  // Parents must complete their windows before their children check theirs:
+  // fixed-size windows by increasing size, then daily, then monthly
+  auto level = [&](const int i) {
+    const auto& cal = m_time_avg_calendar[i];
+    return cal=="" ? 0 : (cal=="daily" ? 1 : 2);
+  };
+  m_streams_order.resize(m_num_streams);
+  std::iota(m_streams_order.begin(),m_streams_order.end(),0);
+  std::stable_sort(m_streams_order.begin(),m_streams_order.end(),
+                   [&](const int i, const int j) {
+    return std::make_pair(level(i),m_time_avg_window_size[i]) <
+           std::make_pair(level(j),m_time_avg_window_size[j]);
+  });
+}
 
-      m_time_avg_window_size.push_back(s);
-      m_time_avg_curr_count.push_back(0);
+bool ProfilingArchive::
+window_completed (const int istream, const TimeStamp& ts) const
+{
+  // A step ending exactly at midnight still belongs to the previous day
+  const auto& cal = m_time_avg_calendar[istream];
+  const auto& beg = m_time_avg_beg[istream];
+  const int count = m_time_avg_curr_count[istream];
+  if (cal=="daily") {
+    return count>0 and ts.ymd()!=beg.ymd();
+  } else if (cal=="monthly") {
+    return count>0 and ts.ymd()/100!=beg.ymd()/100;
+  }
+  return count==m_time_avg_window_size[istream];
+}
+
+void ProfilingArchive::
+accumulate_window (const int src, const int dst)
+{
+  const bool first = m_time_avg_curr_count[dst]==0;
+  for (const auto& it1 : m_fields_stats[src]) {
+    for (const auto& it2 : it1.second) {
+      const auto& sum = it2.second;
+      auto& s = m_fields_stats[dst][it1.first][it2.first];
+      if (not s.committed()) {
+        s = sum.clone();
+      }
+
+      if (first) {
+        s.deep_copy(sum);
+      } else {
+        s.update(sum,1.0,1.0);
+      }
     }
-    m_fields_stats.resize(m_num_streams);
   }
+  m_time_avg_curr_count[dst] += m_time_avg_curr_count[src];
+  m_stream_updated[dst] = true;
+}
+
+void ProfilingArchive::flush ()
+{
+  for (size_t i=0; i<m_output_files.size(); ++i) {
+    flush_stream(i);
+  }
+  wait_for_io();
+}
+
+void ProfilingArchive::io_thread_loop ()
+{
+  std::unique_lock<std::mutex> lock(m_io_mutex);
+  while (true) {
+    m_io_cv.wait(lock,[&]{ return m_io_stop or m_io_job; });
+    if (not m_io_job) {
+      return;
+    }
+    auto job = std::move(m_io_job);
+    m_io_job = nullptr;
+
+    lock.unlock();
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+      job();
+    } catch (...) {
+      m_io_error = std::current_exception();
+    }
+    const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+    lock.lock();
+
+    m_io_time += dt.count();
+    m_io_busy = false;
+    m_io_cv.notify_all();
+  }
+}
+
+void ProfilingArchive::submit_io (const std::function<void()>& job)
+{
+  if (not m_async) {
+    job();
+    return;
+  }
+
+  wait_for_io();
+  {
+    std::lock_guard<std::mutex> lock(m_io_mutex);
+    m_io_job = job;
+    m_io_busy = true;
+  }
+  m_io_cv.notify_all();
 }
 
+void ProfilingArchive::wait_for_io ()
+{
+  if (not m_async) {
+    return;
+  }
+
+  auto& timings = timing::TimingSession::instance();
+  timings.start_timer("profiling::io_wait");
+  const auto t0 = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(m_io_mutex);
+  m_io_cv.wait(lock,[&]{ return not m_io_busy; });
+  const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+  m_io_wait_time += dt.count();
+  timings.stop_timer("profiling::io_wait");
+
+  if (m_io_error) {
+    auto err = m_io_error;
+    m_io_error = nullptr;
+    std::rethrow_exception(err);
+  }
+}
+
+ProfilingArchive::ncfile_ptr
 ProfilingArchive::
-~ProfilingArchive()
+open_output_file (const std::string& suffix) const
 {
-  for (int i=0; i<m_num_streams; ++i) {
-    auto& f = m_output_files[i];
-    if (f) {
-      io::pnetcdf::close_file(*f);
+  const auto& prefix = m_params.get<std::string>("filename_prefix","cldera_stats");
+  std::string filename;
+  io::pnetcdf::IOMode mode = io::pnetcdf::IOMode::Invalid;
+  if (m_case_t0==m_run_t0) {
+    filename = prefix + suffix + "." + m_case_t0.to_string();
+    mode = io::pnetcdf::IOMode::Write;
+  } else {
+    filename = prefix + suffix + "." + m_case_t0.to_string();
+    mode = io::pnetcdf::IOMode::Append;
+    if (not std::ifstream(filename).good() or m_params.get("force_new_file",true)) {
+      filename = prefix + suffix + "." + m_run_t0.to_string();
+      mode = io::pnetcdf::IOMode::Write;
     }
   }
+  return open_file (filename+".nc", m_io_comm, mode);
 }
 
 void ProfilingArchive::
@@ -83,7 +359,7 @@ setup_output_file (const int istream)
   // Add time dimension
   io::pnetcdf::add_time (file,"double");
 
-  if (m_time_avg_window_size[istream]>1) {
+  if (is_averaging(istream)) {
     io::pnetcdf::add_dim(file, "dim2", 2);
     // We save the start/end of each averaging window
     io::pnetcdf::add_var (file,
@@ -92,15 +368,37 @@ setup_output_file (const int istream)
                           {"dim2"},
                           true);
 
-    io::pnetcdf::set_att(file,"averaging_window_size","NC_GLOBAL",m_time_avg_window_size[istream]);
+    if (m_time_avg_calendar[istream]!="") {
+      io::pnetcdf::set_att(file,"averaging_window","NC_GLOBAL",m_time_avg_calendar[istream]);
+    } else {
+      io::pnetcdf::set_att(file,"averaging_window_size","NC_GLOBAL",m_time_avg_window_size[istream]);
+    }
   }
 
   io::pnetcdf::set_att(file,"start_date","NC_GLOBAL",m_case_t0.ymd());
   io::pnetcdf::set_att(file,"start_time","NC_GLOBAL",m_case_t0.tod());
 
+  // If requested, real scalar stats are not stored in their own var, but as
+  // columns of a single (time,nscalar) var, to cut the per-var overhead
+  const bool pack_scalars = m_params.get("Pack Scalar Stats",false);
+  auto& packed = m_packed_scalars[istream];
+  std::vector<std::string> packed_names;
   for (const auto& it1 : m_fields_stats[istream]) {
     for (const auto& it2 : it1.second) {
       const auto& stat  = it2.second;
+      if (pack_scalars and stat.layout().rank()==0 and stat.data_type()==DataType::RealType) {
+        // All packed stats share the var precision, but each can keep its own nsd
+        EKAT_REQUIRE_MSG (get_output_format(it1.first,stat.name()).dtype==m_output_format.dtype,
+            "[ProfilingArchive::setup_output_file] Error! Packed scalar stats must use the stream output precision.\n"
+            "  - field name: " + it1.first + "\n"
+            "  - stat name : " + stat.name() + "\n"
+            "  - stat precision  : " + get_output_format(it1.first,stat.name()).dtype + "\n"
+            "  - stream precision: " + m_output_format.dtype + "\n"
+            "  Either remove the stat output_precision, or set 'Pack Scalar Stats' to false.\n");
+        packed[stat.name()] = packed_names.size();
+        packed_names.push_back(stat.name());
+        continue;
+      }
       const auto& stat_layout = stat.layout();
       const auto& stat_dims = stat_layout.dims();
       const auto& stat_names = stat_layout.names();
@@ -115,7 +413,7 @@ setup_output_file (const int istream)
 
       std::string io_dtype;
       if (stat.data_type()==DataType::RealType) {
-        io_dtype = io::pnetcdf::get_io_dtype_name<Real>();
+        io_dtype = get_output_format(it1.first,stat.name()).dtype;
       } else if (stat.data_type()==DataType::IntType) {
         io_dtype = io::pnetcdf::get_io_dtype_name<int>();
       } else {
@@ -131,6 +429,16 @@ setup_output_file (const int istream)
     }
   }
 
+  if (packed_names.size()>0) {
+    io::pnetcdf::add_dim (file, "nscalar", packed_names.size());
+    io::pnetcdf::add_var (file,
+                          "scalar_stats",
+                          m_output_format.dtype,
+                          {"nscalar"},
+                          true);
+    io::pnetcdf::set_att (file,"stat_names","scalar_stats",ekat::join(packed_names,","));
+  }
+
   // List of fields (not stats) that we may need to write.
   // These are geometry-dep fields, like lat, lon, proc-rank,...
   std::list<std::string> non_stat_fields_to_write;
@@ -175,28 +483,8 @@ setup_output_file (const int istream)
 
   io::pnetcdf::enddef (file);
   if (needs_decomp) {
-    auto f = get_field("col_gids");
-    EKAT_REQUIRE_MSG (f.layout().rank()==1,
-        "Error! Wrong layout for field 'col_gids'.\n"
-        "  - expected layout: (ncol)\n"
-        "  - actual layout  : (" + ekat::join(f.layout().names(),",") + ")\n");
-
-    // Compute min gid. This is 1 in E3SM, but just in case...
-    auto min_stat = StatFactory::instance().create("global_min",m_comm,ekat::ParameterList("global_min"));
-    min_stat->set_field(f);
-    min_stat->create_stat_field();
-    auto min_gid = min_stat->compute(m_case_t0).data<int>()[0];
-
-    int my_ngids = f.layout().size();
-    std::vector<int> gids(my_ngids);
-    for (int p=0,i=0; p<f.nparts(); ++p) {
-      const auto pl = f.part_layout(p);
-      const auto pdata = f.part_data<int>(p);
-      for (int j=0; j<pl.size(); ++j,++i) {
-        gids[i] = pdata[j] - min_gid;
-      }
-    }
-    io::pnetcdf::add_decomp (file,"ncol",gids);
+    // All streams (and masks, and reference data) share the same decomp
+    ColumnDecomp::get(m_comm,get_field("col_gids"))->attach(file);
   }
 
   // Immediately write the non-time dep fields
@@ -258,35 +546,175 @@ get_field (const std::string& name)
 void ProfilingArchive::
 update_stat (const std::string& fname, const std::string& stat_name,
              const Field& stat)
+{
+  update_stat(get_stat_handle(fname,stat_name),stat);
+}
+
+int ProfilingArchive::
+get_stat_handle (const std::string& fname, const std::string& stat_name)
 {
   EKAT_REQUIRE_MSG (has_field(fname),
-      "[ProfilingArchive::get_field] Error! Field '" + fname + "' not found.\n"
+      "[ProfilingArchive::get_stat_handle] Error! Field '" + fname + "' not found.\n"
       "  List of current fields: " + ekat::join(m_fields_names,", "));
 
-  for (int i=0; i<m_num_streams; ++i) {
-    auto& s = m_fields_stats[i][fname][stat_name];
-    if (not s.committed()) {
-      // It must be the first time we call update_stat for this stat.
-      // Proceed to create the field
-      s = stat.clone();
+  auto& handles = m_stat_handles[fname];
+  auto h = handles.find(stat_name);
+  if (h!=handles.end()) {
+    return h->second;
+  }
+
+  // Stats with a cadence only go in their cadence stream
+  int beg = 0;
+  int end = m_num_streams;
+  auto it = m_stat_cadence_stream.find(fname);
+  if (it!=m_stat_cadence_stream.end() and it->second.count(stat_name)>0) {
+    beg = it->second.at(stat_name);
+    end = beg+1;
+  }
+
+  // Streams with a parent accumulate the completed windows of the latter.
+  // Entries of a std::map are never moved, so we can keep their address.
+  StatAccumulators acc;
+  for (int i=beg; i<end; ++i) {
+    if (m_time_avg_parent[i]<0) {
+      acc.streams.push_back(i);
+      acc.fields.push_back(&m_fields_stats[i][fname][stat_name]);
     }
+  }
+
+  const int handle = m_stat_accumulators.size();
+  m_stat_accumulators.push_back(acc);
+  handles[stat_name] = handle;
+  return handle;
+}
 
-    if (m_time_avg_curr_count[i]==0) {
-      s.deep_copy(stat);
+void ProfilingArchive::
+update_stat (const int handle, const Field& stat)
+{
+  EKAT_REQUIRE_MSG (handle>=0 and handle<static_cast<int>(m_stat_accumulators.size()),
+      "[ProfilingArchive::update_stat] Error! Invalid stat handle.\n"
+      "  - handle: " + std::to_string(handle) + "\n");
+
+  const auto& acc = m_stat_accumulators[handle];
+  for (size_t k=0; k<acc.streams.size(); ++k) {
+    const int i = acc.streams[k];
+    auto& s = *acc.fields[k];
+    if (not is_averaging(i)) {
+      // Instantaneous streams simply alias the stat, which is not
+      // modified before it is written, at the end of the time step
+      s = stat;
     } else {
-      s.update(stat,1.0,1.0);
+      if (not s.committed()) {
+        // It must be the first time we call update_stat for this stat.
+        // Proceed to create the field
+        s = stat.clone();
+      }
+
+      if (m_time_avg_curr_count[i]==0) {
+        s.deep_copy(stat);
+      } else {
+        s.update(stat,1.0,1.0);
+      }
     }
+    m_stream_updated[i] = true;
   }
 }
 
-void ProfilingArchive::end_timestep (const TimeStamp& ts) {
+void ProfilingArchive::
+set_stat_cadence (const std::string& fname, const std::string& stat_name,
+                  const std::string& cadence)
+{
+  EKAT_REQUIRE_MSG (has_field(fname),
+      "[ProfilingArchive::set_stat_cadence] Error! Field '" + fname + "' not found.\n"
+      "  List of current fields: " + ekat::join(m_fields_names,", "));
+
+  if (not m_params.get<bool>("Enable Output",true)) {
+    return;
+  }
+
   for (int i=0; i<m_num_streams; ++i) {
-    ++m_time_avg_curr_count[i];
-    if (m_time_avg_curr_count[i]==m_time_avg_window_size[i]) {
+    EKAT_REQUIRE_MSG (m_fields_stats[i][fname].count(stat_name)==0,
+        "[ProfilingArchive::set_stat_cadence] Error! Stat was already updated.\n"
+        "  - field name: " + fname + "\n"
+        "  - stat name : " + stat_name + "\n");
+  }
+
+  if (m_cadence_streams.count(cadence)==0) {
+    // Stat handles keep the address of the stats in the streams,
+    // which may be moved when a stream is added
+    EKAT_REQUIRE_MSG (m_stat_accumulators.empty(),
+        "[ProfilingArchive::set_stat_cadence] Error! Cannot add a cadence once stat handles are created.\n"
+        "  - cadence: " + cadence + "\n");
+
+    // New cadence: add an instantaneous stream for it. The I/O thread
+    // must be idle, since it may access the streams data
+    wait_for_io();
+    m_cadence_streams[cadence] = m_output_files.size();
+    add_stream(open_output_file(".INSTANT." + cadence),1,"",m_run_t0);
+  }
+  m_stat_cadence_stream[fname][stat_name] = m_cadence_streams.at(cadence);
+}
+
+void ProfilingArchive::
+set_stat_output_format (const std::string& fname, const std::string& stat_name,
+                        const std::string& dtype, const int nsd)
+{
+  EKAT_REQUIRE_MSG (has_field(fname),
+      "[ProfilingArchive::set_stat_output_format] Error! Field '" + fname + "' not found.\n"
+      "  List of current fields: " + ekat::join(m_fields_names,", "));
+  EKAT_REQUIRE_MSG (dtype=="" or dtype=="double" or dtype=="float",
+      "[ProfilingArchive::set_stat_output_format] Error! Invalid precision (must be 'double' or 'float').\n"
+      "  - field name: " + fname + "\n"
+      "  - stat name : " + stat_name + "\n"
+      "  - precision : " + dtype + "\n");
+
+  auto& fmt = m_stat_output_format[fname][stat_name];
+  fmt = m_output_format;
+  if (dtype!="") {
+    fmt.dtype = dtype;
+  }
+  if (nsd>=0) {
+    fmt.nsd = nsd;
+  }
+}
+
+ProfilingArchive::OutputFormat ProfilingArchive::
+get_output_format (const std::string& fname, const std::string& stat_name) const
+{
+  auto it = m_stat_output_format.find(fname);
+  if (it!=m_stat_output_format.end() and it->second.count(stat_name)==1) {
+    return it->second.at(stat_name);
+  }
+  return m_output_format;
+}
+
+void ProfilingArchive::end_timestep (const TimeStamp& ts) {
+  // Cadence streams are written only at the steps where their stats were updated,
+  // so that their time axis matches the stats cadence
+  for (int i=m_num_streams; i<static_cast<int>(m_output_files.size()); ++i) {
+    if (m_stream_updated[i]) {
+      m_time_avg_end[i] = ts;
+      write_stream(i);
+      m_time_avg_beg[i] = ts;
+      m_stream_updated[i] = false;
+    }
+  }
+
+  for (int i : m_streams_order) {
+    if (m_time_avg_parent[i]==-1) {
+      ++m_time_avg_curr_count[i];
+    }
+    if (window_completed(i,ts)) {
       // We completed averaging (or window size is 1, meaning no averaging), so
-      //  1. set end of time avg window
-      //  2. write vars
-      //  3. reset beg of time avg window
+      //  1. add the window sums to the streams built on this one
+      //  2. set end of time avg window
+      //  3. write vars
+      //  4. reset beg of time avg window
+      for (int j=0; j<m_num_streams; ++j) {
+        if (m_time_avg_parent[j]==i) {
+          accumulate_window(i,j);
+        }
+      }
       m_time_avg_end[i] = ts;
       write_stream(i);
       m_time_avg_beg[i] = ts;
@@ -300,33 +728,102 @@ void ProfilingArchive::write_stream (const int istream)
   auto& timings = timing::TimingSession::instance();
   timings.start_timer("profiling::write_stream");
 
-  if (m_comm.am_i_root()) {
-    printf(" [CLDERA] Flushing field stats to file ...\n");
-  }
-
   auto& f = *m_output_files[istream];
 
   if (not f.enddef) {
     // We have not setup the output file yet
+    wait_for_io();
     setup_output_file(istream);
   }
 
+  auto& capacity = m_flush_capacity[istream];
+  if (capacity==0) {
+    // When appending to an existing file, recover the packed scalar stats from it
+    if (f.vars.count("scalar_stats")==1 and m_packed_scalars[istream].empty()) {
+      std::string names;
+      io::pnetcdf::get_att(f,"stat_names","scalar_stats",names);
+      std::istringstream ss(names);
+      std::string n;
+      while (std::getline(ss,n,',')) {
+        const int idx = m_packed_scalars[istream].size();
+        m_packed_scalars[istream][n] = idx;
+      }
+    }
+
+    // First write: set how many records we can keep in memory. Records
+    // are stored with the data type on file (which may be float)
+    auto& io_dtypes = m_io_dtypes[istream];
+    long long record_bytes = 3*sizeof(double);
+    for (const auto& it1 : m_fields_stats[istream]) {
+      for (const auto& it2 : it1.second) {
+        const auto& stat = it2.second;
+        const std::string vname = m_packed_scalars[istream].count(stat.name())==1 ? "scalar_stats" : stat.name();
+        const auto& dtype = io_dtypes[vname] = f.vars.at(vname)->dtype;
+        record_bytes += static_cast<long long>(stat.layout().size())*io::pnetcdf::get_dtype_size(dtype);
+      }
+    }
+    const long long max_bytes = m_params.get<int>("Flush Max Bytes",64*1024*1024);
+    const long long max_records = std::max(max_bytes / record_bytes,1LL);
+    capacity = std::min(static_cast<long long>(m_params.get<int>("Flush Frequency",1)),max_records);
+    EKAT_REQUIRE_MSG (capacity>0,
+        "[ProfilingArchive::write_stream] Error! Flush Frequency must be positive.\n"
+        "  - Flush Frequency: " + std::to_string(m_params.get<int>("Flush Frequency",1)) + "\n");
+
+    // Reserve the time records of both the pending and the ready slots, which are swapped at each flush
+    for (auto* r : {&m_pending[istream], &m_ready[istream]}) {
+      r->time.reserve(capacity);
+      r->time_bounds.reserve(2*capacity);
+    }
+
+    // With buffered output, the writes of a flush are only queued, and
+    // completed at once at the end, with larger aggregated requests
+    if (m_params.get("Buffered Output",false) and f.buffer_size==0) {
+      wait_for_io();
+      io::pnetcdf::attach_buffer(f,capacity);
+    }
+  }
+
+  // Copy the stats in the next free slot of the stream records
+  auto& pending = m_pending[istream];
+  const int slot = pending.num;
+  const auto& packed = m_packed_scalars[istream];
+  const int npacked = packed.size();
+  const auto& io_dtypes = m_io_dtypes[istream];
   for (auto& it1 : m_fields_stats[istream]) {
-    const auto& fname = it1.first;
     for (auto& it2: it1.second) {
-      const auto& sname = it2.first;
-            auto& stat  = it2.second;
+      auto& stat = it2.second;
 
-      if (m_time_avg_window_size[istream]>1) {
-        stat.scale (1.0/m_time_avg_window_size[istream]);
+      if (is_averaging(istream)) {
+        stat.scale (1.0/m_time_avg_curr_count[istream]);
       }
 
-      const auto& var_name = stat.name();
+      // Packed scalar stats are stored as a single record of size npacked,
+      // so fill the entry of this stat (in the stream precision)
+      auto packed_it = packed.find(stat.name());
+      if (packed_it!=packed.end()) {
+        auto& records = pending.data["scalar_stats"];
+        const auto val = stat.data<Real>()[0];
+        const int idx = slot*npacked+packed_it->second;
+        const int nsd = get_output_format(it1.first,stat.name()).nsd;
+        if (io_dtypes.at("scalar_stats")=="float") {
+          store_record<float>(&val,1,idx,npacked*capacity,nsd,records);
+        } else {
+          store_record<double>(&val,1,idx,npacked*capacity,nsd,records);
+        }
+        continue;
+      }
 
+      const int size = stat.layout().size();
+      auto& records = pending.data[stat.name()];
       if (stat.data_type()==DataType::RealType) {
-        io::pnetcdf::write_var (f,var_name,stat.data<Real>());
+        const int nsd = get_output_format(it1.first,stat.name()).nsd;
+        if (io_dtypes.at(stat.name())=="float") {
+          store_record<float>(stat.data<Real>(),size,slot,capacity,nsd,records);
+        } else {
+          store_record<double>(stat.data<Real>(),size,slot,capacity,nsd,records);
+        }
       } else if (stat.data_type()==DataType::IntType) {
-        io::pnetcdf::write_var (f,var_name,stat.data<int>());
+        store_record<int>(stat.data<int>(),size,slot,capacity,0,records);
       } else {
         EKAT_ERROR_MSG ("[ProfilingArchive::write_stream] Unsupported data type for IO.\n"
                         "  - stat name: " + stat.name() + "\n"
@@ -337,26 +834,102 @@ void ProfilingArchive::write_stream (const int istream)
 
   const double beg = m_time_avg_beg[istream] - m_case_t0;
   const double end = m_time_avg_end[istream] - m_case_t0;
-  if (m_time_avg_window_size[istream]>1) {
-    double bnds[2] = {beg,end};
-    io::pnetcdf::write_var (f,"time_bounds",bnds);
+  if (is_averaging(istream)) {
+    pending.time_bounds.push_back(beg);
+    pending.time_bounds.push_back(end);
 
     // We store beg as time, since that's when the avg window starts
-    io::pnetcdf::update_time(f,beg);
+    pending.time.push_back(beg);
   } else {
-    io::pnetcdf::update_time(f,end);
+    pending.time.push_back(end);
+  }
+
+  ++pending.num;
+  if (pending.num==capacity) {
+    flush_stream(istream);
+  }
+
+  timings.stop_timer("profiling::write_stream");
+}
+
+void ProfilingArchive::flush_stream (const int istream)
+{
+  if (m_pending[istream].num==0) {
+    return;
+  }
+
+  // Swap the pending records into the ready slot, which is free once the
+  // previous job is completed. The pending buffers are then the ones of the
+  // previous flush, already allocated.
+  wait_for_io();
+  auto& ready = m_ready[istream];
+  std::swap(ready,m_pending[istream]);
+  auto& pending = m_pending[istream];
+  pending.num = 0;
+  pending.time.clear();
+  pending.time_bounds.clear();
+
+  submit_io([this,istream](){ write_records(istream,m_ready[istream]); });
+}
+
+void ProfilingArchive::write_records (const int istream, const Records& records) const
+{
+  // With async output, this runs on the I/O thread, which cannot use the
+  // timers, since other archives (or the main thread) may be using them.
+  // The time spent there is tracked in m_io_time instead.
+  const bool timed = not m_async;
+  auto& timings = timing::TimingSession::instance();
+  if (timed) {
+    timings.start_timer("profiling::flush_stream");
+  }
+
+  if (m_comm.am_i_root()) {
+    printf(" [CLDERA] Flushing field stats to file ...\n");
+  }
+
+  auto& f = *m_output_files[istream];
+  const int nrecords = records.num;
+
+  // One (multi-record) write per variable
+  for (const auto& it : records.data) {
+    const auto& name = it.first;
+    const auto& dtype = m_io_dtypes[istream].at(name);
+    if (dtype=="double") {
+      io::pnetcdf::write_var (f,name,reinterpret_cast<const double*>(it.second.data()),nrecords,timed);
+    } else if (dtype=="float") {
+      io::pnetcdf::write_var (f,name,reinterpret_cast<const float*>(it.second.data()),nrecords,timed);
+    } else {
+      io::pnetcdf::write_var (f,name,reinterpret_cast<const int*>(it.second.data()),nrecords,timed);
+    }
+  }
+
+  if (is_averaging(istream)) {
+    io::pnetcdf::write_var (f,"time_bounds",records.time_bounds.data(),nrecords,timed);
+  }
+  io::pnetcdf::write_var (f,"time",records.time.data(),nrecords,timed);
+
+  if (f.buffer_size>0) {
+    io::pnetcdf::wait_all(f,timed);
   }
 
   if (m_comm.am_i_root()) {
     printf(" [CLDERA] Flushing field stats to file ... done!\n");
   }
-  timings.stop_timer("profiling::write_stream");
+  if (timed) {
+    timings.stop_timer("profiling::flush_stream");
+  }
+}
+
+void ProfilingArchive::commit_field (Field& f)
+{
+  // Copy-mode parts of all fields are adjacent, in a pool per data type
+  f.commit(m_arena,"fields_" + e2str(f.data_type()));
 }
 
 void ProfilingArchive::commit_all_fields ()
 {
   for (auto& it : m_fields) {
-    it.second.commit();
+    commit_field(it.second);
   }
 }
 
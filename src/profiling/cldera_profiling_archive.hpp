@@ -5,13 +5,19 @@
 #include "cldera_profiling_types.hpp"
 #include "cldera_time_stamp.hpp"
 #include "cldera_field.hpp"
+#include "cldera_field_arena.hpp"
 
 #include <io/cldera_pnetcdf.hpp>
 
 #include <ekat/ekat_parameter_list.hpp>
 
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <map>
 #include <list>
+#include <mutex>
+#include <thread>
 
 namespace cldera {
 
@@ -33,6 +39,7 @@ public:
   using strmap_t = std::map<std::string,T>;
 
   using stat_ptr_t = std::shared_ptr<FieldStat>;
+  using ncfile_ptr = std::shared_ptr<io::pnetcdf::NCFile>;
 
   ProfilingArchive (const ekat::Comm& comm,
                     const TimeStamp& case_t0,
@@ -45,6 +52,8 @@ public:
   // Fields
   void add_field (const Field& field);
 
+  // Copy-mode fields get their data from the archive arena
+  void commit_field (Field& f);
   void commit_all_fields ();
 
   bool has_field (const std::string& name) const {
@@ -52,18 +61,101 @@ public:
   }
   const Field& get_field (const std::string& name) const;
         Field& get_field (const std::string& name);
+  const std::list<std::string>& get_fields_names () const { return m_fields_names; }
+
+  // Stat fields (and Copy-mode fields) are allocated from this arena
+  FieldArena& get_arena () { return m_arena; }
 
   // Stats
   void update_stat (const std::string& fname, const std::string& stat_name,
                     const Field& stat);
 
+  // The accumulators of a stat in the output streams can be resolved once,
+  // and then referred to by an integer handle, so that storing the stat at
+  // every step requires no lookup. Handles can only be created once all the
+  // stats cadences are set (see set_stat_cadence).
+  int get_stat_handle (const std::string& fname, const std::string& stat_name);
+  void update_stat (const int handle, const Field& stat);
+
+  // Stats that are not computed at every time step are not written to the
+  // regular streams. Instead, all the stats with the same cadence go in a
+  // separate (instantaneous) stream, which is only written at the time steps
+  // where its stats are updated. The cadence name is used in the file name.
+  // Must be called before the first call to update_stat for this stat.
+  void set_stat_cadence (const std::string& fname, const std::string& stat_name,
+                         const std::string& cadence);
+
+  // Output format of a real stat: precision on file ("double" or "float"), and
+  // number of significant (decimal) digits kept, rounding the mantissa before
+  // the write, to make the file more compressible (0 means keep all). Stats are
+  // stored in memory (and accumulated) in full precision regardless.
+  // By default, stats use "Output Precision" and "Significant Digits", which
+  // are also used for an empty dtype, or a negative nsd.
+  // With "Pack Scalar Stats", scalar stats can only change nsd, since they
+  // share the precision of the packed var.
+  // Must be called before the first call to end_timestep.
+  void set_stat_output_format (const std::string& fname, const std::string& stat_name,
+                               const std::string& dtype, const int nsd);
+
   void end_timestep (const TimeStamp& ts);
+
+  // Write to file all the records still kept in memory (see "Flush Frequency")
+  void flush ();
 private:
+  ncfile_ptr open_output_file (const std::string& suffix) const;
+
+  struct OutputFormat {
+    std::string dtype;
+    int         nsd = 0;
+  };
+  OutputFormat get_output_format (const std::string& fname, const std::string& stat_name) const;
+
   void setup_output_file (const int istream);
 
+  // Completed records of a stream, stored one after the other for each stat
+  struct Records {
+    int                           num = 0;
+    std::vector<double>           time;
+    std::vector<double>           time_bounds;
+    strmap_t<std::vector<char>>   data;
+  };
+
+  // Store the current record of a stream, and, if the stream has
+  // as many pending records as its capacity, flush it
   void write_stream (const int istream);
 
-  using ncfile_ptr = std::shared_ptr<io::pnetcdf::NCFile>;
+  void flush_stream (const int istream);
+
+  // Write the records of a stream to file (possibly on the I/O thread)
+  void write_records (const int istream, const Records& records) const;
+
+  // With async output, I/O jobs run on a separate thread, one at a time.
+  // submit_io waits for the previous job to complete (back-pressure) before
+  // handing off the new one, while wait_for_io waits until the I/O thread is
+  // idle, which is needed before any other use of the output files.
+  void submit_io (const std::function<void()>& job);
+  void wait_for_io ();
+  void io_thread_loop ();
+
+  // Add the data structures for a new stream. Calendar-aligned streams ("daily"
+  // or "monthly") have no fixed window size, and their windows end when the
+  // day (or month) changes.
+  void add_stream (const ncfile_ptr& file, const int time_avg_window_size,
+                   const std::string& calendar, const TimeStamp& beg);
+
+  // Regular streams are organized as a hierarchy: an averaging stream whose
+  // windows are made of the (completed) windows of a finer averaging stream
+  // accumulates the window sums of the latter, rather than the raw steps.
+  // The finer stream is its parent, and is processed first at each step.
+  void setup_streams_hierarchy ();
+
+  bool is_averaging (const int istream) const {
+    return m_time_avg_window_size[istream]>1 or m_time_avg_calendar[istream]!="";
+  }
+  bool window_completed (const int istream, const TimeStamp& ts) const;
+
+  // Add the window sums of a stream to the accumulators of another one
+  void accumulate_window (const int src, const int dst);
 
   ekat::Comm                              m_comm;
   ekat::ParameterList                     m_params;
@@ -72,17 +164,73 @@ private:
 
   strmap_t<Field>                         m_fields;
 
+  // Storage of Copy-mode fields and stat fields, in few large slabs
+  FieldArena                              m_arena;
+
   TimeStamp                               m_case_t0;
+  TimeStamp                               m_run_t0;
 
   // Vector over all requested time-averaging sizes
   std::vector<ncfile_ptr>                 m_output_files;
   std::vector<int>                        m_time_avg_window_size;
-  std::vector<int>                        m_time_avg_curr_count;
+  std::vector<int>                        m_time_avg_curr_count;  // Steps in the current window
   std::vector<TimeStamp>                  m_time_avg_beg;
   std::vector<TimeStamp>                  m_time_avg_end;
+  std::vector<std::string>                m_time_avg_calendar;
+  std::vector<int>                        m_time_avg_parent;      // -1 if fed by the raw steps
+  std::vector<int>                        m_streams_order;        // Parents before children
   std::vector<strmap_t<strmap_t<Field>>>  m_fields_stats;
 
-  int                                     m_num_streams;
+  // The first m_num_streams streams are the regular ones. Then, there is one
+  // stream for each stat cadence, written only when its stats are updated
+  int                                     m_num_streams = 0;
+  strmap_t<int>                           m_cadence_streams;
+  strmap_t<strmap_t<int>>                 m_stat_cadence_stream;
+  std::vector<bool>                       m_stream_updated;
+
+  // Accumulators of each stat (indexed by its handle), in the streams where
+  // it is stored at every update. The fields are the ones in m_fields_stats.
+  struct StatAccumulators {
+    std::vector<int>      streams;
+    std::vector<Field*>   fields;
+  };
+  std::vector<StatAccumulators>           m_stat_accumulators;
+  strmap_t<strmap_t<int>>                 m_stat_handles;
+
+  // Completed records are kept in memory, and written with one multi-record
+  // write per variable once a stream has m_flush_capacity of them. The
+  // capacity is "Flush Frequency", capped so that the records of a stream
+  // take at most "Flush Max Bytes". It is set when the stream is first written.
+  std::vector<int>                        m_flush_capacity;
+  std::vector<Records>                    m_pending;
+
+  // With "Pack Scalar Stats", the index of each real scalar stat of a stream
+  // in the 'scalar_stats' var, which stores them all, one record per time.
+  std::vector<strmap_t<int>>              m_packed_scalars;
+
+  // Default and per-stat output format of real stats, and the data type
+  // on file of each var of each stream (set when the stream is first written)
+  OutputFormat                            m_output_format;
+  strmap_t<strmap_t<OutputFormat>>        m_stat_output_format;
+  std::vector<strmap_t<std::string>>      m_io_dtypes;
+
+  // With "Async Output", full records are swapped into the ready slot of their
+  // stream, and written by the I/O thread, on a duplicate of the communicator,
+  // while new records are stored in the (previously ready) pending buffers.
+  // m_io_time is the time spent writing on the I/O thread, and m_io_wait_time
+  // the time the compute path waited for it: the difference was hidden.
+  std::vector<Records>                    m_ready;
+  bool                                    m_async = false;
+  ekat::Comm                              m_io_comm;
+  std::thread                             m_io_thread;
+  std::mutex                              m_io_mutex;
+  std::condition_variable                 m_io_cv;
+  std::function<void()>                   m_io_job;
+  bool                                    m_io_busy = false;
+  bool                                    m_io_stop = false;
+  std::exception_ptr                      m_io_error;
+  double                                  m_io_time = 0;
+  double                                  m_io_wait_time = 0;
 };
 
 } // namespace cldera
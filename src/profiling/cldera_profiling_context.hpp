@@ -68,7 +68,8 @@ private:
 
   timing::TimingSession m_timing;
 
-  std::map<std::string,ekat::any> m_data;
+  // Mutable, so that get can hand out the stored data without copying the any object
+  mutable std::map<std::string,ekat::any> m_data;
 
   ekat::Comm  m_comm;
   ekat::ParameterList m_params;
@@ -98,7 +99,7 @@ T& ProfilingContext::get (const std::string& name) const
   EKAT_REQUIRE_MSG (has_data(name),
       "[cldera::ProfilingContext] Error! Data '" + name + "' not found.\n");
 
-  auto data = m_data.at(name);
+  auto& data = m_data.at(name);
 
   return ekat::any_cast<T>(data);
 }
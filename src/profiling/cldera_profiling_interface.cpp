@@ -3,8 +3,14 @@
 #include "cldera_profiling_context.hpp"
 #include "cldera_profiling_session.hpp"
 #include "cldera_profiling_archive.hpp"
+#include "cldera_column_decomp.hpp"
+#include "cldera_in_transit.hpp"
+#include "cldera_reduction_batch.hpp"
 #include "cldera_pathway_factory.hpp"
 #include "stats/cldera_register_stats.hpp"
+#include "stats/cldera_field_stat_pipe.hpp"
+#include "stats/cldera_fused_field_stats.hpp"
+#include "stats/cldera_shared_field_stat.hpp"
 
 #include "timing/cldera_timing_session.hpp"
 
@@ -14,8 +20,190 @@
 #include <ekat/ekat_session.hpp>
 #include <ekat/ekat_assert.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <fstream>
+#include <functional>
+#include <set>
+
+namespace cldera {
+
+namespace {
+
+using stat_ptr_t = std::shared_ptr<FieldStat>;
+
+// How often a stat is computed (and stored in the archive), as set via the
+// 'compute_every' (in number of steps) and 'compute_at_tod' (list of times
+// of day, in seconds) stat options. By default, stats are computed every step.
+struct StatCadence {
+  int               every = 1;
+  std::vector<int>  tods;
+
+  bool every_step () const { return every==1 and tods.empty(); }
+
+  bool is_due (const int step, const TimeStamp& time) const {
+    return step%every==0 and
+           (tods.empty() or std::find(tods.begin(),tods.end(),time.tod())!=tods.end());
+  }
+
+  // Stats with the same cadence are written in the same output stream
+  std::string name () const {
+    std::string n = "every_" + std::to_string(every) + "_steps";
+    if (not tods.empty()) {
+      std::vector<std::string> tods_str;
+      for (auto t : tods) {
+        tods_str.push_back(std::to_string(t));
+      }
+      n += ".tod_" + ekat::join(tods_str,"_");
+    }
+    return n;
+  }
+};
+
+// A stat, with the handle of its accumulators in the archive
+struct StatSlot {
+  stat_ptr_t  stat;
+  int         handle;
+  int         cadence = -1;   // Index in StatsPlan::cadences, or -1 if computed every step
+};
+
+// Stats of a field, grouped by how their local part is computed
+struct FieldStatsPlan {
+  std::shared_ptr<FusedFieldStats>  fused;    // Computed with a single traversal of the field
+  std::vector<int>                  others;   // Slots of the stats computed one at a time
+};
+
+// The per-step work, compiled when fields are committed. Stats are stored in
+// flat slots (field after field, in the order they were requested), and all
+// the context data and params needed at every step are resolved once, so
+// that computing the stats requires no lookup by name.
+struct StatsPlan {
+  std::vector<StatSlot>       slots;
+  std::vector<FieldStatsPlan> fields;
+  std::vector<StatCadence>    cadences;   // Only stats not computed every step
+  std::vector<char>           due;        // Whether each cadence is due at the current step
+
+  ProfilingArchive*           archive = nullptr;
+  ReductionBatch*             batch   = nullptr;  // Only if reductions are batched
+  InTransitChannel*           channel = nullptr;  // Only on in-transit clients
+  std::shared_ptr<Pathway>    pathway;            // Created at the first step
+
+  TimeStamp                   run_t0;
+  TimeStamp                   pending_time;       // Time of the stats with reductions in flight
+  int                         num_calls = 0;
+
+  bool                        barrier = false;
+  bool                        batch_reductions = true;
+  bool                        async_reductions = false;
+  bool                        run_pathway = false;
+  int                         timings_flush_freq = 0;
+  std::string                 timings_filename;
+
+  // Timer names, built once, so that computing stats does not build strings
+  struct {
+    std::string compute, local, post, reduce, wait, finalize, ship, pathway;
+  } timers;
+
+  // Whether the stat must be computed at the current step
+  bool is_due (const StatSlot& slot) const {
+    return slot.cadence<0 or due[slot.cadence];
+  }
+};
+
+// Find the stats that are due at this step. Must be called after the stats of
+// the previous step (if still pending) are completed
+void update_due_stats (StatsPlan& plan, const TimeStamp& time)
+{
+  for (size_t i=0; i<plan.cadences.size(); ++i) {
+    plan.due[i] = plan.cadences[i].is_due(plan.num_calls,time);
+  }
+}
+
+// Complete all stats (once their global reductions are done), and store them in the archive
+void finalize_stats (ProfilingContext& c, StatsPlan& plan)
+{
+  auto& ts = c.timing();
+  ts.start_timer(plan.timers.finalize);
+
+  for (const auto& slot : plan.slots) {
+    if (plan.is_due(slot)) {
+      plan.archive->update_stat(slot.handle,slot.stat->finalize_compute());
+    }
+  }
+  ts.stop_timer(plan.timers.finalize);
+}
+
+// Once all stats for a time step are in the archive, let the archive write them
+// (if needed), and, if pathway is enabled, run the pathway tests
+void end_stats_step (ProfilingContext& c, StatsPlan& plan, const TimeStamp& time)
+{
+  plan.archive->end_timestep(time);
+
+  if (plan.run_pathway) {
+    const auto& comm = c.get_comm();
+    c.timing().start_timer(plan.timers.pathway);
+    // this solves the issue of fields not being initialized
+    if(not plan.pathway) {
+      // It's the first time this is called, so create the pathway
+      cldera::PathwayFactory pathway_factory(c.get_params(), comm, false); // TODO: make pathway verbosity a yaml option
+      plan.pathway = c.create<std::shared_ptr<Pathway>>("pathway",pathway_factory.build_pathway(*plan.archive));
+    }
+    plan.pathway->run_pathway_tests(comm, time);
+    c.timing().stop_timer(plan.timers.pathway);
+  }
+}
+
+// If the reductions of a previous step were posted asynchronously, wait for
+// them to complete, and finish up that step. Since this is always called
+// before new stats are computed (or before cleaning up), the archive never
+// sees (nor writes) stats whose reductions are still in flight.
+void complete_pending_stats (ProfilingContext& c, StatsPlan& plan)
+{
+  if (plan.batch==nullptr or not plan.batch->pending()) {
+    return;
+  }
+
+  auto& ts = c.timing();
+  ts.start_timer(plan.timers.wait);
+  plan.batch->wait();
+  ts.stop_timer(plan.timers.wait);
+
+  finalize_stats(c,plan);
+  end_stats_step(c,plan,plan.pending_time);
+}
+
+// With in-transit ranks, model ranks only ship their fields to the in-transit ranks
+bool is_in_transit_client (const ProfilingContext& c)
+{
+  return c.has_data("in_transit") and not c.get<InTransitChannel>("in_transit").is_server();
+}
+
+// On in-transit ranks, receive the fields from the model ranks, and compute
+// their stats at every step, until the model ranks are done with this context
+void run_in_transit_server (ProfilingContext& c)
+{
+  auto& channel = c.get<InTransitChannel>("in_transit");
+  channel.recv_fields(c.get<ProfilingArchive>("archive"));
+  cldera_commit_all_fields_c();
+
+  TimeStamp time;
+  while (channel.recv_step(time)) {
+    const auto start = std::chrono::steady_clock::now();
+    cldera_compute_stats_c(time.ymd(),time.tod());
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    channel.add_busy_time(elapsed.count());
+  }
+
+  // Cleaning up resets the context comm, so grab the in-transit ranks comm first
+  auto comm = c.get_comm().mpi_comm();
+  cldera_clean_up_c();
+  MPI_Comm_free(&comm);
+}
+
+} // anonymous namespace
+
+} // namespace cldera
 
 extern "C" {
 
@@ -51,6 +239,7 @@ void cldera_init_c (const char*& context_name,
   // Init session (if not already done)
   auto& s = get_session();
   s.init_session(comm);
+  s.set_model_comm(mpiComm);
 
   // Add context right away, even before checking if an input file is present.
   // This way, we can always check if this context is inited or not (we can't
@@ -78,6 +267,26 @@ void cldera_init_c (const char*& context_name,
   }
   auto params = ekat::parse_yaml_file(context_params_filename);
 
+  // If requested, the last ranks become in-transit analysis ranks: they compute
+  // the stats of this context (and write them), while the others keep running
+  // the model, and only ship their fields at every step
+  const int num_in_transit = params.get<int>("In-Transit Ranks",0);
+  if (num_in_transit>0) {
+    const auto& channel = c.create<InTransitChannel>("in_transit",comm,num_in_transit);
+    comm = channel.get_local_comm();
+    if (channel.is_server()) {
+      s.set_model_comm(MPI_COMM_NULL);
+    } else {
+      s.set_model_comm(comm.mpi_comm());
+
+      // Model ranks do no output, and dump their timings in a separate file
+      params.sublist("Profiling Output").set("Enable Output",false);
+      if (params.isParameter("Timing Filename")) {
+        params.set("Timing Filename",params.get<std::string>("Timing Filename") + ".model_ranks");
+      }
+    }
+  }
+
   c.init(comm,params);
   std::string timer_name = context_name;
   timer_name += "::init";
@@ -101,6 +310,16 @@ void cldera_init_c (const char*& context_name,
     printf(" [CLDERA] Initializing profiling context '%s' ... done!\n",context_name);
   }
   c.timing().stop_timer(timer_name);
+
+  // In-transit ranks serve the model ranks until they clean up this context
+  if (c.has_data("in_transit") and c.get<InTransitChannel>("in_transit").is_server()) {
+    run_in_transit_server(c);
+  }
+}
+
+void cldera_get_model_comm_c (MPI_Fint& fcomm)
+{
+  fcomm = MPI_Comm_c2f(get_session().get_model_comm());
 }
 
 void cldera_clean_up_c ()
@@ -120,8 +339,27 @@ void cldera_clean_up_c ()
     printf(" [CLDERA] Shutting down profiling context '%s' ...\n", cname.c_str());
   }
 
+  // If the last step reductions were posted asynchronously, complete them
+  if (c.has_data("stats_plan")) {
+    complete_pending_stats(c,c.get<StatsPlan>("stats_plan"));
+  }
+
+  // Write the stats records still kept in memory (see "Flush Frequency")
+  if (c.has_data("archive")) {
+    c.get<ProfilingArchive>("archive").flush();
+  }
+
+  // Let the in-transit ranks know that the model is done, and report the time saved
+  if (c.has_data("in_transit")) {
+    auto& channel = c.get<InTransitChannel>("in_transit");
+    if (not channel.is_server()) {
+      channel.send_done();
+    }
+    channel.report();
+  }
+
   auto& params = c.get_params();
-  if(params.isSublist("Pathway")) {
+  if(params.isSublist("Pathway") and not is_in_transit_client(c)) {
     const auto& history_filename = params.get<std::string>("pathway_history_file","cldera_pathway_history.yaml");
     auto& pathway = c.get<std::shared_ptr<cldera::Pathway>>("pathway");
     pathway->dump_test_history_to_yaml(history_filename);
@@ -262,7 +500,7 @@ void cldera_commit_field_c (const char*& name)
 
   auto& archive = c.get<ProfilingArchive>("archive");
 
-  archive.get_field(name).commit();
+  archive.commit_field(archive.get_field(name));
   ts.stop_timer(c.name() + "::commit_fields");
 }
 
@@ -280,24 +518,160 @@ void cldera_commit_all_fields_c ()
   archive.commit_all_fields();
   ts.stop_timer(c.name() + "::commit_fields");
 
-  ts.start_timer(c.name() + "::create_stats");
   auto& params = c.get_params();
-  using stat_ptr_t = std::shared_ptr<FieldStat>;
-  using requests_t = std::map<std::string,std::vector<stat_ptr_t>>;
   using vos_t = std::vector<std::string>;
 
+  auto& plan = c.create<StatsPlan>("stats_plan");
+  plan.archive = &archive;
+  plan.run_t0 = c.get<TimeStamp>("run_t0");
+
+  const std::string prefix = c.name() + "::compute_stats";
+  plan.timers.compute  = prefix;
+  plan.timers.local    = prefix + "::local";
+  plan.timers.post     = prefix + "::post";
+  plan.timers.reduce   = prefix + "::reduce";
+  plan.timers.wait     = prefix + "::wait";
+  plan.timers.finalize = prefix + "::finalize";
+  plan.timers.ship     = prefix + "::ship";
+  plan.timers.pathway  = c.name() + "::run_pathway_tests";
+
+  // Stats are created (and computed) on the in-transit ranks
+  if (is_in_transit_client(c)) {
+    plan.channel = &c.get<InTransitChannel>("in_transit");
+    ts.start_timer(c.name() + "::send_fields");
+    plan.channel->send_fields(archive,params.get<vos_t>("Fields To Track"));
+    ts.stop_timer(c.name() + "::send_fields");
+    return;
+  }
+
+  // Build the column decomposition once: output, mask, and reference files
+  // all share it, and it is kept alive until the context is cleaned up
+  if (archive.has_field("col_gids")) {
+    c.create<std::shared_ptr<const ColumnDecomp>>("column_decomp",
+        ColumnDecomp::get(c.get_comm(),archive.get_field("col_gids")));
+  }
+
+  ts.start_timer(c.name() + "::create_stats");
+
+  plan.batch = &c.create<ReductionBatch>("reductions");
+  plan.batch_reductions = params.get<bool>("Batch Stats Reductions",true);
+  plan.async_reductions = params.get<bool>("Async Stats Reductions",false);
+  plan.barrier = params.get<bool>("Add Compute Stats Barrier",false);
+  plan.run_pathway = params.isSublist("Pathway");
+  plan.timings_flush_freq = params.get("Timings Flush Freq",0);
+  plan.timings_filename = params.get<std::string>("Timing Filename","");
+
   auto& factory = StatFactory::instance();
   register_stats();
-  auto& requests = c.create<requests_t>("requests");
   const auto& fnames = params.get<vos_t>("Fields To Track");
+
+  // Create all stats first, so that we can find identical ones (including
+  // pipe inner stages), by comparing their signatures
+  std::map<std::string,std::vector<stat_ptr_t>> created;
+  std::map<std::string,std::vector<StatCadence>> cadences;
+  std::map<std::string,int> sig_count;
+
+  // If requested, all sums are computed reproducibly (unless a stat, or a pipe stage, says otherwise)
+  const bool repro_sums = params.get<bool>("Reproducible Sums",false);
+  std::function<void(ekat::ParameterList&)> set_reproducible = [&](ekat::ParameterList& pl) {
+    if (not pl.isParameter("reproducible")) {
+      pl.set("reproducible",true);
+    }
+    for (const auto& n : {"inner","outer"}) {
+      if (pl.isSublist(n)) {
+        set_reproducible(pl.sublist(n));
+      }
+    }
+  };
   for (const auto& fname : fnames) {
     auto& req_pl = params.sublist(fname);
-    auto& req_stats = requests[fname];
-    const auto& f = archive.get_field(fname);
     for (auto stat_name : req_pl.get<vos_t>("Compute Stats")) {
       auto& stat_pl = req_pl.sublist(stat_name);
       const auto& stat_type = stat_pl.get<std::string>("type",stat_name);
+
+      // Cadence options are part of the stat params, so stats with different
+      // cadences have different signatures, and are never shared
+      StatCadence cad;
+      cad.every = stat_pl.get<int>("compute_every",1);
+      if (stat_pl.isParameter("compute_at_tod")) {
+        cad.tods = stat_pl.get<std::vector<int>>("compute_at_tod");
+      }
+      EKAT_REQUIRE_MSG (cad.every>0,
+          "Error! Invalid value for 'compute_every'.\n"
+          "  - field name: " + fname + "\n"
+          "  - stat name : " + stat_name + "\n"
+          "  - value     : " + std::to_string(cad.every) + "\n");
+      for (auto t : cad.tods) {
+        EKAT_REQUIRE_MSG (t>=0 and t<86400,
+            "Error! Invalid value in 'compute_at_tod' (must be in [0,86400)).\n"
+            "  - field name: " + fname + "\n"
+            "  - stat name : " + stat_name + "\n"
+            "  - value     : " + std::to_string(t) + "\n");
+      }
+      cadences[fname].push_back(cad);
+
+      if (repro_sums) {
+        set_reproducible(stat_pl);
+      }
+
       auto stat = factory.create(stat_type,c.get_comm(),stat_pl);
+      created[fname].push_back(stat);
+      ++sig_count[stat->signature(fname)];
+      if (auto pipe = std::dynamic_pointer_cast<FieldStatPipe>(stat)) {
+        ++sig_count[pipe->get_inner()->signature(fname)];
+      }
+    }
+  }
+
+  // Stats with the same signature are built and computed only once, and
+  // each request gets a consumer of the shared stat (see SharedFieldStat)
+  const bool share = params.get<bool>("Share Identical Stats",true);
+  std::map<std::string,std::shared_ptr<SharedFieldStat>> shared;
+  std::function<stat_ptr_t(const stat_ptr_t&,const std::string&,const bool)> get_consumer;
+  auto share_inner = [&](const stat_ptr_t& stat, const std::string& fname) {
+    auto pipe = std::dynamic_pointer_cast<FieldStatPipe>(stat);
+    if (pipe and sig_count[pipe->get_inner()->signature(fname)]>1) {
+      // The pipe needs the inner stat to be complete before the outer can start
+      pipe->set_inner(get_consumer(pipe->get_inner(),fname,true));
+    }
+  };
+  get_consumer = [&](const stat_ptr_t& stat, const std::string& fname, const bool eager) {
+    ekat::ParameterList pl(stat->name());
+    pl.set("name",stat->name());
+
+    std::shared_ptr<SharedFieldStat> consumer;
+    const auto sig = stat->signature(fname);
+    auto it = shared.find(sig);
+    if (it==shared.end()) {
+      // Rebuild the stat with a different name, to avoid clashes
+      // between the consumer and the shared stat timers
+      auto shared_pl = stat->get_params();
+      shared_pl.set("name",stat->name() + "_shared");
+      auto shared_stat = factory.create(stat->type(),c.get_comm(),shared_pl);
+      share_inner(shared_stat,fname);
+      consumer = std::make_shared<SharedFieldStat>(c.get_comm(),pl,shared_stat);
+      shared[sig] = consumer;
+    } else {
+      consumer = std::make_shared<SharedFieldStat>(c.get_comm(),pl,*it->second);
+    }
+    if (eager) {
+      consumer->set_eager();
+    }
+    return stat_ptr_t(consumer);
+  };
+
+  for (const auto& fname : fnames) {
+    std::vector<stat_ptr_t> req_stats;
+    const int first_slot = plan.slots.size();
+    const auto& f = archive.get_field(fname);
+    for (size_t i=0; i<created[fname].size(); ++i) {
+      auto stat = created[fname][i];
+      if (share and sig_count[stat->signature(fname)]>1) {
+        stat = get_consumer(stat,fname,false);
+      } else if (share) {
+        share_inner(stat,fname);
+      }
+      stat->set_arena(&archive.get_arena());
       stat->set_field(f);
       std::map<std::string,Field> aux_fields;
       for (const auto& fn : stat->get_aux_fields_names()) {
@@ -315,6 +689,26 @@ void cldera_commit_all_fields_c ()
       stat->create_stat_field();
       req_stats.push_back(stat);
 
+      StatSlot slot;
+      slot.stat = stat;
+      const auto& cad = cadences[fname][i];
+      if (not cad.every_step()) {
+        slot.cadence = plan.cadences.size();
+        plan.cadences.push_back(cad);
+        archive.set_stat_cadence(fname,stat->name(),cad.name());
+      }
+      plan.slots.push_back(slot);
+
+      // Output format options override the ones of the output streams
+      const auto& out_pl = created[fname][i]->get_params();
+      if (out_pl.isParameter("output_precision") or out_pl.isParameter("significant_digits")) {
+        const auto dtype = out_pl.isParameter("output_precision")
+                         ? out_pl.get<std::string>("output_precision") : std::string("");
+        const int nsd = out_pl.isParameter("significant_digits")
+                      ? out_pl.get<int>("significant_digits") : -1;
+        archive.set_stat_output_format(fname,stat->name(),dtype,nsd);
+      }
+
       // Add all fields computed by the stat to the archive
       if (not archive.has_field(stat->get_stat_field().name())) {
         archive.add_field(stat->get_stat_field());
@@ -325,7 +719,40 @@ void cldera_commit_all_fields_c ()
         }
       }
     }
+
+    // Group stats that can be computed with a single traversal of the field.
+    // Fusion only makes sense if reductions are batched, and if at least
+    // two stats share the traversal. Stats not computed every step are
+    // never fused, so that the fused traversal is the same at every step.
+    FieldStatsPlan field_plan;
+    auto fused = std::make_shared<FusedFieldStats>(f);
+    const bool fuse = plan.batch_reductions and params.get<bool>("Fuse Stats",true);
+    for (size_t i=0; i<req_stats.size(); ++i) {
+      if (fuse and plan.slots[first_slot+i].cadence<0 and fused->can_fuse(*req_stats[i])) {
+        fused->add_stat(req_stats[i]);
+      }
+    }
+    if (fused->num_stats()>1) {
+      field_plan.fused = fused;
+    }
+    const auto& fs = fused->get_stats();
+    for (size_t i=0; i<req_stats.size(); ++i) {
+      if (not field_plan.fused or std::find(fs.begin(),fs.end(),req_stats[i])==fs.end()) {
+        field_plan.others.push_back(first_slot+i);
+      }
+    }
+    plan.fields.push_back(field_plan);
   }
+
+  // Now that all cadences are set, resolve the stats accumulators in the archive
+  int islot = 0;
+  for (const auto& fname : fnames) {
+    for (size_t i=0; i<created[fname].size(); ++i, ++islot) {
+      auto& slot = plan.slots[islot];
+      slot.handle = archive.get_stat_handle(fname,slot.stat->name());
+    }
+  }
+  plan.due.resize(plan.cadences.size(),0);
   ts.stop_timer(c.name() + "::create_stats");
 }
 
@@ -335,81 +762,108 @@ void cldera_compute_stats_c (const int ymd, const int tod)
   // If input file was not provided, cldera does nothing
   if (not c.inited()) { return; }
 
+  // Everything needed here was resolved when fields were committed
+  auto& plan = c.get<StatsPlan>("stats_plan");
+
   cldera::TimeStamp time = {ymd, tod};
-  if (time==c.get<TimeStamp>("run_t0")) {
+  if (time==plan.run_t0) {
     // E3SM runs a bit of its timestep during init, to bootstrap
     // some surface fluxes. We are not interested in the stats at
     // that time.
     return;
   }
-  static std::map<std::string,int> num_calls_map;
-  auto& num_calls = num_calls_map[c.name()];
+
+  // Model ranks ship the fields to the in-transit ranks, which compute the stats
+  if (plan.channel) {
+    auto& ts = c.timing();
+    ts.start_timer(plan.timers.ship);
+    const auto start = std::chrono::steady_clock::now();
+    plan.channel->send_step(time);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    plan.channel->add_busy_time(elapsed.count());
+    ts.stop_timer(plan.timers.ship);
+    return;
+  }
 
   const auto& comm = c.get_comm();
-  auto& params = c.get_params();
 
   // There is some rank that enters this call after the others,
   // making the relative timing of internal cldera funcs harder.
   // We can use the following to add a barrier upon entrance in
   // this routine, so that all ranks will start together
-  if (params.get<bool>("Add Compute Stats Barrier",false)) {
+  if (plan.barrier) {
     comm.barrier();
   }
 
   if (comm.am_i_root()) {
     printf(" [CLDERA] Computing stats for context '%s'...\n",c.name().c_str());
-    printf(" [CLDERA]   time: %s...\n",time.to_string().c_str());
+    printf(" [CLDERA]   time: %04d-%02d-%02d-%05d...\n",time.year(),time.month(),time.day(),time.tod());
   }
 
   auto& ts = c.timing();
-  ts.start_timer(c.name() + "::compute_stats");
-
-  using stat_ptr_t = std::shared_ptr<FieldStat>;
-  using requests_t = std::map<std::string,std::vector<stat_ptr_t>>;
-  auto& requests = c.get<requests_t>("requests");
-
-  auto& archive = c.get<ProfilingArchive>("archive");
-
-  for (const auto& it : requests) {
-    const auto& fname = it.first;
-    const auto& stats = it.second;
-    const auto& f = archive.get_field(fname);
+  ts.start_timer(plan.timers.compute);
+
+  if (plan.batch_reductions) {
+    // Do all local work first, then perform a single MPI reduction for each
+    // (data type, MPI op) pair, and finally complete all the stats
+    auto& batch = *plan.batch;
+
+    // If async reductions of the previous step are still in flight, we must
+    // complete them before we start overwriting the stats local results
+    complete_pending_stats(c,plan);
+    update_due_stats(plan,time);
+
+    ts.start_timer(plan.timers.local);
+    for (const auto& field_plan : plan.fields) {
+      if (field_plan.fused) {
+        field_plan.fused->compute_local(time,batch);
+      }
+      for (int i : field_plan.others) {
+        const auto& slot = plan.slots[i];
+        if (plan.is_due(slot)) {
+          slot.stat->compute_local(time,batch);
+        }
+      }
+    }
+    ts.stop_timer(plan.timers.local);
+
+    if (plan.async_reductions) {
+      // Post reductions, and return right away. They will be completed
+      // at the next call to this function (or during clean up).
+      ts.start_timer(plan.timers.post);
+      batch.post(comm,c.name());
+      plan.pending_time = time;
+      ts.stop_timer(plan.timers.post);
+    } else {
+      ts.start_timer(plan.timers.reduce);
+      batch.reduce(comm,c.name());
+      ts.stop_timer(plan.timers.reduce);
 
-    for (auto& stat : stats) {
-      archive.update_stat(fname,stat->name(),stat->compute(time));
+      finalize_stats(c,plan);
+      end_stats_step(c,plan,time);
     }
+  } else {
+    update_due_stats(plan,time);
+    for (const auto& slot : plan.slots) {
+      if (plan.is_due(slot)) {
+        plan.archive->update_stat(slot.handle,slot.stat->compute(time));
+      }
+    }
+    end_stats_step(c,plan,time);
   }
 
-  archive.end_timestep(time);
-  ts.stop_timer(c.name() + "::compute_stats");
+  ts.stop_timer(plan.timers.compute);
 
   if (comm.am_i_root()) {
     printf(" [CLDERA] Computing stats for context '%s'...done!\n",c.name().c_str());
   }
 
-  // If pathway is enabled, do it
-  if (params.isSublist("Pathway")) {
-    c.timing().start_timer(c.name() + "::run_pathway_tests");
-    // this solves the issue of fields not being initialized
-    if(not c.has_data("pathway")) {
-      auto& archive = c.get<ProfilingArchive>("archive");
-      // It's the first time this is called, so create the pathway
-      cldera::PathwayFactory pathway_factory(params, comm, false); // TODO: make pathway verbosity a yaml option
-      c.create<std::shared_ptr<Pathway>>("pathway",pathway_factory.build_pathway(archive));
-    }
-    auto pathway = c.get<std::shared_ptr<cldera::Pathway>>("pathway");
-    pathway->run_pathway_tests(comm, time);
-    c.timing().stop_timer(c.name() + "::run_pathway_tests");
-  }
-
-  const int timings_flush_freq = params.get("Timings Flush Freq",0);
-  if (ts.is_active() and timings_flush_freq>0 and num_calls%timings_flush_freq==0) {
-    const auto timings_fname = params.get<std::string>("Timing Filename","");
+  if (ts.is_active() and plan.timings_flush_freq>0 and plan.num_calls%plan.timings_flush_freq==0) {
     const auto& timing = c.timing();
     std::ofstream timings_file;
     std::stringstream blackhole;
     if (comm.am_i_root()) {
-      timings_file.open(timings_fname);
+      timings_file.open(plan.timings_filename);
     }
     std::ostream& ofile = timings_file;
     std::ostream& onull = blackhole;
@@ -417,7 +871,7 @@ void cldera_compute_stats_c (const int ymd, const int tod)
     std::ostream& out = comm.am_i_root() ? ofile : onull;
     timing.dump(out,comm);
   }
-  ++num_calls;
+  ++plan.num_calls;
 }
 
 } // namespace cldera
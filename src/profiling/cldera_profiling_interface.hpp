@@ -13,6 +13,12 @@ void cldera_init_c (const char*& session_name,
                     const int run_t0_ymd, const int run_t0_tod,
                     const int stop_ymd, const int stop_tod);
 
+// The comm the host app should use after cldera_init_c. It is the input comm,
+// unless the context uses in-transit ranks (see "In-Transit Ranks"). In that case,
+// cldera_init_c only returns on in-transit ranks once the model ranks clean up
+// the context, and they get MPI_COMM_NULL.
+void cldera_get_model_comm_c (MPI_Fint& fcomm);
+
 void cldera_clean_up_c ();
 
 void cldera_add_field_c (const char*& name,
@@ -33,10 +39,10 @@ void cldera_add_partitioned_field_c (
     const bool    is_view,
     const char*&  dtype);
 
-void cldera_set_field_part_size_c (
+void cldera_set_field_part_extent_c (
     const char*& name,
     const int   part,
-    const int   part_size);
+    const int   part_extent);
 
 void cldera_set_field_part_data_c (
     const char*& name,
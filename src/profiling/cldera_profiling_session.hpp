@@ -32,6 +32,11 @@ struct ProfilingSession {
 
   const std::string& curr_context_name () const { return m_curr_context_name; }
 
+  // The comm the host app should run on after cldera_init_c. If a context uses
+  // in-transit ranks, these are not part of it (and get MPI_COMM_NULL)
+  void set_model_comm (const MPI_Comm comm) { m_model_comm = comm; }
+  MPI_Comm get_model_comm () const { return m_model_comm; }
+
 private:
 
   std::map<std::string,ProfilingContext> m_contexts;
@@ -39,6 +44,8 @@ private:
   ProfilingSession () = default;
 
   std::string   m_curr_context_name;
+
+  MPI_Comm      m_model_comm = MPI_COMM_NULL;
 };
 
 } // namespace cldera
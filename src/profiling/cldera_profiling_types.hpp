@@ -22,6 +22,11 @@ using view_1d_host = typename KokkosTypesHost::template view_1d<T,MT>;
 template<typename T, int N, typename MT = Kokkos::MemoryManaged>
 using view_Nd_host = typename KokkosTypesHost::template view_ND<T,N,MT>;
 
+// Stat kernels run on the host, using whatever host execution space
+// Kokkos was configured with (Serial, OpenMP, Threads)
+using HostExecSpace   = Kokkos::DefaultHostExecutionSpace;
+using HostRangePolicy = Kokkos::RangePolicy<HostExecSpace>;
+
 // A pair used to store min/max bounds
 template<typename T>
 struct Bounds {
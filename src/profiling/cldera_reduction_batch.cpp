@@ -0,0 +1,234 @@
+#include "profiling/cldera_reduction_batch.hpp"
+
+#include "timing/cldera_timing_session.hpp"
+
+#include <ekat/ekat_assert.hpp>
+
+#include <cstring>
+
+namespace cldera {
+
+template<>
+MPI_Datatype get_mpi_dtype<int> () { return MPI_INT; }
+template<>
+MPI_Datatype get_mpi_dtype<long long> () { return MPI_LONG_LONG_INT; }
+template<>
+MPI_Datatype get_mpi_dtype<float> () { return MPI_FLOAT; }
+template<>
+MPI_Datatype get_mpi_dtype<double> () { return MPI_DOUBLE; }
+
+void ReductionBatch::
+add (char* data, const int count, const int elem_size,
+     const MPI_Datatype dtype, const MPI_Op op)
+{
+  EKAT_REQUIRE_MSG (not m_pending,
+      "Error! Cannot add entries to a batch while its reductions are pending.\n");
+  EKAT_REQUIRE_MSG (count>=0,
+      "Error! Invalid count for batched reduction (" + std::to_string(count) + ").\n");
+  if (count==0) {
+    return;
+  }
+
+  Group* group = nullptr;
+  for (auto& g : m_groups) {
+    if (g.dtype==dtype and g.op==op) {
+      group = &g;
+      break;
+    }
+  }
+  if (group==nullptr) {
+    m_groups.emplace_back();
+    group = &m_groups.back();
+    group->dtype = dtype;
+    group->op = op;
+    group->elem_size = elem_size;
+  }
+
+  // Buffers adjacent in memory (e.g., stat fields allocated from the same
+  // arena pool) are merged in a single entry, which may spare the packing
+  auto& entries = group->entries;
+  const int nbytes = count*elem_size;
+  if (not entries.empty() and entries.back().data+entries.back().nbytes==data) {
+    entries.back().nbytes += nbytes;
+  } else {
+    entries.push_back(Entry{data,nbytes});
+  }
+  group->count += count;
+}
+
+void ReductionBatch::
+reduce (const ekat::Comm& comm, const std::string& prefix)
+{
+  EKAT_REQUIRE_MSG (not m_pending,
+      "Error! Cannot call reduce while non-blocking reductions are pending.\n");
+
+  set_prefix(prefix);
+
+  auto& ts = timing::TimingSession::instance();
+  for (auto& g : m_groups) {
+    if (g.count==0) {
+      continue;
+    }
+
+    char* buf = pack(g);
+
+    ts.start_timer("mpi");
+    ts.start_timer("mpi::all_reduce");
+    if (m_prefix!="") {
+      ts.start_timer(m_timer_reduce);
+    }
+    int ret = MPI_Allreduce(MPI_IN_PLACE,buf,g.count,g.dtype,g.op,comm.mpi_comm());
+    EKAT_REQUIRE_MSG (ret==MPI_SUCCESS,
+        "Error! Something went wrong while performing batched reductions.\n"
+        " - num entries: " + std::to_string(g.entries.size()) + "\n"
+        " - count      : " + std::to_string(g.count) + "\n"
+        " - MPI error  : " + std::to_string(ret) + "\n");
+    ts.stop_timer("mpi");
+    ts.stop_timer("mpi::all_reduce");
+    if (m_prefix!="") {
+      ts.stop_timer(m_timer_reduce);
+    }
+
+    unpack(g);
+  }
+}
+
+void ReductionBatch::
+post (const ekat::Comm& comm, const std::string& prefix)
+{
+  EKAT_REQUIRE_MSG (not m_pending,
+      "Error! Cannot post reductions while other non-blocking reductions are pending.\n");
+
+  set_prefix(prefix);
+
+  auto& ts = timing::TimingSession::instance();
+  ts.start_timer("mpi");
+  ts.start_timer("mpi::iall_reduce::post");
+  if (m_prefix!="") {
+    ts.start_timer(m_timer_post);
+  }
+  for (auto& g : m_groups) {
+    if (g.count==0) {
+      continue;
+    }
+
+    char* buf = pack(g);
+    int ret = MPI_Iallreduce(MPI_IN_PLACE,buf,g.count,g.dtype,g.op,comm.mpi_comm(),&g.request);
+    EKAT_REQUIRE_MSG (ret==MPI_SUCCESS,
+        "Error! Something went wrong while posting batched reductions.\n"
+        " - num entries: " + std::to_string(g.entries.size()) + "\n"
+        " - count      : " + std::to_string(g.count) + "\n"
+        " - MPI error  : " + std::to_string(ret) + "\n");
+  }
+  ts.stop_timer("mpi");
+  ts.stop_timer("mpi::iall_reduce::post");
+  if (m_prefix!="") {
+    ts.stop_timer(m_timer_post);
+  }
+
+  m_pending = true;
+}
+
+void ReductionBatch::
+wait ()
+{
+  if (not m_pending) {
+    return;
+  }
+
+  auto& ts = timing::TimingSession::instance();
+  ts.start_timer("mpi");
+  ts.start_timer("mpi::iall_reduce::wait");
+  if (m_prefix!="") {
+    ts.start_timer(m_timer_wait);
+  }
+  for (auto& g : m_groups) {
+    if (g.count==0) {
+      continue;
+    }
+
+    int ret = MPI_Wait(&g.request,MPI_STATUS_IGNORE);
+    EKAT_REQUIRE_MSG (ret==MPI_SUCCESS,
+        "Error! Something went wrong while completing batched reductions.\n"
+        " - num entries: " + std::to_string(g.entries.size()) + "\n"
+        " - count      : " + std::to_string(g.count) + "\n"
+        " - MPI error  : " + std::to_string(ret) + "\n");
+
+    unpack(g);
+  }
+  ts.stop_timer("mpi");
+  ts.stop_timer("mpi::iall_reduce::wait");
+  if (m_prefix!="") {
+    ts.stop_timer(m_timer_wait);
+  }
+
+  m_pending = false;
+}
+
+void ReductionBatch::
+set_prefix (const std::string& prefix)
+{
+  // Callers use the same prefix at every step, so timer names are built only once
+  if (prefix!=m_prefix) {
+    m_prefix = prefix;
+    m_timer_reduce = prefix + "::mpi::all_reduce";
+    m_timer_post   = prefix + "::mpi::iall_reduce::post";
+    m_timer_wait   = prefix + "::mpi::iall_reduce::wait";
+  }
+}
+
+char* ReductionBatch::
+pack (Group& g)
+{
+  // If only one entry is present, reduce in place, without packing
+  if (g.entries.size()==1) {
+    return g.entries[0].data;
+  }
+
+  g.buffer.resize(g.count*g.elem_size);
+  char* buf = g.buffer.data();
+  int offset = 0;
+  for (const auto& e : g.entries) {
+    std::memcpy(buf+offset,e.data,e.nbytes);
+    offset += e.nbytes;
+  }
+  return buf;
+}
+
+void ReductionBatch::
+unpack (Group& g)
+{
+  if (g.entries.size()>1) {
+    const char* buf = g.buffer.data();
+    int offset = 0;
+    for (const auto& e : g.entries) {
+      std::memcpy(e.data,buf+offset,e.nbytes);
+      offset += e.nbytes;
+    }
+  }
+
+  g.entries.clear();
+  g.count = 0;
+}
+
+int ReductionBatch::
+num_entries () const
+{
+  int n = 0;
+  for (const auto& g : m_groups) {
+    n += g.entries.size();
+  }
+  return n;
+}
+
+int ReductionBatch::
+num_collectives () const
+{
+  int n = 0;
+  for (const auto& g : m_groups) {
+    n += g.count>0 ? 1 : 0;
+  }
+  return n;
+}
+
+} // namespace cldera
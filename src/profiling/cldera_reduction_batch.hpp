@@ -0,0 +1,105 @@
+#ifndef CLDERA_REDUCTION_BATCH_HPP
+#define CLDERA_REDUCTION_BATCH_HPP
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <string>
+#include <vector>
+
+namespace cldera {
+
+// Map a C++ type to the corresponding MPI data type
+template<typename T>
+MPI_Datatype get_mpi_dtype ();
+
+/*
+ * A batch of in-place MPI all-reduce operations
+ *
+ * Clients register the buffers holding their local partial results via
+ * the add method. When reduce is called, the batch packs all the entries
+ * sharing the same data type and MPI op in a single contiguous buffer,
+ * and performs ONE all-reduce for each (data type, MPI op) pair, rather
+ * than one per entry. Entries that are contiguous in memory are merged as
+ * they are added, and if all the entries of a pair are contiguous, they are
+ * reduced in place, with no packing. Upon return, all the registered buffers contain
+ * the globally reduced values, and the batch is ready to accept new entries.
+ *
+ * Reductions can also be performed asynchronously, via post and wait: post
+ * starts one MPI_Iallreduce per (data type, MPI op) pair, and returns right
+ * away, while wait completes them, and unpacks the results. In between the
+ * two calls, the batch cannot accept new entries.
+ *
+ * NOTE: registered buffers must stay alive (and untouched) until reduce (or
+ *       wait) returns. The pack buffers are kept across calls, so that in a
+ *       time loop they are allocated only once.
+ */
+
+class ReductionBatch
+{
+public:
+  template<typename T>
+  void add (T* data, const int count, const MPI_Op op) {
+    add (reinterpret_cast<char*>(data),count,sizeof(T),get_mpi_dtype<T>(),op);
+  }
+
+  // Perform all the registered reductions. If prefix is not empty,
+  // MPI ops are also clocked in prefix + "::mpi::all_reduce".
+  void reduce (const ekat::Comm& comm, const std::string& prefix = "");
+
+  // Non-blocking version of reduce. Buffers contain the reduced values
+  // only after wait returns. If prefix is not empty, MPI ops are also
+  // clocked in prefix + "::mpi::iall_reduce::post" and "::wait".
+  void post (const ekat::Comm& comm, const std::string& prefix = "");
+  void wait ();
+
+  // Whether reductions were posted, but not yet completed
+  bool pending () const { return m_pending; }
+
+  // Number of registered entries (after merging contiguous ones), and
+  // number of MPI calls needed to reduce them
+  int num_entries () const;
+  int num_collectives () const;
+
+  bool empty () const { return num_entries()==0; }
+
+private:
+
+  void add (char* data, const int count, const int elem_size,
+            const MPI_Datatype dtype, const MPI_Op op);
+
+  struct Entry {
+    char* data;
+    int   nbytes;
+  };
+
+  // All entries with the same data type and MPI op
+  struct Group {
+    MPI_Datatype        dtype;
+    MPI_Op              op;
+    int                 elem_size;
+    int                 count = 0;
+    std::vector<Entry>  entries;
+    std::vector<char>   buffer;
+    MPI_Request         request = MPI_REQUEST_NULL;
+  };
+
+  // Pack entries of a group in the group buffer (if needed), and return
+  // a pointer to the data to reduce. Unpack does the opposite.
+  char* pack (Group& g);
+  void unpack (Group& g);
+
+  // Set the prefix of the timers, and build their names (if the prefix changed)
+  void set_prefix (const std::string& prefix);
+
+  std::vector<Group>  m_groups;
+
+  bool                m_pending = false;
+  std::string         m_prefix;
+  std::string         m_timer_reduce;
+  std::string         m_timer_post;
+  std::string         m_timer_wait;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_REDUCTION_BATCH_HPP
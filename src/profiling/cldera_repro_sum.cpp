@@ -0,0 +1,142 @@
+#include "profiling/cldera_repro_sum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cldera {
+
+namespace {
+// Offset of the grid, so that the lsb of any double (including subnormals)
+// has a non-negative grid bit (the smallest subnormal is 2^-1074, which
+// is split as 2^52 * 2^-1126)
+constexpr int grid_bias = 1152;
+constexpr long long digit_mask = 0xffffffffLL;
+constexpr double digit_base = 4294967296.0;  // 2^32
+} // anonymous namespace
+
+ReproSum& ReproSum::operator+= (const double x)
+{
+  if (x==0) {
+    return *this;
+  }
+  if (not std::isfinite(x)) {
+    nonfinite += x;
+    return *this;
+  }
+
+  // x = +/- m * 2^(e-53), with m a 53-bit integer
+  int e;
+  const double fr = std::frexp(std::abs(x),&e);
+  const auto m = static_cast<unsigned long long>(std::ldexp(fr,53));
+
+  // Split m*2^s (s being the offset of the lsb within its grid position)
+  // in three 32-bit digits, at grid positions pos, pos+1, pos+2
+  const int g = e - 53 + grid_bias;
+  const long long pos = g / 32;
+  const int s = g % 32;
+  const long long sign = x<0 ? -1 : 1;
+  const long long lo  = static_cast<long long>((m << s) & digit_mask);
+  const long long mid = static_cast<long long>((s==0 ? m>>32 : m>>(32-s)) & digit_mask);
+  const long long hi  = static_cast<long long>(s==0 ? 0 : m>>(64-s));
+
+  deposit(pos+2,sign*hi);
+  deposit(pos+1,sign*mid);
+  deposit(pos,sign*lo);
+  return *this;
+}
+
+ReproSum& ReproSum::operator+= (const ReproSum& rhs)
+{
+  nonfinite += rhs.nonfinite;
+  if (rhs.top<0) {
+    return *this;
+  }
+
+  // Raise the window even if rhs top bin is 0 (e.g., due to cancellations),
+  // so that the kept bins are the same as if the rhs digits were added here
+  raise(rhs.top);
+  for (int j=0; j<K; ++j) {
+    deposit(rhs.top-j,rhs.d[j]);
+  }
+  return *this;
+}
+
+double ReproSum::value () const
+{
+  if (top<0) {
+    return nonfinite;
+  }
+
+  // Propagate carries, so that all bins but the top one are in [0,2^32),
+  // then add bins from the largest one
+  long long b[K];
+  std::copy(d,d+K,b);
+  for (int j=K-1; j>0; --j) {
+    const long long carry = (b[j] - (b[j] & digit_mask)) / static_cast<long long>(digit_base);
+    b[j] -= carry * static_cast<long long>(digit_base);
+    b[j-1] += carry;
+  }
+
+  double v = 0;
+  for (int j=0; j<K; ++j) {
+    v += std::ldexp(static_cast<double>(b[j]),static_cast<int>(32*(top-j)) - grid_bias);
+  }
+  return v + nonfinite;
+}
+
+void ReproSum::raise (const long long pos)
+{
+  if (pos<=top) {
+    return;
+  }
+  if (top<0 or pos-top>=K) {
+    std::fill(d,d+K,0);
+  } else {
+    const int shift = pos - top;
+    for (int j=K-1; j>=shift; --j) {
+      d[j] = d[j-shift];
+    }
+    std::fill(d,d+shift,0);
+  }
+  top = pos;
+}
+
+void ReproSum::deposit (const long long pos, const long long digit)
+{
+  if (digit==0) {
+    return;
+  }
+  raise(pos);
+  const long long j = top - pos;
+  if (j<K) {
+    d[j] += digit;
+  }
+}
+
+template<>
+MPI_Datatype get_mpi_dtype<ReproSum> () {
+  static MPI_Datatype dtype = [] () {
+    MPI_Datatype t;
+    MPI_Type_contiguous(sizeof(ReproSum),MPI_BYTE,&t);
+    MPI_Type_commit(&t);
+    return t;
+  }();
+  return dtype;
+}
+
+MPI_Op get_repro_sum_op () {
+  static MPI_Op op = [] () {
+    MPI_Op o;
+    MPI_Op_create([](void* in, void* inout, int* len, MPI_Datatype*) {
+      const auto src = reinterpret_cast<const ReproSum*>(in);
+      auto dst = reinterpret_cast<ReproSum*>(inout);
+      for (int i=0; i<*len; ++i) {
+        dst[i] += src[i];
+      }
+    }, 1, &o);
+    return o;
+  }();
+  return op;
+}
+
+} // namespace cldera
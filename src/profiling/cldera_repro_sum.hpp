@@ -0,0 +1,61 @@
+#ifndef CLDERA_REPRO_SUM_HPP
+#define CLDERA_REPRO_SUM_HPP
+
+#include "profiling/cldera_reduction_batch.hpp"
+
+namespace cldera {
+
+/*
+ * A reproducible (binned) sum of doubles
+ *
+ * Each value is split exactly in 32-bit digits, aligned to a fixed grid of
+ * binary exponents (the same for all values, on all ranks). Digits are
+ * accumulated in integer bins, one per grid position, so the bins hold the
+ * exact sum of all the digits at their position, in any order. Only the K
+ * bins below (and including) the highest position ever reached are kept:
+ * since that position only depends on the summands (not on their order),
+ * the result is the same no matter how the values are split among threads
+ * and ranks, or how partial sums are merged, and it is therefore bitwise
+ * reproducible across PE layouts.
+ *
+ * Accuracy: digits dropped below the kept bins are smaller than 2^-96 times
+ * the largest summand, so |error| <= n * 2^-96 * max|x_i| (plus the final
+ * rounding to double), which is better than a (scalar) Kahan sum.
+ *
+ * Partial sums can be merged across ranks with a single all-reduce, using the
+ * MPI data type and op returned by get_mpi_dtype<ReproSum> and get_repro_sum_op,
+ * which can also be batched (see ReductionBatch). Each sum takes K+1 integers
+ * and one double (the latter accumulates non-finite values, if any).
+ *
+ * NOTE: each bin can hold the sum of up to 2^31 digits, which bounds the
+ *       total number of summands (across all ranks).
+ */
+
+struct ReproSum {
+  static constexpr int K = 4;
+
+  long long top = -1;         // Grid position of d[0] (-1 if nothing was added)
+  long long d[K] = {};        // d[j] is the bin at grid position top-j
+  double    nonfinite = 0;    // Sum of Inf/NaN values
+
+  ReproSum& operator+= (const double x);
+  ReproSum& operator+= (const ReproSum& rhs);
+
+  // The (rounded) value of the sum
+  double value () const;
+
+private:
+  // Move the window of kept bins so that its top is at position pos (if higher)
+  void raise (const long long pos);
+  void deposit (const long long pos, const long long digit);
+};
+
+template<>
+MPI_Datatype get_mpi_dtype<ReproSum> ();
+
+// The (commutative) MPI op merging ReproSum's
+MPI_Op get_repro_sum_op ();
+
+} // namespace cldera
+
+#endif // CLDERA_REPRO_SUM_HPP
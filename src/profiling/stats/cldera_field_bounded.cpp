@@ -52,10 +52,13 @@ do_compute_impl () {
   Kokkos::deep_copy(stat_view, 0);
 
   const int part_dim = m_field.part_dim();
-  const auto non_part_layout = m_field.layout().strip_dim(part_dim);
+  // Extents of the non-partitioned dims (without building the stripped layout)
+  const auto& dims = m_field.layout().dims();
+  const int n0 = N>1 ? dims[part_dim==0 ? 1 : 0] : 0;
+  const int n1 = N>2 ? dims[part_dim==2 ? 1 : 2] : 0;
   for (int ipart = 0; ipart < m_field.nparts(); ++ipart) {
     auto fview = m_field.part_nd_view<const T,N>(ipart);
-    const auto part_layout = m_field.part_layout(ipart);
+    const auto& part_layout = m_field.part_layout(ipart);
 
     int part_size = part_layout.extent(part_dim);
     const int offset = m_field.part_offset(ipart);
@@ -66,12 +69,12 @@ do_compute_impl () {
       if constexpr (N==1) {
         s () = m_bounds.contains(f()) ? f() : m_mask_val;
       } else if constexpr (N==2) {
-        for (int j=0; j<non_part_layout.extent(0); ++i) {
+        for (int j=0; j<n0; ++i) {
           s (j) = m_bounds.contains(f(j)) ? f(j) : m_mask_val;
         }
       } else if constexpr (N==3) {
-        for (int j=0; j<non_part_layout.extent(0); ++j) {
-          for (int k=0; k<non_part_layout.extent(1); ++k) {
+        for (int j=0; j<n0; ++j) {
+          for (int k=0; k<n1; ++k) {
             s (j,k) = m_bounds.contains(f(j,k)) ? f(j,k) : m_mask_val;
           }
         }
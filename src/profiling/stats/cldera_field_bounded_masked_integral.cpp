@@ -1,5 +1,5 @@
 #include "cldera_field_bounded_masked_integral.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
+#include "cldera_field_stat_kernels.hpp"
 
 #include <ekat/ekat_assert.hpp>
 
@@ -15,6 +15,10 @@ FieldBoundedMaskedIntegral (const ekat::Comm& comm,
     auto vec = m_params.get<std::vector<Real>>("valid_bounds");
     m_bounds.min = vec[0];
     m_bounds.max = vec[1];
+
+    EKAT_REQUIRE_MSG (not reproducible_sums(),
+        "[FieldBoundedMaskedIntegral] Error! Reproducible sums are not supported with valid bounds.\n"
+        " - stat name: " + name () + "\n");
   }
 }
 
@@ -57,61 +61,58 @@ template<typename T, int N>
 void FieldBoundedMaskedIntegral::
 do_compute_impl ()
 {
-  // Init stat to 0
-  auto sview = m_stat_field.nd_view_nonconst<Real,N>();
-  Kokkos::deep_copy(sview,0.0);
+  static_assert (N==1, "FieldBoundedMaskedIntegral only supports rank 1 fields.\n");
 
-  view_1d_host<const Real> w_view;
-  if (m_use_weight or m_average) {
-    w_view = m_weight_field.view<const Real>();
-  }
+  auto sview = m_stat_field.nd_view_nonconst<Real,N>();
 
   view_1d_host<Real> w_int_view;
   if (m_average) {
     w_int_view = m_weight_integral.view_nonconst<Real>();
-    Kokkos::deep_copy(w_int_view,0);
   }
 
-  const int part_dim = m_field.part_dim();
-  auto m = m_mask_field.view<int>();
-
-  for (int p=0; p<m_field.nparts(); ++p) {
-    auto fpl = m_field.part_layout(p);
-    auto fview = m_field.part_nd_view<T,1>(p);
-    const int part_size = fpl.extent(part_dim);
-    const int part_offset = m_field.part_offset(p);
-
-    for (int i=0; i<part_size; ++i) {
-      int midx = m_mask_val_to_stat_entry.at(m(part_offset+i));
-
-      if constexpr (N==1) {
-        if (m_bounds.contains(fview(i))) {
-          auto w = m_use_weight or m_average ? w_view(part_offset+i) : 1;
-          sview(midx) += fview(i) * w;
-          if (m_average) {
-            w_int_view(midx) += w;
-          }
-        }
-      } else {
-        throw std::runtime_error("NOT IMPLEMENTED!\n");
+  // Loop over the region-sorted entries (see FieldMaskedIntegral::build_region_index),
+  // so that we don't need to look up the region of each column.
+  // NOTE: if there is no weight field, the stored weights are all 1
+  FieldParts<T,1> parts (m_field,0);
+
+  const int num_mask_ids = m_region_offsets.size()-1;
+  for (int midx=0; midx<num_mask_ids; ++midx) {
+    Real sum = 0;
+    Real w_sum = 0;
+    for (int e=m_region_offsets[midx]; e<m_region_offsets[midx+1]; ++e) {
+      const T val = parts.view(m_region_parts[e])(m_region_cols[e]);
+      if (m_bounds.contains(val)) {
+        sum += val * m_region_weights[e];
+        w_sum += m_region_weights[e];
       }
     }
+    sview(midx) = sum;
+    if (m_average) {
+      w_int_view(midx) = w_sum;
+    }
   }
 
-  // Global reduction of (weighted) integral
-  track_mpi_all_reduce(m_comm,sview.data(),sview.size(),MPI_SUM,name());
+  // Global reduction of (weighted) integral, deferred so that it can be batched
+  all_reduce(sview.data(),sview.size(),MPI_SUM);
 
   if (m_average) {
-    const int mask_dim = m_field.layout().dim_idx(m_mask_field.layout().names()[0]);
-    track_mpi_all_reduce(m_comm,w_int_view.data(),w_int_view.size(),MPI_SUM,name()+"_weight_integral");
-    auto num_mask_ids = sview.extent(mask_dim);
-    for (int i=0; i<num_mask_ids; ++i) {
-      auto w = w_int_view(i);
-      if constexpr (N==1) {
-        sview(i) /= w;
-      } else {
-        throw std::runtime_error("NOT IMPLEMENTED!\n");
-      }
+    all_reduce(w_int_view.data(),w_int_view.size(),MPI_SUM);
+  }
+}
+
+void FieldBoundedMaskedIntegral::
+finalize_impl () {
+  if (not m_has_bounds) {
+    FieldMaskedIntegral::finalize_impl ();
+    return;
+  }
+
+  // NOTE: compute_impl already checked that the field has rank 1
+  if (m_average) {
+    auto sview = m_stat_field.view_nonconst<Real>();
+    auto w_int_view = m_weight_integral.view<const Real>();
+    for (int i=0; i<sview.extent_int(0); ++i) {
+      sview(i) /= w_int_view(i);
     }
   }
 }
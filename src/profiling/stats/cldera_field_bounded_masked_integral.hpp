@@ -13,6 +13,10 @@ public:
 
   std::string type () const override { return "bounded_masked_integral"; }
 
+  FusedKernel fused_kernel () const override {
+    return m_has_bounds ? FusedKernel::None : FieldMaskedIntegral::fused_kernel();
+  }
+
 protected:
 
   void compute_impl () override;
@@ -20,6 +24,8 @@ protected:
   template<typename T, int N>
   void do_compute_impl ();
 
+  void finalize_impl () override;
+
   // The bounds outside of which the field values must be discarded
   Bounds<Real>  m_bounds;
   bool          m_has_bounds;
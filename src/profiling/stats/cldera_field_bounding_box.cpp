@@ -1,5 +1,5 @@
 #include "profiling/stats/cldera_field_bounding_box.hpp"
-#include "profiling/utils/cldera_subview_utils.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
 
 #include <limits>
 
@@ -72,7 +72,10 @@ void FieldBoundingBox::do_compute_impl ()
 
   const int part_dim = m_field.part_dim();
 
-  const auto& non_part_layout = m_field.layout().strip_dim(part_dim);
+  // Extents of the non-partitioned dims (without building the stripped layout)
+  const auto& dims = m_field.layout().dims();
+  const int n0 = N>1 ? dims[part_dim==0 ? 1 : 0] : 0;
+  const int n1 = N>2 ? dims[part_dim==2 ? 1 : 2] : 0;
 
   // Helper lambda for checking if 2d/3d point is inside bounds
   auto in_latlon_bounds = [&](Real lat, Real lon) {
@@ -82,7 +85,10 @@ void FieldBoundingBox::do_compute_impl ()
 
   // Determine if field has levels, and the level idx **after part dim has been stripped**
   const bool has_lev = m_field.layout().has_dim("lev");
-  auto lev_idx = has_lev ? non_part_layout.dim_idx("lev") : -1;
+  auto lev_idx = has_lev ? m_field.layout().dim_idx("lev") : -1;
+  if (lev_idx>part_dim) {
+    --lev_idx;
+  }
   auto in_vert_bound = [&](int j, int k = -1) {
     switch (lev_idx) {
       case 0: return m_lev_bounds.contains(j);
@@ -91,28 +97,24 @@ void FieldBoundingBox::do_compute_impl ()
     }
   };
 
-  for (int ipart = 0; ipart < m_field.nparts(); ++ipart) {
-    auto f_part_view = m_field.part_nd_view<const T,N>(ipart);
-    auto lat_part_view = m_lat.part_nd_view<const Real,1>(ipart);
-    auto lon_part_view = m_lon.part_nd_view<const Real,1>(ipart);
-
-    const auto& part_layout = m_field.part_layout(ipart);
-    const int part_size = part_layout.dims()[part_dim];
-    const int part_offset = m_field.part_offset(ipart);
-
-    for (int i=0; i<part_size; ++i) {
-      auto lat = lat_part_view(i);
-      auto lon = lon_part_view(i);
-      if (not in_latlon_bounds(lat,lon)) {
-        continue;
+  // Columns are independent, so threads can process them in any order
+  FieldParts<T,N> parts (m_field,part_dim);
+  FieldParts<Real,1> lat (m_lat,0);
+  FieldParts<Real,1> lon (m_lon,0);
+  parallel_chunks("FieldBoundingBox",parts.size(),
+                  [&](const int, const int beg, const int end) {
+    parts.for_each(beg,end,[&](const int p, const int i, const int idx) {
+      if (not in_latlon_bounds(lat.view(p)(i),lon.view(p)(i))) {
+        return;
       }
 
-      auto stat_slice = slice(stat_view,part_dim,part_offset+i);
-      auto f_slice    = slice(f_part_view,part_dim,i);
+      // NOTE: the stat field has one part, so idx is the index in the stat
+      auto stat_slice = slice(stat_view,part_dim,idx);
+      auto f_slice    = slice(parts.view(p),part_dim,i);
       if constexpr (N==1) {
-        stat_slice() = f_part_view(i);
+        stat_slice() = f_slice();
       } else if constexpr (N==2) {
-        for (int j=0; j<non_part_layout.extent(0); ++j) {
+        for (int j=0; j<n0; ++j) {
           // Note: if j is the lev dim, this check does something,
           //       otherwise it always returns true
           if (in_vert_bound(j)) {
@@ -120,16 +122,16 @@ void FieldBoundingBox::do_compute_impl ()
           }
         }
       } else {
-        for (int j=0; j<non_part_layout.extent(0); ++j) {
-          for (int k=0; k<non_part_layout.extent(1); ++k) {
+        for (int j=0; j<n0; ++j) {
+          for (int k=0; k<n1; ++k) {
             if (in_vert_bound(j,k)) {
               stat_slice(j,k) = f_slice(j,k);
             }
           }
         }
       }
-    }
-  }
+    });
+  });
 }
 
 } // namespace cldera
@@ -2,7 +2,6 @@
 #define CLDERA_FIELD_GLOBAL_AVG_HPP
 
 #include "profiling/stats/cldera_field_global_sum.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
 
 #include <ekat/mpi/ekat_comm.hpp>
 
@@ -23,19 +22,23 @@ public:
 protected:
   // NOTE: unlike global max/min/sum, we don't support IntType,
   //       so no need for extra template function
-  void compute_impl () override {
+  void register_reductions () override {
     // Sum
-    FieldGlobalSum::compute_impl();
+    FieldGlobalSum::register_reductions();
 
-    // Divide by size
-    long long size = m_field.layout().size();
-    long long global_size;
+    // Global size, reduced together with the sum
+    m_global_size = m_field.layout().size();
+    all_reduce(&m_global_size,1,MPI_SUM);
+  }
 
-    // Clock MPI ops
-    track_mpi_all_reduce(m_comm,&size,&global_size,1,MPI_SUM,name());
+  void finalize_impl () override {
+    FieldGlobalSum::finalize_impl();
 
-    m_stat_field.data_nonconst<Real>()[0] /= global_size;
+    // Divide by size
+    m_stat_field.data_nonconst<Real>()[0] /= m_global_size;
   }
+
+  long long m_global_size;
 };
 
 } // namespace cldera
@@ -1,5 +1,5 @@
 #include "cldera_field_global_max.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
+#include "cldera_field_stat_kernels.hpp"
 #include <limits>
 
 namespace cldera {
@@ -39,30 +39,25 @@ compute_impl () {
 template<typename T, int N>
 void FieldGlobalMax::
 do_compute_impl () {
+  // Threads process contiguous ranges of indices along the partitioned dimension.
+  // Since max is exact, the result does not depend on the order of the joins.
+  FieldParts<T,N> parts (m_field,m_field.part_dim());
+  const int n = parts.size();
+  const int nchunks = num_chunks(n);
   T max = -std::numeric_limits<T>::max();
-  for (int p=0; p<m_field.nparts(); ++p) {
-    const auto& pl = m_field.part_layout(p);
-    const auto& fview = m_field.part_nd_view<const T,N>(p);
-    if constexpr (N==1) {
-      for (int i=0; i<pl.dims()[0]; ++i) {
-        max = std::max(max,fview[i]);
-      }
-    } else if constexpr (N==2) {
-      for (int i=0; i<pl.dims()[0]; ++i) {
-        for (int j=0; j<pl.dims()[1]; ++j) {
-          max = std::max(max,fview(i,j));
-      }}
-    } else {
-      for (int i=0; i<pl.dims()[0]; ++i) {
-        for (int j=0; j<pl.dims()[1]; ++j) {
-          for (int k=0; k<pl.dims()[2]; ++k) {
-            max = std::max(max,fview(i,j,k));
-      }}}
-    }
-  }
+  Kokkos::parallel_reduce(kernel_label("FieldGlobalMax"),HostRangePolicy(0,nchunks),
+                          [&](const int ichunk, T& local_max) {
+    const int beg = chunk_begin(n,nchunks,ichunk);
+    const int end = chunk_begin(n,nchunks,ichunk+1);
+    parts.for_each_entry(beg,end,[&](const int, const int, const T val) {
+      local_max = std::max(local_max,val);
+    });
+  },Kokkos::Max<T>(max));
 
-  // Clock MPI ops
-  track_mpi_all_reduce(m_comm,&max,m_stat_field.data_nonconst<T>(),1,MPI_MAX,name());
+  // Global reduction is deferred, so that it can be batched with other stats
+  auto stat_data = m_stat_field.data_nonconst<T>();
+  stat_data[0] = max;
+  register_reductions();
 }
 
 } // namespace cldera
@@ -16,9 +16,13 @@ public:
 
   std::string type () const override { return "global_max"; }
 
+  FusedKernel fused_kernel () const override { return FusedKernel::GlobalMax; }
+
 protected:
   void compute_impl () override;
 
+  void register_reductions () override { all_reduce_stat_field(MPI_MAX); }
+
   template<typename T, int N>
   void do_compute_impl ();
 };
@@ -15,9 +15,13 @@ public:
 
   std::string type () const override { return "global_min"; }
 
+  FusedKernel fused_kernel () const override { return FusedKernel::GlobalMin; }
+
 protected:
   void compute_impl () override;
 
+  void register_reductions () override { all_reduce_stat_field(MPI_MIN); }
+
   template<typename T, int N>
   void do_compute_impl ();
 };
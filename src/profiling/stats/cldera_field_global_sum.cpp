@@ -1,6 +1,7 @@
 #include "cldera_field_global_sum.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
+#include "cldera_field_stat_kernels.hpp"
 #include <limits>
+#include <type_traits>
 
 namespace cldera {
 
@@ -39,39 +40,47 @@ compute_impl () {
 template<typename T, int N>
 void FieldGlobalSum::
 do_compute_impl () {
-  T sum = 0;
-  T c = 0;
-  T temp,y;
+  if constexpr (std::is_same<T,Real>::value) {
+    if (use_repro_sums()) {
+      // Threads sum contiguous ranges of indices; partial sums can be merged
+      // in any order, since the result does not depend on it
+      FieldParts<T,N> parts (m_field,m_field.part_dim());
+      const auto* sum = parallel_accumulate("FieldGlobalSum",parts.size(),1,
+                                            ReproSum(),m_scratch,
+                                            [&](const int beg, const int end, ReproSum* acc) {
+        parts.for_each_entry(beg,end,[&](const int, const int, const T val) {
+          acc[0] += val;
+        });
+      },[](ReproSum& dst, const ReproSum& src) { dst += src; });
+      m_repro_sums.assign(sum,sum+1);
+      register_reductions();
+      return;
+    }
+  }
 
-  auto update_sum = [&](const T val) {
-    y = val - c;
-    temp = sum + y;
-    c = (temp - sum) - y;
-    sum = temp;
-  };
-  for (int p=0; p<m_field.nparts(); ++p) {
-    const auto& pl = m_field.part_layout(p);
-    const auto& fview = m_field.part_nd_view<const T,N>(p);
-    if constexpr (N==1) {
-      for (int i=0; i<pl.dims()[0]; ++i) {
-        update_sum(fview(i));
-      }
-    } else if constexpr (N==2) {
-      for (int i=0; i<pl.dims()[0]; ++i) {
-        for (int j=0; j<pl.dims()[1]; ++j) {
-          update_sum(fview(i,j));
-      }}
+  // Threads sum contiguous ranges of indices along the partitioned dimension.
+  // Within a range, runs of contiguous entries are summed with a vectorized
+  // compensated sum (see LaneKahanSum)
+  FieldParts<T,N> parts (m_field,m_field.part_dim());
+  const T sum = parallel_sum<T>("FieldGlobalSum",parts.size(),m_scratch,
+                                [&](const int beg, const int end, KahanSum<T>& s) {
+    if (parts.contiguous_runs) {
+      LaneKahanSum<T> lanes;
+      parts.for_each_run(beg,end,[&](const int, const int, const T* x, const int n) {
+        lanes.add(x,n*parts.inner);
+      });
+      s += lanes.reduce();
     } else {
-      for (int i=0; i<pl.dims()[0]; ++i) {
-        for (int j=0; j<pl.dims()[1]; ++j) {
-          for (int k=0; k<pl.dims()[2]; ++k) {
-            update_sum(fview(i,j,k));
-      }}}
+      parts.for_each_entry(beg,end,[&](const int, const int, const T val) {
+        s += val;
+      });
     }
-  }
+  });
 
-  // Clock MPI ops
-  track_mpi_all_reduce(m_comm,&sum,m_stat_field.data_nonconst<T>(),1,MPI_SUM,name());
+  // Global reduction is deferred, so that it can be batched with other stats
+  auto stat_data = m_stat_field.data_nonconst<T>();
+  stat_data[0] = sum;
+  register_reductions();
 }
 
 } // namespace cldera
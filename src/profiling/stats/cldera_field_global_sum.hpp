@@ -16,11 +16,36 @@ public:
 
   std::string type () const override { return "global_sum"; }
 
+  FusedKernel fused_kernel () const override {
+    return use_repro_sums() ? FusedKernel::None : FusedKernel::GlobalSum;
+  }
+
 protected:
   void compute_impl () override;
-  
+
+  void register_reductions () override {
+    if (use_repro_sums()) {
+      all_reduce_repro_sums();
+    } else {
+      all_reduce_stat_field(MPI_SUM);
+    }
+  }
+
+  void finalize_impl () override {
+    if (use_repro_sums()) {
+      store_repro_sums(m_stat_field.data_nonconst<Real>());
+    }
+  }
+
+  // Sums of ints are exact, hence already reproducible
+  bool use_repro_sums () const {
+    return reproducible_sums() and m_field.data_type()==DataType::RealType;
+  }
+
   template<typename T, int N>
   void do_compute_impl ();
+
+  std::vector<char> m_scratch;
 };
 
 } // namespace cldera
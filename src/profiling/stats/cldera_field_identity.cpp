@@ -45,7 +45,9 @@ do_compute_impl ()
 
   const int nparts = m_field.nparts();
   const int part_dim = m_field.part_dim();
-  auto non_part_layout = m_field.layout().strip_dim(part_dim);
+  // Extents of the non-partitioned dims (without building the stripped layout)
+  const auto& dims = m_field.layout().dims();
+  const int n0 = N>1 ? dims[part_dim==0 ? 1 : 0] : 0;
 
   for (int p=0; p<nparts; ++p) {
     const auto& part_layout = m_field.part_layout(p);
@@ -59,11 +61,11 @@ do_compute_impl ()
       } else {
         auto stat_slice = slice(stat_view,part_dim,i);
         auto f_slice    = slice(fpart_view,part_dim,i);
-        for (int j=0; j<non_part_layout.extent(0); ++j) {
+        for (int j=0; j<n0; ++j) {
           if constexpr (N==2) {
             stat_slice(j) = f_slice(j);
           } else {
-            for (int k=0; k<non_part_layout.extent(0); ++k) {
+            for (int k=0; k<n0; ++k) {
               stat_slice(j,k) = f_slice(j,k);
             }
           }
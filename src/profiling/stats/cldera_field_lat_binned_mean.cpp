@@ -0,0 +1,264 @@
+#include "profiling/stats/cldera_field_lat_binned_mean.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
+#include "profiling/cldera_mpi_timing_wrappers.hpp"
+
+#include <ekat/util/ekat_string_utils.hpp>
+
+#include <algorithm>
+
+namespace cldera {
+
+namespace {
+
+// Index of the bin containing x, or -1 if x is outside of all bins
+int find_bin (const std::vector<Real>& edges, const Real x) {
+  if (not (x>=edges.front() and x<=edges.back())) {
+    return -1;
+  }
+  const int nbins = edges.size()-1;
+  const int bin = std::upper_bound(edges.begin(),edges.end(),x) - edges.begin() - 1;
+  return std::min(bin,nbins-1);
+}
+
+void check_edges (const std::vector<Real>& edges, const std::string& param,
+                  const std::string& stat_name)
+{
+  EKAT_REQUIRE_MSG (edges.size()>=2,
+      "Error! Bin edges must contain at least two values.\n"
+      " - stat name : " + stat_name + "\n"
+      " - parameter : " + param + "\n");
+  EKAT_REQUIRE_MSG (std::adjacent_find(edges.begin(),edges.end(),std::greater_equal<Real>())==edges.end(),
+      "Error! Bin edges must be strictly increasing.\n"
+      " - stat name : " + stat_name + "\n"
+      " - parameter : " + param + "\n"
+      " - bin edges : " + ekat::join(edges,",") + "\n");
+}
+
+} // anonymous namespace
+
+FieldLatBinnedMean::
+FieldLatBinnedMean(const ekat::Comm& comm, const ekat::ParameterList& pl)
+ : FieldStat(comm,pl)
+ , m_lat_edges(pl.get<std::vector<Real>>("Latitude Bin Edges"))
+ , m_mask_val(m_params.get("Mask Value",0.0))
+{
+  check_edges(m_lat_edges,"Latitude Bin Edges",name());
+  m_num_lat_bins = m_lat_edges.size()-1;
+  m_num_lon_bins = 1;
+  if (m_params.isParameter("Longitude Bin Edges")) {
+    m_lon_edges = m_params.get<std::vector<Real>>("Longitude Bin Edges");
+    check_edges(m_lon_edges,"Longitude Bin Edges",name());
+    m_num_lon_bins = m_lon_edges.size()-1;
+  }
+}
+
+std::vector<std::string>
+FieldLatBinnedMean::
+get_aux_fields_names () const
+{
+  if (m_lon_edges.size()>0) {
+    return {"lat", "lon", "area"};
+  }
+  return {"lat", "area"};
+}
+
+FieldLayout
+FieldLatBinnedMean::
+stat_layout (const FieldLayout& field_layout) const
+{
+  const auto slice = field_layout.strip_dim("ncol");
+  std::vector<int> dims = {m_num_lat_bins};
+  std::vector<std::string> names = {"lat_bin"};
+  if (m_lon_edges.size()>0) {
+    dims.push_back(m_num_lon_bins);
+    names.push_back("lon_bin");
+  }
+  for (int i=0; i<slice.rank(); ++i) {
+    dims.push_back(slice.dims()[i]);
+    names.push_back(slice.names()[i]);
+  }
+  return FieldLayout(dims,names);
+}
+
+void FieldLatBinnedMean::
+set_aux_fields_impl ()
+{
+  check_aux_fields(get_aux_fields_names());
+
+  for (const auto& n : get_aux_fields_names()) {
+    const auto& f = m_aux_fields.at(n);
+    EKAT_REQUIRE_MSG (m_field.nparts() == f.nparts(),
+        "Error! Incompatible number of part for aux field '" + n + "'.\n"
+        "  - stat name   : " + name() + "\n"
+        "  - field name  : " + m_field.name() + "\n"
+        "  - field nparts: " + std::to_string(m_field.nparts()) + "\n"
+        "  - aux nparts  : " + std::to_string(f.nparts()) + "\n");
+    EKAT_REQUIRE_MSG (f.layout().rank()==1 and
+                      f.layout().size()==m_field.layout().dims()[m_field.layout().idim("ncol")],
+        "Error! Aux field '" + n + "' should have one entry per column.\n"
+        "  - stat name   : " + name() + "\n"
+        "  - field layout: " + m_field.layout().to_string() + "\n"
+        "  - aux layout  : " + f.layout().to_string() + "\n");
+  }
+
+  // The bin of each column does not change, so find it once
+  FieldParts<Real,1> lat (m_aux_fields.at("lat"),0);
+  FieldParts<Real,1> area (m_aux_fields.at("area"),0);
+  const int ncols = lat.size();
+  const bool has_lon = m_lon_edges.size()>0;
+  m_col_bins.resize(ncols);
+  m_col_areas.resize(ncols);
+  lat.for_each(0,ncols,[&](const int p, const int icol, const int idx) {
+    m_col_bins[idx] = find_bin(m_lat_edges,lat.view(p)(icol));
+    m_col_areas[idx] = area.view(p)(icol);
+  });
+  if (has_lon) {
+    FieldParts<Real,1> lon (m_aux_fields.at("lon"),0);
+    lon.for_each(0,ncols,[&](const int p, const int icol, const int idx) {
+      const int lon_bin = find_bin(m_lon_edges,lon.view(p)(icol));
+      auto& bin = m_col_bins[idx];
+      bin = (bin<0 or lon_bin<0) ? -1 : bin*m_num_lon_bins + lon_bin;
+    });
+  }
+
+  // Compute the area of all bins, with a single reduction
+  const int nbins = num_bins();
+  m_bin_areas.resize(nbins);
+  if (use_repro_sums()) {
+    std::vector<ReproSum> bin_areas(nbins);
+    for (int i=0; i<ncols; ++i) {
+      if (m_col_bins[i]>=0) {
+        bin_areas[m_col_bins[i]] += m_col_areas[i];
+      }
+    }
+    ReductionBatch batch;
+    batch.add(bin_areas.data(),nbins,get_repro_sum_op());
+    batch.reduce(m_comm,name()+"_initialize");
+    for (int b=0; b<nbins; ++b) {
+      m_bin_areas[b] = bin_areas[b].value();
+    }
+  } else {
+    std::vector<KahanSum<Real>> bin_areas(nbins);
+    for (int i=0; i<ncols; ++i) {
+      if (m_col_bins[i]>=0) {
+        bin_areas[m_col_bins[i]] += m_col_areas[i];
+      }
+    }
+    for (int b=0; b<nbins; ++b) {
+      m_bin_areas[b] = bin_areas[b].sum;
+    }
+    track_mpi_all_reduce(m_comm,m_bin_areas.data(),nbins,MPI_SUM,name()+"_initialize");
+  }
+
+  // Bins with no columns are allowed (e.g., fine bins on a coarse grid),
+  // and are set to the mask value in the stat
+  for (int b=0; b<nbins; ++b) {
+    EKAT_REQUIRE_MSG (m_bin_areas[b] >= 0,
+        "Error! Bin area should be non-negative.\n"
+        " - stat name : " << name() << "\n"
+        " - lat bin   : " << b / m_num_lon_bins << "\n"
+        " - lon bin   : " << b % m_num_lon_bins << "\n"
+        " - bin area  : " << m_bin_areas[b] << "\n");
+  }
+}
+
+void FieldLatBinnedMean::
+compute_impl ()
+{
+  EKAT_REQUIRE_MSG (m_aux_fields_set, "Error! lat/area fields not initialized!\n");
+
+  const auto dt = m_field.data_type();
+  const auto rank = m_field.layout().rank();
+  EKAT_REQUIRE_MSG (rank>0 && rank<=3,
+      "Error! Unsupported rank in FieldLatBinnedMean.\n"
+      " - field name: " + m_field.name() + "\n"
+      " - field rank: " + std::to_string(rank) + "\n");
+
+  if (dt==IntType) {
+    switch (rank) {
+      case 1: return do_compute_impl<int,1>();
+      case 2: return do_compute_impl<int,2>();
+      case 3: return do_compute_impl<int,3>();
+    }
+  } else if (dt==RealType) {
+    switch (rank) {
+      case 1: return do_compute_impl<Real,1>();
+      case 2: return do_compute_impl<Real,2>();
+      case 3: return do_compute_impl<Real,3>();
+    }
+  } else {
+    EKAT_ERROR_MSG ("[FieldLatBinnedMean] Unrecognized/unsupported data type (" + e2str(dt) + ")\n");
+  }
+}
+
+template <typename T, int N>
+void FieldLatBinnedMean::
+do_compute_impl ()
+{
+  const int col_dim = m_field.layout().idim("ncol");
+  FieldParts<T,N> parts (m_field,col_dim);
+
+  // Each thread accumulates a contiguous range of columns into all the bins,
+  // so that the field is traversed once, regardless of the number of bins
+  // NOTE: a rank may have no columns, so get the slice size from the stat
+  const int ncols = parts.size();
+  const int stat_size = m_stat_field.layout().size();
+  const int slice_size = stat_size / num_bins();
+  const int* col_bins = m_col_bins.data();
+  const Real* col_areas = m_col_areas.data();
+
+  auto accumulate = [&](const int beg, const int end, auto* acc) {
+    parts.for_each(beg,end,[&](const int p, const int icol, const int idx) {
+      const int bin = col_bins[idx];
+      if (bin<0) {
+        return;
+      }
+      const Real a = col_areas[idx];
+      auto* bin_acc = acc + bin*slice_size;
+      parts.for_each_in_slice(p,icol,[&](const int k, const T val) {
+        bin_acc[k] += val*a;
+      });
+    });
+  };
+
+  if (use_repro_sums()) {
+    // Partial sums can be merged in any order, since the result does not depend on it
+    const auto* sums = parallel_accumulate("FieldLatBinnedMean",ncols,stat_size,
+                                           ReproSum(),m_scratch,accumulate,
+                                           [](ReproSum& dst, const ReproSum& src) { dst += src; });
+    m_repro_sums.assign(sums,sums+stat_size);
+    all_reduce_repro_sums();
+    return;
+  }
+
+  const auto* sums = parallel_accumulate("FieldLatBinnedMean",ncols,stat_size,
+                                         KahanSum<Real>(),m_scratch,accumulate,
+                                         [](KahanSum<Real>& dst, const KahanSum<Real>& src) { dst += src; });
+  auto stat_data = m_stat_field.data_nonconst<Real>();
+  for (int k=0; k<stat_size; ++k) {
+    stat_data[k] = sums[k].sum;
+  }
+
+  // Global reduction is deferred, so that it can be batched with other stats
+  all_reduce(stat_data,stat_size,MPI_SUM);
+}
+
+void FieldLatBinnedMean::
+finalize_impl ()
+{
+  auto stat_data = m_stat_field.data_nonconst<Real>();
+  if (use_repro_sums()) {
+    store_repro_sums(stat_data);
+  }
+  const int nbins = num_bins();
+  const int slice_size = m_stat_field.layout().size() / nbins;
+  for (int b=0; b<nbins; ++b) {
+    const Real bin_area = m_bin_areas[b];
+    for (int k=0; k<slice_size; ++k) {
+      auto& val = stat_data[b*slice_size+k];
+      val = bin_area>0 ? val/bin_area : m_mask_val;
+    }
+  }
+}
+
+} // namespace cldera
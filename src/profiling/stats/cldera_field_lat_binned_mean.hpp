@@ -0,0 +1,73 @@
+#ifndef CLDERA_FIELD_LAT_BINNED_MEAN_HPP
+#define CLDERA_FIELD_LAT_BINNED_MEAN_HPP
+
+#include "profiling/stats/cldera_field_stat.hpp"
+
+#include <ekat/ekat_parameter_list.hpp>
+#include <ekat/mpi/ekat_comm.hpp>
+
+namespace cldera {
+
+// Area-weighted mean of a field over several latitude bands (and, optionally,
+// longitude bands), computed in a single pass over the field.
+// The bins are defined by the (strictly increasing) edges in the parameters
+// "Latitude Bin Edges" and (optionally) "Longitude Bin Edges": the i-th bin
+// is [e_i,e_{i+1}), except for the last one, which also contains its upper edge.
+// Columns outside of all bins are ignored, and bins with no columns are set
+// to "Mask Value" (default: 0). The stat layout is the field
+// layout with the 'ncol' dim removed, and with the dims 'lat_bin' (and 'lon_bin')
+// prepended. E.g., a (ncol,lev) field yields a (lat_bin,lev) stat.
+class FieldLatBinnedMean : public FieldStat
+{
+public:
+  FieldLatBinnedMean (const ekat::Comm& comm, const ekat::ParameterList& pl);
+
+  std::string type () const override { return "lat_binned_mean"; }
+
+  FieldLayout stat_layout (const FieldLayout& field_layout) const override;
+
+  // Since we weigh by area, always use Real for the result
+  DataType stat_data_type() const override { return DataType::RealType; }
+
+  std::vector<std::string> get_aux_fields_names () const override;
+
+  int num_bins () const { return m_num_lat_bins*m_num_lon_bins; }
+
+protected:
+
+  void set_aux_fields_impl () override;
+
+  void compute_impl () override;
+
+  template <typename T, int N>
+  void do_compute_impl ();
+
+  void finalize_impl () override;
+
+  // Sums of ints are converted to Real (via the area weight), so they
+  // need reproducible sums too, if requested
+  bool use_repro_sums () const { return reproducible_sums(); }
+
+  std::vector<Real> m_lat_edges;
+  std::vector<Real> m_lon_edges;
+  int m_num_lat_bins;
+  int m_num_lon_bins;
+
+  // Value of the stat in bins with no columns
+  Real m_mask_val;
+
+  // Bin index and area of each column (stacking all parts). Columns outside
+  // of all bins have bin index -1.
+  std::vector<int>  m_col_bins;
+  std::vector<Real> m_col_areas;
+
+  // Global area of each bin
+  std::vector<Real> m_bin_areas;
+
+  // Scratch memory for the per-thread partial sums
+  std::vector<char> m_scratch;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_FIELD_LAT_BINNED_MEAN_HPP
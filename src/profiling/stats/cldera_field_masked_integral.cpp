@@ -1,11 +1,13 @@
 #include "cldera_field_masked_integral.hpp"
-#include "profiling/utils/cldera_subview_utils.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
+#include "profiling/cldera_column_decomp.hpp"
 #include "io/cldera_pnetcdf.hpp"
 
 #include <ekat/util/ekat_string_utils.hpp>
 #include <ekat/ekat_assert.hpp>
 
+#include <algorithm>
+
 namespace cldera {
 
 FieldMaskedIntegral::
@@ -108,6 +110,7 @@ set_aux_fields_impl ()
     pl.set("mask_field",m_mask_field.name());
     pl.set("average",false);
     pl.set("mask_file_name",m_params.get<std::string>("mask_file_name"));
+    pl.set("reproducible",reproducible_sums());
 
     FieldMaskedIntegral w_int_stat(m_comm,pl);
     std::map<std::string,Field> aux_fields;
@@ -164,6 +167,63 @@ set_aux_fields_impl ()
   for (auto v : mask_vals) {
     m_mask_val_to_stat_entry[v] = m_mask_val_to_stat_entry.size();
   }
+
+  // Store the stat entry of each mask dim index, so kernels don't need map lookups
+  m_mask_stat_entries.resize(size);
+  for (int i=0; i<size; ++i) {
+    m_mask_stat_entries[i] = m_mask_val_to_stat_entry.at(data[i]);
+  }
+
+  if (not m_output_mask_field) {
+    build_region_index();
+  }
+}
+
+void FieldMaskedIntegral::
+build_region_index ()
+{
+  const int size = m_mask_stat_entries.size();
+  const int num_mask_ids = m_mask_val_to_stat_entry.size();
+
+  // Count the entries of each region, then scan to get the offsets
+  m_region_offsets.assign(num_mask_ids+1,0);
+  for (auto r : m_mask_stat_entries) {
+    ++m_region_offsets[r+1];
+  }
+  for (int r=0; r<num_mask_ids; ++r) {
+    m_region_offsets[r+1] += m_region_offsets[r];
+  }
+
+  // Same assumption as in do_compute_impl: stacking the parts along the
+  // mask dim gives the index of each entry in the mask field
+  const auto& mask_dim_name = m_mask_field.layout().names()[0];
+  const int mask_dim = m_field.layout().dim_idx(mask_dim_name);
+  std::vector<int> idx_part(size), idx_col(size);
+  for (int p=0,idx=0; p<m_field.nparts(); ++p) {
+    const int n = m_field.part_layout(p).dims()[mask_dim];
+    for (int i=0; i<n; ++i,++idx) {
+      idx_part[idx] = p;
+      idx_col[idx] = i;
+    }
+  }
+
+  view_1d_host<const Real> w_view;
+  if (m_use_weight) {
+    w_view = m_weight_field.view<const Real>();
+  }
+
+  // Fill each region in order of increasing index (so the traversal of
+  // each region is as contiguous as possible in memory)
+  m_region_parts.resize(size);
+  m_region_cols.resize(size);
+  m_region_weights.resize(size);
+  std::vector<int> pos (m_region_offsets.begin(),m_region_offsets.end()-1);
+  for (int idx=0; idx<size; ++idx) {
+    const int e = pos[m_mask_stat_entries[idx]]++;
+    m_region_parts[e] = idx_part[idx];
+    m_region_cols[e] = idx_col[idx];
+    m_region_weights[e] = m_use_weight ? w_view(idx) : 1;
+  }
 }
 
 void FieldMaskedIntegral::
@@ -208,19 +268,9 @@ void FieldMaskedIntegral::
 do_compute_impl ()
 {
   auto sview = m_stat_field.nd_view_nonconst<Real,N>();
-  auto mview = m_mask_field.view<int>();
-
-  // Init stat to 0
-  Kokkos::deep_copy(sview,0.0);
-
-  view_1d_host<const Real> w_view;
-  if (m_use_weight) {
-    w_view = m_weight_field.view<const Real>();
-  }
 
   const auto& mask_dim_name = m_mask_field.layout().names()[0];
   const int mask_dim = m_field.layout().dim_idx(mask_dim_name);
-  const int part_dim = m_field.part_dim();
 
   // NOTE: we operate under the assumption that either
   //  - mask_dim==part_dim: we're integrating over the partitioned dim
@@ -228,55 +278,178 @@ do_compute_impl ()
   // If we allowed a non-masked dim to be partitioned, then we would have
   // to offset the stat indices also along the non-mask dimensions.
   // That's too many cases, which are likely never needed
+  FieldParts<T,N> parts (m_field,mask_dim);
 
-  for (int p=0; p<m_field.nparts(); ++p) {
-    auto fpl = m_field.part_layout(p);
-    auto fview = m_field.part_nd_view<T,N>(p);
+  // Number of stat entries for each mask value
+  const int num_mask_ids = sview.extent(mask_dim);
+  int slice_size = 1;
+  for (int d=0; d<N; ++d) {
+    slice_size *= d==mask_dim ? 1 : sview.extent_int(d);
+  }
 
-    // Offset of this part into the unpartitioned dimension
-    const int part_offset = m_field.part_offset(p);
+  const int* offsets = m_region_offsets.data();
+  const int* e_parts = m_region_parts.data();
+  const int* e_cols  = m_region_cols.data();
+  const Real* e_w    = m_region_weights.data();
+
+  if (reproducible_sums()) {
+    // Partial integrals can be merged in any order, since the result does not depend on it
+    const auto* sums = parallel_accumulate("FieldMaskedIntegral",parts.size(),num_mask_ids*slice_size,
+                                           ReproSum(),m_scratch,
+                                           [&](int beg, const int end, ReproSum* acc) {
+      int r = std::upper_bound(offsets,offsets+num_mask_ids+1,beg) - offsets - 1;
+      for (; beg<end; ++r) {
+        const int r_end = std::min(end,offsets[r+1]);
+        ReproSum* mask_acc = acc + r*slice_size;
+        for (int e=beg; e<r_end; ++e) {
+          const Real w = e_w[e];
+          parts.for_each_in_slice(e_parts[e],e_cols[e],[&](const int k, const T val) {
+            mask_acc[k] += val * w;
+          });
+        }
+        beg = r_end;
+      }
+    },[](ReproSum& dst, const ReproSum& src) { dst += src; });
+    m_repro_sums.assign(sums,sums+num_mask_ids*slice_size);
+    register_reductions();
+    return;
+  }
 
-    const int mask_dim_offset = mask_dim==part_dim ? part_offset : 0;
-    const int mask_dim_ext = fpl.extent(mask_dim_name);
-    for (int i=0; i<mask_dim_ext; ++i) {
-      auto mval = mview(i+mask_dim_offset);
-      auto midx = m_mask_val_to_stat_entry.at(mval);
-      auto w = m_use_weight ? w_view(i+mask_dim_offset) : 1;
+  // Each thread integrates over a contiguous range of the region-sorted
+  // entries (see build_region_index), so it only needs to switch accumulator
+  // when it moves to the next region. Partial integrals are then combined in
+  // a fixed order. Accumulators are stored as (mask_id, slice_entry).
+  const Real* integrals = parallel_accumulate<Real>("FieldMaskedIntegral",
+                                                    parts.size(),num_mask_ids*slice_size,
+                                                    0,m_scratch,
+                                                    [&](int beg, const int end, Real* acc) {
+    int r = std::upper_bound(offsets,offsets+num_mask_ids+1,beg) - offsets - 1;
+    for (; beg<end; ++r) {
+      const int r_end = std::min(end,offsets[r+1]);
+      Real* mask_acc = acc + r*slice_size;
       if constexpr (N==1) {
-        sview(midx) += fview(i) * w;
+        Real sum = 0;
+        for (int e=beg; e<r_end; ++e) {
+          sum += parts.view(e_parts[e])(e_cols[e]) * e_w[e];
+        }
+        mask_acc[0] += sum;
       } else {
-        auto f_slice = slice(fview,mask_dim,i);
-        auto s_slice = slice(sview,mask_dim,midx);
-        for (int j=0; j<f_slice.extent_int(0); ++j) {
-          if constexpr (N==2) {
-            s_slice(j) += f_slice(j) * w;
-          } else {
-             for (int k=0; k<f_slice.extent_int(1); ++k) {
-               s_slice(j,k) += f_slice(j,k) * w;
-             }
+        for (int e=beg; e<r_end; ++e) {
+          const Real w = e_w[e];
+          parts.for_each_in_slice(e_parts[e],e_cols[e],[&](const int k, const T val) {
+            mask_acc[k] += val * w;
+          });
+        }
+      }
+      beg = r_end;
+    }
+  },[](Real& dst, const Real src) { dst += src; });
+  do_store_local_integrals<N>(integrals);
+
+  // Global reduction is deferred, so that it can be batched with other stats
+  register_reductions();
+}
+
+void FieldMaskedIntegral::
+register_reductions () {
+  if (reproducible_sums()) {
+    all_reduce_repro_sums();
+  } else {
+    all_reduce_stat_field(MPI_SUM);
+  }
+}
+
+void FieldMaskedIntegral::
+store_local_integrals (const Real* integrals) {
+  switch (m_field.layout().rank()) {
+    case 1: return do_store_local_integrals<1>(integrals);
+    case 2: return do_store_local_integrals<2>(integrals);
+    case 3: return do_store_local_integrals<3>(integrals);
+  }
+}
+
+template<int N>
+void FieldMaskedIntegral::
+do_store_local_integrals (const Real* integrals)
+{
+  auto sview = m_stat_field.nd_view_nonconst<Real,N>();
+
+  const auto& mask_dim_name = m_mask_field.layout().names()[0];
+  const int mask_dim = m_field.layout().dim_idx(mask_dim_name);
+
+  const int num_mask_ids = sview.extent(mask_dim);
+  int slice_size = 1;
+  for (int d=0; d<N; ++d) {
+    slice_size *= d==mask_dim ? 1 : sview.extent_int(d);
+  }
+
+  for (int midx=0; midx<num_mask_ids; ++midx) {
+    const Real* mask_int = integrals + midx*slice_size;
+    if constexpr (N==1) {
+      sview(midx) = mask_int[0];
+    } else {
+      auto s_slice = slice(sview,mask_dim,midx);
+      for (int j=0; j<s_slice.extent_int(0); ++j) {
+        if constexpr (N==2) {
+          s_slice(j) = mask_int[j];
+        } else {
+          const int n1 = s_slice.extent_int(1);
+          for (int k=0; k<n1; ++k) {
+            s_slice(j,k) = mask_int[j*n1+k];
           }
         }
       }
     }
   }
-  track_mpi_all_reduce(m_comm,sview.data(),sview.size(),MPI_SUM,name());
+}
 
-  if (m_average) {
-    auto wint_v = m_weight_integral.view<Real>();
-    auto num_mask_ids = sview.extent(mask_dim);
-    for (int i=0; i<num_mask_ids; ++i) {
-      auto w = wint_v(i);
-      if constexpr (N==1) {
-        sview(i) /= w;
-      } else {
-        auto s_slice = slice(sview,mask_dim,i);
-        for (int j=0; j<s_slice.extent_int(0); ++j) {
-          if constexpr (N==2) {
-            s_slice(j) /= w;
-          } else {
-            for (int k=0; k<s_slice.extent_int(1); ++k) {
-              s_slice(j,k) /= w;
-            }
+void FieldMaskedIntegral::
+finalize_impl () {
+  if (m_output_mask_field) {
+    return;
+  }
+
+  if (reproducible_sums()) {
+    // Sums are ordered as (mask_id,slice_entry)
+    m_repro_integrals.resize(m_repro_sums.size());
+    store_repro_sums(m_repro_integrals.data());
+    store_local_integrals(m_repro_integrals.data());
+  }
+
+  if (not m_average) {
+    return;
+  }
+
+  switch (m_field.layout().rank()) {
+    case 1: return do_finalize_impl<1>();
+    case 2: return do_finalize_impl<2>();
+    case 3: return do_finalize_impl<3>();
+  }
+}
+
+template<int N>
+void FieldMaskedIntegral::
+do_finalize_impl ()
+{
+  auto sview = m_stat_field.nd_view_nonconst<Real,N>();
+
+  const auto& mask_dim_name = m_mask_field.layout().names()[0];
+  const int mask_dim = m_field.layout().dim_idx(mask_dim_name);
+
+  auto wint_v = m_weight_integral.view<Real>();
+  auto num_mask_ids = sview.extent(mask_dim);
+  for (int i=0; i<num_mask_ids; ++i) {
+    auto w = wint_v(i);
+    if constexpr (N==1) {
+      sview(i) /= w;
+    } else {
+      auto s_slice = slice(sview,mask_dim,i);
+      for (int j=0; j<s_slice.extent_int(0); ++j) {
+        if constexpr (N==2) {
+          s_slice(j) /= w;
+        } else {
+          for (int k=0; k<s_slice.extent_int(1); ++k) {
+            s_slice(j,k) /= w;
           }
         }
       }
@@ -298,43 +471,8 @@ load_mask_field (const Field& my_col_gids)
       " - file name: " + filename + "\n"
       " - mask name: " + mask_name + "\n");
 
-  // Ensure gids field has just one part
-  Field gids_1p;
-  if (my_col_gids.nparts()==1) {
-    gids_1p = my_col_gids;
-  } else {
-    auto& s = StatFactory::instance();
-    ekat::ParameterList pl;
-    pl.set("name",m_name + "::load_mask_field::col_gids");
-    auto id = s.create("identity",m_comm,pl);
-    id->set_field(my_col_gids);
-    id->create_stat_field();
-    gids_1p = id->compute(m_timestamp);
-  }
-
-  // Compute min gid (so we get offsets right)
-  int min_gid;
-  {
-    auto& s = StatFactory::instance();
-    ekat::ParameterList pl;
-    pl.set("name",m_name + "::load_mask_field::min_gid");
-    auto min_gid_stat = s.create("global_min",m_comm,pl);
-    min_gid_stat->set_field(gids_1p);
-    min_gid_stat->create_stat_field();
-    min_gid = min_gid_stat->compute(m_timestamp).data<int>()[0];
-  }
-
-  // Create offsets
-  std::vector<int> offsets;
-  const int num_gids = gids_1p.layout().size();
-  offsets.reserve(num_gids);
-  auto gids = gids_1p.data<int>();
-  for (int i=0; i<num_gids; ++i) {
-    offsets.push_back(gids[i]-min_gid);
-  }
-
-  // Add decomp for pnetcdf
-  io::pnetcdf::add_decomp (*file,"ncol",offsets);
+  // Add decomp for pnetcdf (shared with all other files using the same columns)
+  ColumnDecomp::get(m_comm,my_col_gids)->attach(*file);
 
   // Check mask var specs
   auto print_dims = [] (const std::vector<std::shared_ptr<const io::pnetcdf::NCDim>>& dims) {
@@ -363,7 +501,7 @@ load_mask_field (const Field& my_col_gids)
       " - field layout : " + ekat::join(m_field.layout().names(),",") + "\n");
 
   // Read mask
-  Field mask_field(mask_name,gids_1p.layout(),DataAccess::Copy,DataType::IntType);
+  Field mask_field(mask_name,my_col_gids.layout(),DataAccess::Copy,DataType::IntType);
   mask_field.commit();
   io::pnetcdf::read_var(*file,mask_name,mask_field.data_nonconst<int>());
 
@@ -19,7 +19,16 @@ public:
 
   // Since we may have weights, let's just always use Real for the result.
   DataType stat_data_type() const override { return DataType::RealType; }
+
+  FusedKernel fused_kernel () const override {
+    return m_output_mask_field or reproducible_sums()
+         ? FusedKernel::None : FusedKernel::MaskedIntegral;
+  }
+
+  // Name of the (only) dimension of the mask field
+  const std::string& get_mask_dim_name () const { return m_mask_field.layout().names()[0]; }
 protected:
+  friend class FusedFieldStats;
 
   void set_aux_fields_impl () override;
 
@@ -28,13 +37,41 @@ protected:
   template<typename T, int N>
   void do_compute_impl ();
 
+  void register_reductions () override;
+
+  // Store in the stat field the local integrals, ordered as (mask_id,slice_entry)
+  void store_local_integrals (const Real* integrals);
+
+  template<int N>
+  void do_store_local_integrals (const Real* integrals);
+
+  void finalize_impl () override;
+
+  template<int N>
+  void do_finalize_impl ();
+
   void load_mask_field (const Field& my_col_gids);
 
+  // Group the indices along the mask dim by mask value (see m_region_offsets)
+  void build_region_index ();
+
   // The mask field
   Field         m_mask_field;
 
   // Map every mask value to an index in [0,N), with N=number_of_mask_values
   std::map<int,int>   m_mask_val_to_stat_entry;
+
+  // The stat entry of each index along the mask dim
+  std::vector<int>    m_mask_stat_entries;
+
+  // Indices along the mask dim, sorted by stat entry (CSR-like): the entries of
+  // the r-th mask value are in [m_region_offsets[r],m_region_offsets[r+1]).
+  // For each entry, we store the field part and the index within the part,
+  // as well as the integration weight (1 if there is no weight field)
+  std::vector<int>    m_region_offsets;
+  std::vector<int>    m_region_parts;
+  std::vector<int>    m_region_cols;
+  std::vector<Real>   m_region_weights;
   
   // Optionally, we weigh the integrand by a weight field
   bool          m_use_weight;
@@ -44,6 +81,10 @@ protected:
 
   // Allows to have a stat that saves the mask field
   bool          m_output_mask_field;
+
+  // Scratch memory for the per-thread partial integrals
+  std::vector<char>   m_scratch;
+  std::vector<Real>   m_repro_integrals;
 };
 
 } // namespace cldera
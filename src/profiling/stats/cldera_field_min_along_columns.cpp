@@ -1,6 +1,5 @@
 #include "cldera_field_min_along_columns.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
-#include "profiling/utils/cldera_subview_utils.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
 
 #include <limits>
 
@@ -42,41 +41,26 @@ template<typename T, int N>
 void FieldMinAlongColumns::
 do_compute_impl () {
   auto stat_view = m_stat_field.nd_view_nonconst<T,N-1>();
-  Kokkos::deep_copy(stat_view, std::numeric_limits<T>::max());
 
-  // NOTE: stat_view extents are ok, since the stat is created without
-  //       padding. OTOH, the input field may be a subview of some other
-  //       array, so it may contain padding. Hence, you can use stat_view's
-  //       extents in your loop boundaries.
-  int col_dim = m_field.layout().idim(m_axis_name);
-  for (int p=0; p<m_field.nparts(); ++p) {
-    const auto& pl = m_field.part_layout(p);
-    const auto& fview = m_field.part_nd_view<const T,N>(p);
-    const int ncols = pl.extent(m_axis_name);
-    if constexpr (N==1) {
-      for (int icol=0; icol<ncols; ++icol) {
-        stat_view() = std::min(stat_view(),fview[icol]);
-      }
-    } else if constexpr (N==2) {
-      for (int icol=0; icol<ncols; ++icol) {
-        auto f_slice = slice(fview,col_dim,icol);
-        for (size_t j=0; j<stat_view.extent(0); ++j) {
-          stat_view(j) = std::min(stat_view(j),f_slice(j));
-        }
-      }
-    } else {
-      for (int icol=0; icol<ncols; ++icol) {
-        auto f_slice = slice(fview,col_dim,icol);
-        for (size_t j=0; j<stat_view.extent(0); ++j) {
-          for (size_t k=0; k<stat_view.extent(1); ++k) {
-            stat_view(j,k) = std::min(stat_view(j,k),f_slice(j,k));
-        }}
-      }
-    }
-  }
+  // Each thread computes the min over a contiguous range of columns, for all
+  // the stat entries. The partial results are then combined.
+  // NOTE: stat_view is created without padding, so the flattened index
+  //       of an entry in a column slice is the same as in stat_view.
+  const int col_dim = m_field.layout().idim(m_axis_name);
+  const int stat_size = stat_view.size();
+  FieldParts<T,N> parts (m_field,col_dim);
+  auto join = [](T& dst, const T src) { dst = std::min(dst,src); };
+  const T* col_min = parallel_accumulate<T>("FieldMinAlongColumns",parts.size(),stat_size,
+                                            std::numeric_limits<T>::max(),m_scratch,
+                                            [&](const int beg, const int end, T* acc) {
+    parts.for_each_entry(beg,end,[&](const int, const int k, const T val) {
+      join(acc[k],val);
+    });
+  },join);
+  std::copy(col_min,col_min+stat_size,stat_view.data());
 
-  // Clock MPI ops
-  track_mpi_all_reduce(m_comm,stat_view.data(),stat_view.size(),MPI_MIN,name());
+  // Global reduction is deferred, so that it can be batched with other stats
+  register_reductions();
 }
 
 } // namespace cldera
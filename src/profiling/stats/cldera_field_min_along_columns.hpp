@@ -16,11 +16,17 @@ public:
 
   std::string type () const override { return "min_along_columns"; }
 
+  FusedKernel fused_kernel () const override { return FusedKernel::MinAlongColumns; }
+
 protected:
   void compute_impl () override;
 
+  void register_reductions () override { all_reduce_stat_field(MPI_MIN); }
+
   template<typename T, int N>
   void do_compute_impl ();
+
+  std::vector<char> m_scratch;
 };
 
 } // namespace cldera
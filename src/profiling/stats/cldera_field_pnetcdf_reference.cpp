@@ -0,0 +1,212 @@
+#include "profiling/stats/cldera_field_pnetcdf_reference.hpp"
+#include "profiling/cldera_column_decomp.hpp"
+
+#include <algorithm>
+
+namespace cldera {
+
+FieldPnetcdfReference::
+FieldPnetcdfReference (const ekat::Comm& comm,
+                       const ekat::ParameterList& pl)
+ : FieldSinglePartStat (comm,pl)
+ , m_lat_bounds(pl.get<std::vector<Real>>("Latitude Bounds"))
+ , m_lon_bounds(pl.get<std::vector<Real>>("Longitude Bounds"))
+ , m_mask_val(m_params.get("Mask Value",0.0))
+ , m_pnetcdf_filename(pl.get<std::string>("Pnetcdf Filename"))
+ , m_time_step_ratio(pl.get<int>("Time Step Ratio"))
+ , m_time_interp(m_params.get("Time Interpolation",false))
+ , m_ref_field_name(pl.get<std::string>("Reference Field Name"))
+ , m_ref_deviation_name(pl.get<std::string>("Reference Deviation Field Name"))
+{
+  // Nothing to do here
+}
+
+FieldPnetcdfReference::
+~FieldPnetcdfReference()
+{
+  // Don't throw from the destructor: just make sure the helper thread is done
+  if (m_prefetch.valid()) {
+    m_prefetch.wait();
+  }
+  reset();
+}
+
+void FieldPnetcdfReference::
+reset ()
+{
+  if (m_prefetch.valid()) {
+    m_prefetch.wait();
+    m_prefetch = std::future<void>();
+  }
+
+  m_lat = m_lon = m_colgids = nullptr;
+  m_timeindex = m_pnetcdf_timeindex = 0;
+  if (m_pnetcdf_file) {
+    io::pnetcdf::close_file(*m_pnetcdf_file);
+    m_pnetcdf_file = nullptr;
+  }
+  if (m_inited and m_async) {
+    auto io_comm = m_io_comm.mpi_comm();
+    MPI_Comm_free(&io_comm);
+  }
+  m_ref_var_dims.clear();
+  m_slices.clear();
+  m_head = 0;
+
+  m_inited = false;
+}
+
+void FieldPnetcdfReference::
+initialize(const std::shared_ptr<const Field>& lat, const std::shared_ptr<const Field>& lon,
+           const std::shared_ptr<const Field>& col_gids)
+{
+  if (m_inited) {
+    return;
+  }
+
+  EKAT_REQUIRE_MSG(lat->name() == "lat" && lon->name() == "lon",
+      "Error! Field names are not lat and lon!\n");
+  m_lat = lat;
+  m_lon = lon;
+  m_colgids = col_gids;
+  m_timeindex = 0;
+  m_pnetcdf_timeindex = 0;
+
+  // Reads on the helper thread need MPI_THREAD_MULTIPLE, and a separate comm
+  m_io_comm = m_comm;
+  m_async = m_params.get("Prefetch",true);
+  if (m_async) {
+    int provided;
+    MPI_Query_thread(&provided);
+    if (provided<MPI_THREAD_MULTIPLE) {
+      if (m_comm.am_i_root()) {
+        printf(" [CLDERA] WARNING: prefetching reference data requires MPI_THREAD_MULTIPLE.\n"
+               "   Slices will be read on the compute path.\n");
+      }
+      m_async = false;
+    } else {
+      MPI_Comm io_comm;
+      MPI_Comm_dup(m_comm.mpi_comm(),&io_comm);
+      m_io_comm = ekat::Comm(io_comm);
+    }
+  }
+
+  // open the pnetcdf file
+  m_pnetcdf_file = io::pnetcdf::open_file(m_pnetcdf_filename,m_io_comm,io::pnetcdf::IOMode::Read);
+
+  // grab relevant dims (time x lev x col)
+  m_ntime = m_pnetcdf_file->dims.at("time")->len;
+
+  // we need a decomp to read the file - use the one of the column GIDs from the archive
+  ColumnDecomp::get(m_comm,*m_colgids)->attach(*m_pnetcdf_file);
+
+  // grab variables from the file now that we've decomposed it
+  auto ref_var = m_pnetcdf_file->vars.at(m_ref_field_name);
+  auto ref_dev_var = m_pnetcdf_file->vars.at(m_ref_deviation_name);
+
+  // store layout, and check that the fields have the same layouts and sizes
+  m_ref_var_dims = std::vector<int>(ref_var->dims.size(),0);
+  EKAT_REQUIRE_MSG(ref_var->dims.size() == ref_dev_var->dims.size(),
+      "Error! The pnetcdf reference field and reference deviation field do not have the dims size!\n");
+  for(unsigned int i=0; i<ref_var->dims.size(); ++i) {
+    m_ref_var_dims[i] = ref_var->dims[i]->len;
+    EKAT_REQUIRE_MSG(ref_var->dims[i]->len == ref_dev_var->dims[i]->len,
+        "Error! The reference field and reference deviation field have unequal len on dim " + std::to_string(i) + "\n");
+    EKAT_REQUIRE_MSG(ref_var->dims[i]->name == ref_dev_var->dims[i]->name,
+        "Error! The reference field and reference deviation field have unequal name on dim " + std::to_string(i) + "\n");
+  }
+
+  // Allocate the ring of slices once: the current one (and the next, if interpolating)
+  // are read now, while the following one is prefetched
+  const int nslices = m_time_interp ? 3 : 2;
+  m_slices.resize(nslices);
+  for (auto& s : m_slices) {
+    s.index = -1;
+    s.ref.resize(ref_var->size);
+    s.dev.resize(ref_var->size);
+  }
+  m_head = 0;
+  for (int i=0; i<nslices-1; ++i) {
+    read_slice(m_slices[i],i);
+  }
+  m_inited = true;
+
+  prefetch_slice(nslices-1,nslices-1);
+}
+
+void FieldPnetcdfReference::
+compute_impl()
+{
+  EKAT_REQUIRE_MSG(m_lat != nullptr && m_lon != nullptr && m_colgids != nullptr,
+      "Error! lat/lon/col_gids fields not initialized!\n");
+
+  const int nparts = m_field.nparts();
+  EKAT_REQUIRE_MSG(nparts == m_lat->nparts() && nparts == m_lon->nparts() && nparts == m_colgids->nparts(),
+      "Error! Field " + m_field.name() + " should have the same number of parts as lat/lon/col_gids!\n");
+
+  const auto dt = m_field.data_type();
+  if(dt==IntType) {
+    do_compute_impl<int>();
+  } else if(dt==RealType) {
+    do_compute_impl<Real>();
+  } else {
+    EKAT_ERROR_MSG("[FieldPnetcdfReference] Unrecognized/unsupported data type (" + e2str(dt) + ")\n");
+  }
+}
+
+void FieldPnetcdfReference::
+update_refvar_data() const
+{
+  // TODO: handle the time stepping sync between E3SM and pnetcdf better
+  m_timeindex++;
+
+  if(m_timeindex % m_time_step_ratio == 0) {
+    m_pnetcdf_timeindex = m_timeindex/m_time_step_ratio;
+
+    // The next slice was read ahead: rotate the ring, and start
+    // reading the slice that follows the last one in the ring
+    const int nslices = m_slices.size();
+    wait_prefetch();
+    m_head = (m_head+1) % nslices;
+    prefetch_slice((m_head+nslices-1) % nslices,m_pnetcdf_timeindex+nslices-1);
+  }
+}
+
+void FieldPnetcdfReference::
+read_slice (RefSlice& slice, const int index, const bool timed) const
+{
+  const int record = std::min(index,m_ntime-1);
+  if (slice.index==record) {
+    return;
+  }
+  read_var(*m_pnetcdf_file,m_ref_field_name,slice.ref.data(),record,timed);
+  read_var(*m_pnetcdf_file,m_ref_deviation_name,slice.dev.data(),record,timed);
+  slice.index = record;
+}
+
+void FieldPnetcdfReference::
+prefetch_slice (const int buf, const int index) const
+{
+  auto& slice = m_slices[buf];
+  if (m_async) {
+    // Timers can only be used by one thread at a time, and the main thread
+    // (or another reference stat) may be reading at the same time, so
+    // reads on the helper thread are not timed
+    m_prefetch = std::async(std::launch::async,[this,&slice,index]() {
+      read_slice(slice,index,false);
+    });
+  } else {
+    read_slice(slice,index);
+  }
+}
+
+void FieldPnetcdfReference::
+wait_prefetch () const
+{
+  if (m_prefetch.valid()) {
+    // Rethrows any exception thrown on the helper thread
+    m_prefetch.get();
+  }
+}
+
+} // namespace cldera
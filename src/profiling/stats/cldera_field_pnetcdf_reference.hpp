@@ -3,149 +3,50 @@
 
 #include "profiling/stats/cldera_field_stat.hpp"
 #include "profiling/stats/cldera_field_stat_utils.hpp"
-#include "profiling/stats/cldera_field_identity.hpp"
 
 #include "io/cldera_pnetcdf.hpp"
 
 #include <ekat/ekat_parameter_list.hpp>
 #include <ekat/mpi/ekat_comm.hpp>
 
+#include <future>
 #include <memory>
 
 namespace cldera {
 
+/*
+ * Squared normalized deviation of a field from reference data stored in a
+ * pnetcdf file, as (ref-f)^2/dev^2, masked outside of a lat/lon box.
+ *
+ * The reference data has one time slice every 'Time Step Ratio' steps. The
+ * slices are kept in a ring of preallocated buffers, and the next slice is
+ * read ahead on a helper thread (on a duplicate of the comm), so that crossing
+ * a slice boundary only swaps buffers. If 'Time Interpolation' is true, the
+ * reference data is linearly interpolated in time between two slices, so that
+ * the comparison does not jump at slice boundaries. If MPI does not provide
+ * MPI_THREAD_MULTIPLE, or 'Prefetch' is false, the next slice is read right
+ * away on the compute path instead.
+ */
+
 class FieldPnetcdfReference : public FieldSinglePartStat
 {
 public:
   FieldPnetcdfReference (const ekat::Comm& comm,
-                         const ekat::ParameterList& pl)
-   : FieldSinglePartStat (comm,pl)
-   , m_lat_bounds(pl.get<std::vector<Real>>("Latitude Bounds"))
-   , m_lon_bounds(pl.get<std::vector<Real>>("Longitude Bounds"))
-   , m_mask_val(m_params.get("Mask Value",0.0))
-   , m_pnetcdf_filename(pl.get<std::string>("Pnetcdf Filename"))
-   , m_time_step_ratio(pl.get<int>("Time Step Ratio"))
-   , m_ref_field_name(pl.get<std::string>("Reference Field Name"))
-   , m_ref_deviation_name(pl.get<std::string>("Reference Deviation Field Name"))
-  { /* Nothing to do here */ }
-
-  ~FieldPnetcdfReference() {
-    io::pnetcdf::close_file(*m_pnetcdf_file);
-  }
+                         const ekat::ParameterList& pl);
+
+  ~FieldPnetcdfReference();
 
   std::string type() const override { return "pnetcdf_reference"; }
 
   FieldLayout stat_layout (const FieldLayout& fl) const { return fl; }
 
-  void reset () {
-    m_lat = m_lon = m_colgids = nullptr;
-    m_timeindex = m_pnetcdf_timeindex = 0;;
-    if (m_pnetcdf_file) {
-      io::pnetcdf::close_file(*m_pnetcdf_file);
-    }
-    m_ref_var_dims.clear();
-    m_refvar_data.clear();
-    m_refvardev_data.clear();
-
-    m_inited = false;
-  }
+  void reset ();
 
   void initialize(const std::shared_ptr<const Field>& lat, const std::shared_ptr<const Field>& lon,
-                  const std::shared_ptr<const Field>& col_gids) {
-    if (m_inited) {
-      return;
-    }
-
-    EKAT_REQUIRE_MSG(lat->name() == "lat" && lon->name() == "lon",
-        "Error! Field names are not lat and lon!\n");
-    m_lat = lat;
-    m_lon = lon;
-    m_colgids = col_gids;
-    m_timeindex = 0;
-    m_pnetcdf_timeindex = 0;
-
-    // open the pnetcdf file
-    m_pnetcdf_file = io::pnetcdf::open_file(m_pnetcdf_filename,m_comm,io::pnetcdf::IOMode::Read);
-    
-    // grab relevant dims (time x lev x col)
-    auto timedim = m_pnetcdf_file->dims.at("time");
-    auto levdim = m_pnetcdf_file->dims.at("lev");
-    auto coldim = m_pnetcdf_file->dims.at("ncol");
-
-    // set "realistic" field params using the dims
-    int m_ntime = timedim->len;
-    int m_nlev = levdim->len;
-    int m_ncol = coldim->len;
-    
-    // we need a decomp to read the file - use the column GIDs from the archive
-    // first, make an identity stat to get them on one part
-    auto identity_pl = ekat::ParameterList("identity");
-    FieldIdentity column_id_stat(m_comm,identity_pl);
-    column_id_stat.set_field(*m_colgids);
-    auto singlepartgids = column_id_stat.compute(TimeStamp());
-
-    // second, use the single-part stat to make a decomp
-    auto ngids = singlepartgids.layout().size();
-    std::vector<int> my_cols(ngids);
-    auto gids = singlepartgids.template data<int>();
-    std::copy(gids,gids+ngids,my_cols.begin());
-    for(size_t i=0; i<my_cols.size(); ++i) {
-      my_cols[i] = my_cols[i] - 1; // GH: offset column map by 1 since E3SM orders starting at 1, but we need to start at 0
-    }
-    io::pnetcdf::add_decomp(*m_pnetcdf_file,"ncol",my_cols);
-
-    // TODO: use something like this to handle timestepping sync
-    // m_times = std::vector<double>(m_ntime,0.0);
-    // for(unsigned int i=0; i<m_ntime; ++i) {
-    //   read_var(*m_pnetcdf_file,"time",&(m_times[i]),i);
-    // }
-
-    // grab variables from the file now that we've decomposed it
-    // we want to copy the data we need and then close the file
-    std::cout << "Looking for ref_var " + m_ref_field_name << std::endl;
-    auto ref_var = m_pnetcdf_file->vars.at(m_ref_field_name);
-    std::cout << "Looking for ref_dev_var " + m_ref_deviation_name << std::endl;
-    auto ref_dev_var = m_pnetcdf_file->vars.at(m_ref_deviation_name);
-
-    // store layout, and check that the fields have the same layouts and sizes
-    m_ref_var_dims = std::vector<int>(ref_var->dims.size(),0);
-    EKAT_REQUIRE_MSG(ref_var->dims.size() == ref_dev_var->dims.size(),
-        "Error! The pnetcdf reference field and reference deviation field do not have the dims size!\n");
-    for(unsigned int i=0; i<ref_var->dims.size(); ++i) {
-      m_ref_var_dims[i] = ref_var->dims[i]->len;
-      EKAT_REQUIRE_MSG(ref_var->dims[i]->len == ref_dev_var->dims[i]->len,
-          "Error! The reference field and reference deviation field have unequal len on dim " + std::to_string(i) + "\n");
-      EKAT_REQUIRE_MSG(ref_var->dims[i]->name == ref_dev_var->dims[i]->name,
-          "Error! The reference field and reference deviation field have unequal name on dim " + std::to_string(i) + "\n");
-    }
-
-    // load the correct slice of the variable of interest
-    m_refvar_data = std::vector<float>(m_nlev*m_ncol,0.0); // reference variable data
-    m_refvardev_data = std::vector<float>(m_nlev*m_ncol,0.0); // reference variable deviation data
-    read_var(*m_pnetcdf_file,m_ref_field_name,m_refvar_data.data(), m_pnetcdf_timeindex);
-    read_var(*m_pnetcdf_file,m_ref_deviation_name,m_refvardev_data.data(),m_pnetcdf_timeindex);
-
-    m_inited = true;
-  }
+                  const std::shared_ptr<const Field>& col_gids);
 
 protected:
-  void compute_impl() override {
-    EKAT_REQUIRE_MSG(m_lat != nullptr && m_lon != nullptr && m_colgids != nullptr,
-        "Error! lat/lon/col_gids fields not initialized!\n");
-
-    const int nparts = m_field.nparts();
-    EKAT_REQUIRE_MSG(nparts == m_lat->nparts() && nparts == m_lon->nparts() && nparts == m_colgids->nparts(),
-        "Error! Field " + m_field.name() + " should have the same number of parts as lat/lon/col_gids!\n");
-
-    const auto dt = m_field.data_type();
-    if(dt==IntType) {
-      do_compute_impl<int>();
-    } else if(dt==RealType) {
-      do_compute_impl<Real>();
-    } else {
-      EKAT_ERROR_MSG("[FieldPnetcdfReference] Unrecognized/unsupported data type (" + e2str(dt) + ")\n");
-    }
-  }
+  void compute_impl() override;
 
   template <typename T>
   void do_compute_impl() {
@@ -153,6 +54,12 @@ protected:
     // this increments m_timestep and only updates the data every time_step_ratio steps
     update_refvar_data();
 
+    // the slice(s) to compare against, and the interpolation weight of the second one
+    const int nslices = m_slices.size();
+    const auto& ref0 = m_slices[m_head];
+    const auto& ref1 = m_slices[(m_head+1) % nslices];
+    const float w = m_time_interp ? float(m_timeindex % m_time_step_ratio) / m_time_step_ratio : 0;
+
     // use the provided strides to make things easier
     // assuming the same strides for the field and the pnetcdf file are applicable
     const auto& stat_strides = compute_stat_strides(m_field.layout());
@@ -173,7 +80,13 @@ protected:
         const Real lon_val = lon_part_data[geo_part_index];
         if (lat_val > m_lat_bounds.min && lat_val < m_lat_bounds.max &&
             lon_val > m_lon_bounds.min && lon_val < m_lon_bounds.max) {
-          double tmp = (m_refvar_data[field_part_index] - field_part_data[field_part_index])/(m_refvardev_data[field_part_index]);
+          double ref = ref0.ref[field_part_index];
+          double dev = ref0.dev[field_part_index];
+          if (w>0) {
+            ref += w*(ref1.ref[field_part_index] - ref);
+            dev += w*(ref1.dev[field_part_index] - dev);
+          }
+          double tmp = (ref - field_part_data[field_part_index])/dev;
           pnetcdf_reference_field(stat_index) = tmp*tmp;
         }
         else
@@ -182,45 +95,40 @@ protected:
     }
   }
 
-  void update_refvar_data() const {
-    // TODO: handle the time stepping sync between E3SM and pnetcdf better
-    m_timeindex++;
-    m_pnetcdf_timeindex = m_timeindex/m_time_step_ratio;
-
-    if(m_timeindex % m_time_step_ratio == 0) {
-      // grab variables from the file now that we've decomposed it
-      // we want to copy the data we need and then close the file
-      auto ref_var = m_pnetcdf_file->vars.at(m_ref_field_name);
-      auto ref_dev_var = m_pnetcdf_file->vars.at(m_ref_deviation_name);
-
-      // load the correct slice of the variable of interest
-      m_refvar_data = std::vector<float>(m_nlev*m_ncol,0.0); // reference variable data
-      m_refvardev_data = std::vector<float>(m_nlev*m_ncol,0.0); // reference variable deviation data
-      read_var(*m_pnetcdf_file,m_ref_field_name,m_refvar_data.data(),m_pnetcdf_timeindex);
-      read_var(*m_pnetcdf_file,m_ref_deviation_name,m_refvardev_data.data(),m_pnetcdf_timeindex);
-    }
-  }
+  // A time slice of the reference data
+  struct RefSlice {
+    int                 index = -1;
+    std::vector<float>  ref;
+    std::vector<float>  dev;
+  };
+
+  void update_refvar_data() const;
+
+  // Read a slice (clamped to the last one in the file) in the given buffer
+  void read_slice (RefSlice& slice, const int index, const bool timed = true) const;
+
+  // Start reading a slice in the given buffer (on the helper thread, if any)
+  void prefetch_slice (const int buf, const int index) const;
+  void wait_prefetch () const;
 
-  /// the communicator
-  const ekat::Comm m_comm;
   /// the fields from E3SM
   std::shared_ptr<const Field> m_lat, m_lon, m_colgids;
-  
+
   /// bounds for masking latitude and longitude (radians)
   const Bounds<Real> m_lat_bounds, m_lon_bounds;
   /// mask value (default: 0.0)
   const Real m_mask_val;
-  
+
   /// filename for the pnetcdf reference data
   const std::string m_pnetcdf_filename;
   /// pointer to the pnetcdf file
   std::shared_ptr<io::pnetcdf::NCFile> m_pnetcdf_file;
-  
-  /// number of levels in the reference data
-  int m_nlev;
-  /// number of columns in the reference data
-  int m_ncol;
-  
+  /// comm used for the file (a duplicate of m_comm, if reads run on the helper thread)
+  ekat::Comm m_io_comm;
+
+  /// number of time slices in the reference data
+  int m_ntime;
+
   /// dimensions of reference data, may be beneficial later
   std::vector<int> m_ref_var_dims;
   /// the number of times this stat has been called (assumes once per time step)
@@ -229,16 +137,21 @@ protected:
   mutable int m_pnetcdf_timeindex;
   /// the time step ratio such that m_timeindex = m_pnetcdf_timeindex / m_time_step_ratio
   const int m_time_step_ratio;
-  
+  /// whether to interpolate linearly in time between slices (default: false)
+  const bool m_time_interp;
+  /// whether to read the next slice on a helper thread (default: true)
+  bool m_async;
+
   /// name of the reference field
   const std::string m_ref_field_name;
-  /// values of reference data
-  mutable std::vector<float> m_refvar_data;
-  
   /// name of the reference deviation field
   const std::string m_ref_deviation_name;
-  /// values of reference deviation data
-  mutable std::vector<float> m_refvardev_data;
+
+  /// ring of slices: m_slices[m_head] is the current one, followed by the ones
+  /// read ahead. The last one in the ring is the one being prefetched.
+  mutable std::vector<RefSlice> m_slices;
+  mutable int m_head = 0;
+  mutable std::future<void> m_prefetch;
 
   bool m_inited = false;
 };
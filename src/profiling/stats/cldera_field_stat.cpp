@@ -1,11 +1,79 @@
 #include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/cldera_field_arena.hpp"
 
 #include "timing/cldera_timing_session.hpp"
 
+#include <iomanip>
+#include <sstream>
+
 namespace cldera {
 
+namespace {
+
+template<typename T>
+std::string to_string (const T& v) {
+  std::stringstream ss;
+  ss << std::setprecision(17) << v;
+  return ss.str();
+}
+
+template<typename T>
+std::string to_string (const std::vector<T>& v) {
+  std::string s = "[";
+  for (const auto& x : v) {
+    s += to_string(x) + ",";
+  }
+  return s + "]";
+}
+
+template<typename T>
+bool append_param (std::string& s, const ekat::ParameterList& pl, const std::string& name) {
+  if (not pl.isType<T>(name)) {
+    return false;
+  }
+  s += name + "=" + to_string(pl.get<T>(name)) + ";";
+  return true;
+}
+
+// Serialize all parameters (in the order they are stored, which is sorted by name),
+// except for the names of the stats and their output format (which do not affect
+// the computation)
+std::string params_signature (const ekat::ParameterList& pl) {
+  std::string s;
+  for (auto it=pl.params_names_cbegin(); it!=pl.params_names_cend(); ++it) {
+    const auto& name = *it;
+    if (name=="name" or name=="type" or name=="output_precision" or name=="significant_digits") {
+      continue;
+    }
+    bool found = append_param<bool>(s,pl,name) or
+                 append_param<int>(s,pl,name) or
+                 append_param<Real>(s,pl,name) or
+                 append_param<std::string>(s,pl,name) or
+                 append_param<std::vector<int>>(s,pl,name) or
+                 append_param<std::vector<Real>>(s,pl,name) or
+                 append_param<std::vector<std::string>>(s,pl,name);
+    if (not found) {
+      // Can't compare this param: make the signature unique
+      s += name + "=" + to_string(&pl) + ";";
+    }
+  }
+  for (auto it=pl.sublists_names_cbegin(); it!=pl.sublists_names_cend(); ++it) {
+    const auto& sub = pl.sublist(*it);
+    const std::string type = sub.isType<std::string>("type") ? sub.get<std::string>("type") : "";
+    s += *it + "={" + type + ":" + params_signature(sub) + "};";
+  }
+  return s;
+}
+
+} // anonymous namespace
+
 // ------------------ FieldStat implementation ------------------ //
 
+std::string FieldStat::
+signature (const std::string& field_name) const {
+  return type() + "(" + field_name + "){" + params_signature(m_params) + "}";
+}
+
 void FieldStat::
 set_aux_fields (const std::map<std::string,Field>& fields) {
   EKAT_REQUIRE_MSG (m_field.committed(),
@@ -47,14 +115,25 @@ create_stat_field () {
       "Error! Cannot create stat field until all aux fields are set.\n"
       " - stat name: " + name() + "\n");
   m_stat_field = Field (name(), stat_layout(m_field.layout()), DataAccess::Copy, stat_data_type());
-  m_stat_field.commit();
+  if (m_arena) {
+    m_stat_field.commit(*m_arena,arena_pool());
+  } else {
+    m_stat_field.commit();
+  }
 }
 
 // Compute the stat field
-Field FieldStat::
+const Field& FieldStat::
 compute (const TimeStamp& timestamp) {
+  compute_local(timestamp,m_own_batch);
+  m_own_batch.reduce(m_comm,name());
+  return finalize_compute();
+}
+
+void FieldStat::
+compute_local (const TimeStamp& timestamp, ReductionBatch& batch) {
   auto& ts = timing::TimingSession::instance();
-  ts.start_timer ("profiling::compute_" + name());
+  ts.start_timer (m_timer_name);
   EKAT_REQUIRE_MSG (m_stat_field.committed(),
       "Error! Field must be set in the stat before calling compute.\n"
       " - stat name : " + name() + "\n");
@@ -63,12 +142,84 @@ compute (const TimeStamp& timestamp) {
   m_timestamp = timestamp;
 
   // Call derived class impl
+  m_batch = &batch;
   compute_impl();
 
-  ts.stop_timer ("profiling::compute_" + name());
+  ts.stop_timer (m_timer_name);
+}
+
+const Field& FieldStat::
+finalize_compute () {
+  auto& ts = timing::TimingSession::instance();
+  ts.start_timer (m_timer_name);
+  EKAT_REQUIRE_MSG (m_batch!=nullptr,
+      "Error! Cannot finalize stat computation before compute_local is called.\n"
+      " - stat name : " + name() + "\n");
+
+  // Call derived class impl
+  finalize_impl();
+  m_batch = nullptr;
+
+  ts.stop_timer (m_timer_name);
   return m_stat_field;
 }
 
+void FieldStat::
+all_reduce_stat_field (const MPI_Op op) {
+  const int size = m_stat_field.layout().size();
+  switch (m_stat_field.data_type()) {
+    case DataType::RealType:
+      all_reduce(m_stat_field.data_nonconst<Real>(),size,op);
+      break;
+    case DataType::IntType:
+      all_reduce(m_stat_field.data_nonconst<int>(),size,op);
+      break;
+    default:
+      EKAT_ERROR_MSG ("Error! Unexpected/unsupported stat data type.\n"
+          " - stat name: " + name () + "\n"
+          " - stat data type: " + e2str(m_stat_field.data_type()) + "\n");
+  }
+}
+
+bool FieldStat::
+reproducible_sums () const {
+  return m_params.isParameter("reproducible") and m_params.get<bool>("reproducible");
+}
+
+std::string FieldStat::
+arena_pool () const {
+  // Stats whose kernel cannot be fused (e.g., reproducible sums) go in a pool
+  // of their own, since they may reduce buffers other than the stat field
+  std::string op = "local";
+  switch (fused_kernel()) {
+    case FusedKernel::GlobalMax:
+    case FusedKernel::MaxAlongColumns:
+      op = "max"; break;
+    case FusedKernel::GlobalMin:
+    case FusedKernel::MinAlongColumns:
+      op = "min"; break;
+    case FusedKernel::GlobalSum:
+    case FusedKernel::SumAlongColumns:
+    case FusedKernel::MaskedIntegral:
+      op = "sum"; break;
+    default:
+      break;
+  }
+  return "stats_" + op + "_" + e2str(stat_data_type());
+}
+
+void FieldStat::
+all_reduce_repro_sums () {
+  all_reduce(m_repro_sums.data(),m_repro_sums.size(),get_repro_sum_op());
+}
+
+void FieldStat::
+store_repro_sums (Real* data) const {
+  for (size_t i=0; i<m_repro_sums.size(); ++i) {
+    data[i] = m_repro_sums[i].value();
+  }
+}
+
 DataType FieldStat::
 stat_data_type() const {
   EKAT_REQUIRE_MSG (m_field.committed(),
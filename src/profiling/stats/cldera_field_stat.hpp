@@ -2,6 +2,8 @@
 #define CLDERA_FIELD_STAT_HPP
 
 #include "profiling/cldera_field.hpp"
+#include "profiling/cldera_reduction_batch.hpp"
+#include "profiling/cldera_repro_sum.hpp"
 
 #include "timing/cldera_timing_session.hpp"
 
@@ -11,6 +13,19 @@
 
 namespace cldera {
 
+// Kinds of local kernels that can be evaluated in a single traversal of the
+// input field, together with other stats on the same field (see FusedFieldStats)
+enum class FusedKernel {
+  None,
+  GlobalSum,
+  GlobalMax,
+  GlobalMin,
+  SumAlongColumns,
+  MaxAlongColumns,
+  MinAlongColumns,
+  MaskedIntegral
+};
+
 class FieldStat
 {
 public:
@@ -20,16 +35,24 @@ public:
    , m_comm (comm)
   {
     m_name = m_params.get("name",pl.name());
+    m_timer_name = "profiling::compute_" + m_name;
   }
 
   virtual ~FieldStat () = default;
 
   // The name of this field stat
-  std::string name () const { return m_name; }
+  const std::string& name () const { return m_name; }
 
   // Unlike the previous, this should be the same for all instances of the same type
   virtual std::string type () const = 0;
 
+  const ekat::ParameterList& get_params () const { return m_params; }
+
+  // A string identifying the stat computation when applied to the field with
+  // the given name: two stats with the same signature compute the same thing.
+  // It is built from type, field name, and parameters (except the stat name).
+  std::string signature (const std::string& field_name) const;
+
   // Given a field, return the layout that the computed stat will have
   virtual FieldLayout stat_layout (const FieldLayout& field_layout) const = 0;
 
@@ -43,8 +66,16 @@ public:
 
   void set_field (const Field& f);
 
-  // Compute the stat field
-  Field compute (const TimeStamp& timestamp);
+  // Compute the stat field. The returned field is the stat field itself,
+  // which is overwritten at the next computation
+  const Field& compute (const TimeStamp& timestamp);
+
+  // Split version of compute, which allows to batch MPI reductions of several stats.
+  // compute_local does all the local work, and adds the needed global reductions
+  // to the batch. Once the batch has been reduced, finalize_compute completes
+  // the stat (e.g., divides by the integration area), and returns the stat field.
+  void compute_local (const TimeStamp& timestamp, ReductionBatch& batch);
+  const Field& finalize_compute ();
 
   // NOTE: For most stats, the stat data type matches the field one, but it might not be.
   //       E.g., a stat that stores max location would have stat data type IntType,
@@ -58,7 +89,22 @@ public:
   // Virtual, in case derived classes need to add more stuff
   virtual void create_stat_field ();
 
+  // If set, the stat field is allocated from the arena, in a pool shared with
+  // the stats that have the same reduction op and data type (see arena_pool).
+  // Must be called before the field is set, since some stats (e.g., pipes)
+  // create internal stat fields at that time. Virtual, so that stats holding
+  // other stats can forward it.
+  virtual void set_arena (FieldArena* arena) { m_arena = arena; }
+
+  // Stats whose local work is one of the kernels supported by FusedFieldStats
+  // can override this, so that their local part can be computed together
+  // with other stats on the same field
+  virtual FusedKernel fused_kernel () const { return FusedKernel::None; }
+
 protected:
+  friend class FusedFieldStats;
+
+
   // Some stats REQUIRE all aux fields to be present, while others can compute
   // an aux field if missing. Hence, we cannot check that all names in
   // get_aux_fields_names() are present in the map passed to set_aux_fields(),
@@ -74,10 +120,43 @@ protected:
   virtual void set_aux_fields_impl () {}
   virtual void compute_impl () = 0;
 
+  // Derived classes that need to do some work *after* the global reductions
+  // requested during compute_impl have been completed can override this method
+  virtual void finalize_impl () {}
+
+  // Register the global reductions needed to complete the stat, once its
+  // local value is stored in m_stat_field. Stats supporting fused computation
+  // must register their reductions here, since their compute_impl is skipped.
+  virtual void register_reductions () {}
+
+  // Request a global reduction of the whole stat field
+  void all_reduce_stat_field (const MPI_Op op);
+
+  // Request a global in-place reduction of data. The reduction is not carried
+  // out right away, so data must not be used until finalize_impl is called.
+  template<typename T>
+  void all_reduce (T* data, const int count, const MPI_Op op) {
+    m_batch->add(data,count,op);
+  }
+
+  // Stats computing sums of Real values can support reproducible sums, which
+  // do not depend on the number of ranks (see ReproSum), via the 'reproducible'
+  // parameter. Such stats store their local sums in m_repro_sums (one per stat
+  // entry), register their reduction via all_reduce_repro_sums, and, once
+  // reduced, convert them back to Real with store_repro_sums.
+  bool reproducible_sums () const;
+  void all_reduce_repro_sums ();
+  void store_repro_sums (Real* data) const;
+
+  // The arena pool of the stat field: stats whose field is reduced with the
+  // same MPI op are adjacent, so their batched reductions need no packing
+  std::string arena_pool () const;
+
   ekat::ParameterList   m_params;
   ekat::Comm            m_comm;
 
   std::string           m_name;
+  std::string           m_timer_name;   // Prebuilt, so that timing compute does not allocate
   TimeStamp             m_timestamp;
 
   bool   m_aux_fields_set = false;
@@ -85,6 +164,18 @@ protected:
   Field  m_stat_field;
 
   std::map<std::string,Field> m_aux_fields;
+
+  // The batch where global reductions are added during compute_impl
+  ReductionBatch* m_batch = nullptr;
+
+  // The batch used when compute is called (rather than compute_local)
+  ReductionBatch  m_own_batch;
+
+  // Where the stat field is allocated (if not null)
+  FieldArena*     m_arena = nullptr;
+
+  // Local (and, once reduced, global) reproducible sums
+  std::vector<ReproSum> m_repro_sums;
 };
 
 template<typename... Fs>
@@ -12,6 +12,8 @@ public:
     return field_layout.strip_dim(m_axis_name);
   }
 
+  const std::string& get_axis_name () const { return m_axis_name; }
+
 protected:
   FieldStatAlongAxis (const ekat::Comm& comm,
                       const ekat::ParameterList& params,
@@ -0,0 +1,414 @@
+#ifndef CLDERA_FIELD_STAT_KERNELS_HPP
+#define CLDERA_FIELD_STAT_KERNELS_HPP
+
+#include "profiling/cldera_field.hpp"
+#include "profiling/cldera_profiling_types.hpp"
+#include "profiling/utils/cldera_subview_utils.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cldera {
+
+/*
+ * Utilities to run stat kernels in parallel on the host execution space
+ *
+ * Reductions must give the same result at every run (for a fixed number of
+ * threads), so we do not rely on the order in which Kokkos joins the thread
+ * contributions. Instead, an iteration range [0,n) is split in a fixed number
+ * of contiguous chunks; each chunk is processed serially by one thread, which
+ * stores its partial result, and the partial results are then combined in
+ * chunk order.
+ */
+
+// Compensated (Kahan) sum. For integer types, c is always 0.
+template<typename T>
+struct KahanSum {
+  T sum = 0;
+  T c   = 0;
+
+  KahanSum& operator+= (const T val) {
+    const T y = val - c;
+    const T temp = sum + y;
+    c = (temp - sum) - y;
+    sum = temp;
+    return *this;
+  }
+
+  // Merge another partial sum into this one
+  KahanSum& operator+= (const KahanSum& rhs) {
+    *this += rhs.sum;
+    *this += -rhs.c;
+    return *this;
+  }
+};
+
+// Lane-parallel compensated sum of contiguous data. The scalar Kahan update
+// has a loop-carried dependency on the running sum, which prevents the
+// compiler from vectorizing the loop. Here, W independent Kahan sums (the
+// lanes) are updated at once, with lane l accumulating the entries l, l+W,
+// l+2W,... Lanes do not depend on each other, so the update vectorizes.
+//
+// Accuracy: each lane is a Kahan sum, and lanes are merged with a Kahan sum,
+// so the error bound is the same as for the scalar Kahan sum, namely
+// |error| <= (2u + O(n*u^2))*sum|x_i| (u being the unit roundoff), which
+// does not grow with n to first order. Since entries are grouped differently,
+// the result may differ from the scalar Kahan sum in the last bits. It only
+// depends on the data and on the split in calls to add (not on alignment or
+// on the number of threads), so it is reproducible.
+// NOTE: like any compensated sum, this must not be compiled with flags that
+//       allow reassociation of floating point operations (e.g., -ffast-math).
+template<typename T, int W = 8>
+struct LaneKahanSum {
+  T sum[W] = {};
+  T c[W]   = {};
+
+  // Add x[0],...,x[n-1]
+  void add (const T* x, const int n) {
+    const int nblocks = n / W;
+    for (int b=0; b<nblocks; ++b) {
+      const T* xb = x + b*W;
+      for (int l=0; l<W; ++l) {
+        update(l,xb[l]);
+      }
+    }
+    for (int i=nblocks*W, l=0; i<n; ++i, ++l) {
+      update(l,x[i]);
+    }
+  }
+
+  // Add x[0]*w[0],...,x[n-1]*w[n-1], skipping entries where w is 0
+  // (so that, e.g., NaN's in entries with 0 weight do not pollute the sum)
+  void add (const T* x, const Real* w, const int n) {
+    const int nblocks = n / W;
+    for (int b=0; b<nblocks; ++b) {
+      const T* xb = x + b*W;
+      const Real* wb = w + b*W;
+      for (int l=0; l<W; ++l) {
+        update(l,wb[l]==0 ? T(0) : static_cast<T>(xb[l]*wb[l]));
+      }
+    }
+    for (int i=nblocks*W, l=0; i<n; ++i, ++l) {
+      update(l,w[i]==0 ? T(0) : static_cast<T>(x[i]*w[i]));
+    }
+  }
+
+  // Merge all lanes in a single compensated sum
+  KahanSum<T> reduce () const {
+    KahanSum<T> s;
+    for (int l=0; l<W; ++l) {
+      s += KahanSum<T>{sum[l],c[l]};
+    }
+    return s;
+  }
+
+private:
+  void update (const int l, const T val) {
+    const T y = val - c[l];
+    const T temp = sum[l] + y;
+    c[l] = (temp - sum[l]) - y;
+    sum[l] = temp;
+  }
+};
+
+// Compensated acc[j] += x[j], for j in [0,n). Different j's do not depend on
+// each other, so the loop vectorizes.
+template<typename T>
+void compensated_add (KahanSum<T>* acc, const T* x, const int n) {
+  for (int j=0; j<n; ++j) {
+    const T y = x[j] - acc[j].c;
+    const T temp = acc[j].sum + y;
+    acc[j].c = (temp - acc[j].sum) - y;
+    acc[j].sum = temp;
+  }
+}
+
+// Compensated acc[j] += x[j]*w, only for the j's in [0,n) where mask[j]!=0
+template<typename T>
+void compensated_add (KahanSum<T>* acc, const T* x, const int n,
+                      const Real w, const char* mask) {
+  for (int j=0; j<n; ++j) {
+    const T val = mask[j] ? static_cast<T>(x[j]*w) : T(0);
+    const T y = val - acc[j].c;
+    const T temp = acc[j].sum + y;
+    acc[j].c = (temp - acc[j].sum) - y;
+    acc[j].sum = temp;
+  }
+}
+
+// Kokkos takes kernel labels as std::string, which are allocated for long
+// labels. Labels are only used by Kokkos tools, so pass them only if a tool
+// is loaded, so that computing stats does not allocate at every step.
+inline const char* kernel_label (const char* label) {
+  return Kokkos::Tools::profileLibraryLoaded() ? label : "";
+}
+
+// Number of chunks used to split a range of n iterations
+inline int num_chunks (const int n) {
+  return std::max(1,std::min(n,HostExecSpace().concurrency()));
+}
+
+// First iteration of the ichunk-th chunk, when splitting [0,n) in nchunks
+// contiguous chunks. The chunk range is [chunk_begin(ichunk),chunk_begin(ichunk+1))
+inline int chunk_begin (const int n, const int nchunks, const int ichunk) {
+  return (static_cast<long long>(n)*ichunk) / nchunks;
+}
+
+// Split [0,n) in num_chunks(n) contiguous chunks, and call f(ichunk,beg,end)
+// for each of them in parallel.
+template<typename F>
+void parallel_chunks (const char* label, const int n, const F& f)
+{
+  const int nchunks = num_chunks(n);
+  Kokkos::parallel_for(kernel_label(label),HostRangePolicy(0,nchunks),
+                       [&](const int ichunk) {
+    f(ichunk,chunk_begin(n,nchunks,ichunk),chunk_begin(n,nchunks,ichunk+1));
+  });
+}
+
+// Raw storage for n objects of type A in scratch. The same scratch is reused
+// (and only grown) across steps, possibly for different accumulator types, so
+// it is a byte buffer: callers must construct the objects (placement new),
+// and never destroy them, hence A must be trivially destructible.
+template<typename A>
+void* scratch_storage (std::vector<char>& scratch, const int n)
+{
+  static_assert (std::is_trivially_destructible<A>::value,
+                 "Error! Scratch accumulators are never destroyed.\n");
+  static_assert (alignof(A)<=__STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                 "Error! Scratch accumulators are over-aligned.\n");
+  scratch.resize(sizeof(A)*n);
+  return scratch.data();
+}
+
+// Deterministic parallel sum over [0,n): f(beg,end,s) must add to the
+// KahanSum s the contributions of all the iterations in [beg,end).
+// The partial sums of the chunks are stored in scratch.
+template<typename T, typename F>
+T parallel_sum (const char* label, const int n, std::vector<char>& scratch, const F& f)
+{
+  const int nchunks = num_chunks(n);
+  void* storage = scratch_storage<KahanSum<T>>(scratch,nchunks);
+  parallel_chunks(label,n,[&](const int ichunk, const int beg, const int end) {
+    KahanSum<T> s;
+    f(beg,end,s);
+    ::new (static_cast<KahanSum<T>*>(storage)+ichunk) KahanSum<T>(s);
+  });
+
+  const auto partials = std::launder(static_cast<const KahanSum<T>*>(storage));
+  KahanSum<T> sum;
+  for (int ichunk=0; ichunk<nchunks; ++ichunk) {
+    sum += partials[ichunk];
+  }
+  return sum.sum;
+}
+
+// Deterministic parallel accumulation of n iterations into an array of m
+// accumulators of type A. Each chunk gets its own copy of the m accumulators
+// (stored in scratch, and initialized with init); f(beg,end,acc) must
+// accumulate in acc[0,...,m) the contributions of the iterations in [beg,end).
+// The chunk copies are then combined via join(dst,src), in chunk order.
+// Returns a pointer to the m combined accumulators (which live in scratch).
+template<typename A, typename F, typename J>
+const A* parallel_accumulate (const char* label, const int n, const int m,
+                              const A& init, std::vector<char>& scratch,
+                              const F& f, const J& join)
+{
+  const int nchunks = num_chunks(n);
+  void* storage = scratch_storage<A>(scratch,nchunks*m);
+
+  parallel_chunks(label,n,[&](const int ichunk, const int beg, const int end) {
+    A* chunk_acc = static_cast<A*>(storage) + ichunk*m;
+    std::uninitialized_fill(chunk_acc,chunk_acc+m,init);
+    f(beg,end,std::launder(chunk_acc));
+  });
+
+  A* acc = std::launder(static_cast<A*>(storage));
+  const bool tools = Kokkos::Tools::profileLibraryLoaded();
+  Kokkos::parallel_for(tools ? std::string(label) + "::join" : std::string(),HostRangePolicy(0,m),
+                       [&](const int j) {
+    for (int ichunk=1; ichunk<nchunks; ++ichunk) {
+      join(acc[j],acc[ichunk*m+j]);
+    }
+  });
+  return acc;
+}
+
+// Views of all the parts of a field, together with a global index along
+// dimension dim, obtained by stacking all the parts. If the field has more
+// than one part, dim should be the partitioned dimension.
+// Nothing is allocated: layouts and offsets of the parts are the ones stored
+// in the field, and part views are unmanaged views of the field data, built
+// when needed, so this can be created at every step (outside of parallel regions).
+// NOTE: views may be padded along the partitioned dimension, so loops
+//       should use the part layouts extents, not the views extents.
+template<typename T, int N>
+struct FieldParts {
+  using view_t = view_Nd_host<const T,N,Kokkos::MemoryUnmanaged>;
+
+  FieldParts (const Field& f, const int dim_)
+   : dim (dim_)
+   , nparts (f.nparts())
+   , data (f.m_data.data())
+   , layouts (f.m_part_layouts.data())
+   , field_offsets (f.m_part_offsets.data())
+  {
+    EKAT_REQUIRE_MSG (f.committed(),
+        "Error! Cannot access the parts of a field that is not committed.\n"
+        " - field name: " + f.name() + "\n");
+    EKAT_REQUIRE_MSG (f.layout().rank()==N and f.data_type()==get_data_type<T>(),
+        "Error! Wrong rank or data type for the parts of this field.\n"
+        " - field name: " + f.name() + "\n");
+    EKAT_REQUIRE_MSG (nparts==1 or dim==f.part_dim(),
+        "Error! Parts of a partitioned field can only be stacked along the partitioned dimension.\n"
+        " - field name: " + f.name() + "\n"
+        " - part dim  : " + std::to_string(f.part_dim()) + "\n"
+        " - input dim : " + std::to_string(dim) + "\n");
+    single_part_offsets[1] = layouts[0].dims()[dim];
+
+    // Runs of contiguous entries (see for_each_run) require that all
+    // dims other than dim are not padded
+    const auto& dims = f.layout().dims();
+    for (int d=0; d<N; ++d) {
+      if (d<dim) {
+        outer *= dims[d];
+      } else if (d>dim) {
+        inner *= dims[d];
+      }
+      for (int p=0; p<nparts; ++p) {
+        contiguous_runs &= d==dim or static_cast<int>(layouts[p].kokkos_layout().dimension[d])==dims[d];
+      }
+    }
+  }
+
+  // The (unmanaged) view of part p
+  view_t view (const int p) const {
+    return view_t(reinterpret_cast<const T*>(data[p].data()),layouts[p].kokkos_layout());
+  }
+
+  // Offsets of the parts along dim, followed by the total extent
+  const int* offsets () const {
+    return nparts==1 ? single_part_offsets : field_offsets;
+  }
+
+  // Total extent of dimension dim across all parts
+  int size () const { return offsets()[nparts]; }
+
+  // Call f(p,i,idx) for all global indices idx in [beg,end),
+  // where i is the index of idx within part p
+  template<typename F>
+  void for_each (const int beg, const int end, const F& f) const {
+    const int* offs = offsets();
+    int p = std::upper_bound(offs,offs+nparts+1,beg) - offs - 1;
+    for (int idx=beg; idx<end; ++idx) {
+      while (idx>=offs[p+1]) {
+        ++p;
+      }
+      f(p,idx-offs[p],idx);
+    }
+  }
+
+  // Call f(k,val) for all the entries val of the slice of part p at index i
+  // along dimension dim, where k is the flattened index of the entry within
+  // the slice (in LayoutRight order).
+  // NOTE: we index the part view directly, rather than building a (strided)
+  //       subview for each index i.
+  template<typename F>
+  void for_each_in_slice (const int p, const int i, const F& f) const {
+    const auto v = view(p);
+    if constexpr (N==1) {
+      f(0,v(i));
+    } else {
+      const auto& dims = layouts[p].dims();
+      if constexpr (N==2) {
+        const int n0 = dims[dim==0 ? 1 : 0];
+        if (dim==0) {
+          for (int j=0; j<n0; ++j) {
+            f(j,v(i,j));
+          }
+        } else {
+          for (int j=0; j<n0; ++j) {
+            f(j,v(j,i));
+          }
+        }
+      } else {
+        const int n0 = dims[dim==0 ? 1 : 0];
+        const int n1 = dims[dim==2 ? 1 : 2];
+        switch (dim) {
+          case 0:
+            for (int j=0; j<n0; ++j) {
+              for (int k=0; k<n1; ++k) {
+                f(j*n1+k,v(i,j,k));
+            }}
+            break;
+          case 1:
+            for (int j=0; j<n0; ++j) {
+              for (int k=0; k<n1; ++k) {
+                f(j*n1+k,v(j,i,k));
+            }}
+            break;
+          default:
+            for (int j=0; j<n0; ++j) {
+              for (int k=0; k<n1; ++k) {
+                f(j*n1+k,v(j,k,i));
+            }}
+        }
+      }
+    }
+  }
+
+  // Call f(idx,k,val) for all the entries val of the field whose index idx
+  // along dimension dim is in the global range [beg,end), where k is the
+  // flattened index of the entry within the slice at idx.
+  template<typename F>
+  void for_each_entry (const int beg, const int end, const F& f) const {
+    for_each(beg,end,[&](const int p, const int i, const int idx) {
+      for_each_in_slice(p,i,[&](const int k, const T val) {
+        f(idx,k,val);
+      });
+    });
+  }
+
+  // Call f(o,idx,x,n) for all the runs of contiguous entries whose index
+  // along dim is in the global range [beg,end). For each part overlapping
+  // [beg,end), and for each index o over the (flattened) dims before dim,
+  // x points to the n*inner entries at indices (o,idx,0),...,(o,idx+n-1,inner-1)
+  // NOTE: this requires contiguous_runs to be true
+  template<typename F>
+  void for_each_run (const int beg, const int end, const F& f) const {
+    const int* offs = offsets();
+    int p = std::upper_bound(offs,offs+nparts+1,beg) - offs - 1;
+    for (int idx=beg; idx<end; ) {
+      while (idx>=offs[p+1]) {
+        ++p;
+      }
+      const int n = std::min(end,offs[p+1]) - idx;
+      const long long stride = static_cast<long long>(layouts[p].kokkos_layout().dimension[dim])*inner;
+      const T* x = reinterpret_cast<const T*>(data[p].data()) + static_cast<long long>(idx-offs[p])*inner;
+      for (int o=0; o<outer; ++o) {
+        f(o,idx,x+o*stride,n);
+      }
+      idx += n;
+    }
+  }
+
+  int                               dim;
+  int                               nparts;
+  int                               outer = 1;
+  int                               inner = 1;
+  bool                              contiguous_runs = true;
+  const view_1d_host<const char>*   data;
+  const FieldLayout*                layouts;
+
+private:
+  const int*                        field_offsets;
+  int                               single_part_offsets[2] = {0,0};
+};
+
+} // namespace cldera
+
+#endif // CLDERA_FIELD_STAT_KERNELS_HPP
@@ -37,12 +37,28 @@ public:
     return m_outer->stat_layout(m_inner->stat_layout(fl));
   }
 
+  void set_arena (FieldArena* arena) {
+    FieldStat::set_arena(arena);
+    m_inner->set_arena(arena);
+    m_outer->set_arena(arena);
+  }
+
   void create_stat_field () {
     m_outer->create_stat_field();
     m_stat_field = m_outer->get_stat_field();
     m_stat_field.rename(m_name);
   }
 
+  // The inner stat can be replaced (e.g., with one shared with other stats),
+  // but only before the field is set
+  const std::shared_ptr<FieldStat>& get_inner () const { return m_inner; }
+  void set_inner (const std::shared_ptr<FieldStat>& inner) {
+    EKAT_REQUIRE_MSG (not m_field.committed(),
+        "Error! Cannot replace the inner stat of a pipe after the field is set.\n"
+        " - stat name: " + name() + "\n");
+    m_inner = inner;
+  }
+
   std::vector<std::string> get_aux_fields_names () const {
     std::vector<std::string> aux_fnames;
     for (const auto& it : m_outer->get_aux_fields_names()) {
@@ -95,8 +111,14 @@ protected:
   }
 
   void compute_impl () {
+    // The inner stat must be complete before the outer stat can start,
+    // but the outer stat reductions can be batched with other stats
     m_inner->compute(m_timestamp);
-    m_outer->compute(m_timestamp);
+    m_outer->compute_local(m_timestamp,*m_batch);
+  }
+
+  void finalize_impl () {
+    m_outer->finalize_compute();
   }
 
   std::shared_ptr<FieldStat> m_inner;
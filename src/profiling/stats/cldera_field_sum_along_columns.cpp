@@ -1,9 +1,10 @@
 #include "cldera_field_sum_along_columns.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
-#include "profiling/utils/cldera_subview_utils.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
 
 #include <ekat/mpi/ekat_comm.hpp>
 
+#include <type_traits>
+
 namespace cldera {
 
 FieldSumAlongColumns::
@@ -14,12 +15,6 @@ FieldSumAlongColumns (const ekat::Comm& comm,
   // Nothing to do here
 }
 
-void FieldSumAlongColumns::
-create_stat_field () {
-  FieldStat::create_stat_field();
-  m_scratch.resize (size_of(m_field.data_type()) * m_stat_field.layout().size());
-}
-
 void FieldSumAlongColumns::
 compute_impl () {
   const auto dt   = m_field.data_type();
@@ -47,53 +42,64 @@ compute_impl () {
 template<typename T, int N>
 void FieldSumAlongColumns::
 do_compute_impl () {
-  T* raw_scratch = reinterpret_cast<T*>(m_scratch.data());
-  view_Nd_host<T,N-1> c (raw_scratch,m_stat_field.layout().kokkos_layout());
   auto stat_view = m_stat_field.nd_view_nonconst<T,N-1>();
-  Kokkos::deep_copy(stat_view, 0);
-  Kokkos::deep_copy(c, 0);
 
-  T y, temp;
-  auto update_sum = [&] (const T val, T& c, T& sum) {
-    y = val - c;
-    temp = sum + y;
-    c = (temp - sum) - y;
-    sum = temp;
-  };
+  // Each thread sums a contiguous range of columns, for all the stat entries.
+  // The partial sums are then combined in a fixed order.
+  // NOTE: stat_view is created without padding, so the flattened index
+  //       of an entry in a column slice is the same as in stat_view,
+  //       that is, o*inner+j, with o (j) the index over the dims before
+  //       (after) the column dim.
+  const int col_dim = m_field.layout().idim(m_axis_name);
+  const int stat_size = stat_view.size();
+  FieldParts<T,N> parts (m_field,col_dim);
+  if constexpr (std::is_same<T,Real>::value) {
+    if (use_repro_sums()) {
+      // Partial sums can be merged in any order, since the result does not depend on it
+      const auto* sums = parallel_accumulate("FieldSumAlongColumns",parts.size(),stat_size,
+                                             ReproSum(),m_scratch,
+                                             [&](const int beg, const int end, ReproSum* acc) {
+        parts.for_each_entry(beg,end,[&](const int, const int k, const T val) {
+          acc[k] += val;
+        });
+      },[](ReproSum& dst, const ReproSum& src) { dst += src; });
+      m_repro_sums.assign(sums,sums+stat_size);
+      register_reductions();
+      return;
+    }
+  }
 
-  // NOTE: stat_view extents are ok, since the stat is created without
-  //       padding. OTOH, the input field may be a subview of some other
-  //       array, so it may contain padding. Hence, you can use stat_view's
-  //       extents in your loop boundaries.
-  int col_dim = m_field.layout().idim(m_axis_name);
-  for (int p=0; p<m_field.nparts(); ++p) {
-    const auto& pl = m_field.part_layout(p);
-    const auto& fview = m_field.part_nd_view<const T,N>(p);
-    const int ncols = pl.extent(m_axis_name);
-    if constexpr (N==1) {
-      for (int icol=0; icol<ncols; ++icol) {
-        update_sum(fview(icol),c(),stat_view());
-      }
-    } else if constexpr (N==2) {
-      for (int icol=0; icol<ncols; ++icol) {
-        auto f_slice = slice(fview,col_dim,icol);
-        for (size_t j=0; j<stat_view.extent(0); ++j) {
-          update_sum(f_slice(j),c(j),stat_view(j));
+  const int inner = parts.inner;
+  const auto* col_sum = parallel_accumulate("FieldSumAlongColumns",parts.size(),stat_size,
+                                            KahanSum<T>(),m_scratch,
+                                            [&](const int beg, const int end, KahanSum<T>* acc) {
+    if (not parts.contiguous_runs) {
+      parts.for_each_entry(beg,end,[&](const int, const int k, const T val) {
+        acc[k] += val;
+      });
+      return;
+    }
+    // Either columns are contiguous (vectorized sum along the run), or
+    // column slices are (vectorized update of the slice accumulators)
+    parts.for_each_run(beg,end,[&](const int o, const int, const T* x, const int n) {
+      KahanSum<T>* o_acc = acc + o*inner;
+      if (inner==1) {
+        LaneKahanSum<T> lanes;
+        lanes.add(x,n);
+        o_acc[0] += lanes.reduce();
+      } else {
+        for (int i=0; i<n; ++i) {
+          compensated_add(o_acc,x+i*inner,inner);
         }
       }
-    } else {
-      for (int icol=0; icol<ncols; ++icol) {
-        auto f_slice = slice(fview,col_dim,icol);
-        for (size_t j=0; j<stat_view.extent(0); ++j) {
-          for (size_t k=0; k<stat_view.extent(1); ++k) {
-            update_sum(f_slice(j,k),c(j,k),stat_view(j,k));
-        }}
-      }
-    }
+    });
+  },[](KahanSum<T>& dst, const KahanSum<T>& src) { dst += src; });
+  for (int k=0; k<stat_size; ++k) {
+    stat_view.data()[k] = col_sum[k].sum;
   }
 
-  // Clock MPI ops
-  track_mpi_all_reduce(m_comm,stat_view.data(),stat_view.size(),MPI_MAX,name());
+  // Global reduction is deferred, so that it can be batched with other stats
+  register_reductions();
 }
 
 } // namespace cldera
@@ -2,7 +2,6 @@
 #define CLDERA_FIELD_SUM_ALONG_COLUMNS_HPP_
 
 #include "profiling/stats/cldera_field_stat_along_axis.hpp"
-#include "profiling/cldera_mpi_timing_wrappers.hpp"
 
 #include <ekat/mpi/ekat_comm.hpp>
 
@@ -16,10 +15,32 @@ public:
 
   std::string type () const override { return "sum_along_columns"; }
 
-  void create_stat_field () override;
+  FusedKernel fused_kernel () const override {
+    return use_repro_sums() ? FusedKernel::None : FusedKernel::SumAlongColumns;
+  }
+
 protected:
   void compute_impl () override;
 
+  void register_reductions () override {
+    if (use_repro_sums()) {
+      all_reduce_repro_sums();
+    } else {
+      all_reduce_stat_field(MPI_SUM);
+    }
+  }
+
+  void finalize_impl () override {
+    if (use_repro_sums()) {
+      store_repro_sums(m_stat_field.data_nonconst<Real>());
+    }
+  }
+
+  // Sums of ints are exact, hence already reproducible
+  bool use_repro_sums () const {
+    return reproducible_sums() and m_field.data_type()==DataType::RealType;
+  }
+
   template<typename T, int N>
   void do_compute_impl ();
 
@@ -2,6 +2,7 @@
 #define CLDERA_FIELD_VERTICAL_CONTRACTION_HPP
 
 #include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
 
 #include <ekat/util/ekat_string_utils.hpp>
 #include <ekat/ekat_assert.hpp>
@@ -128,6 +129,14 @@ protected:
         " - input field nparts: " + std::to_string(m_field.nparts()) + "\n"
         " - weight field nparts: " + std::to_string(m_weight_field.nparts()) + "\n");
 
+      // The weight field data does not change, so get the views of its parts once
+      m_w2d.clear();
+      if (m_weight2d) {
+        for (int p=0; p<m_weight_field.nparts(); ++p) {
+          m_w2d.push_back(m_weight_field.part_nd_view<Real,2>(p));
+        }
+      }
+
       if (m_weight2d and fl.rank()==3) {
         // We need to figure out which one is the weight non-lev dimension within
         // the list of dimensions of the input field
@@ -188,7 +197,7 @@ protected:
     auto wint = m_weight_integral.view<Real>();
 
     view_1d_host<const Real> w1d;
-    view_Nd_host<const Real,2> w2d;
+    const auto& w2d = m_w2d;
     if (not m_weight2d) {
       w1d = m_weight_field.view<Real>();
     }
@@ -208,88 +217,82 @@ protected:
       }
       case 2:
       {
+        // Columns are independent, so threads can process them in any order
         auto sview = m_stat_field.nd_view_nonconst<Real,1>();
-        auto offset = 0;
-        for (int p=0; p<m_field.nparts(); ++p) {
-          auto fpl = m_field.part_layout(p);
-          auto spl = stat_layout(fpl);
-          auto fview = m_field.part_nd_view<T,2>(p);
-          if (m_weight2d) {
-            w2d = m_weight_field.part_nd_view<Real,2>(p);
-          }
-          for (int i=0; i<spl.dims()[0]; ++i) {
+        FieldParts<T,2> parts (m_field,1-m_vert_dim_pos);
+        parallel_chunks("FieldVerticalContraction",parts.size(),
+                        [&](const int, const int beg, const int end) {
+          parts.for_each(beg,end,[&](const int p, const int i, const int idx) {
+            const auto fview = parts.view(p);
+            Real s = 0;
             for (int lev=m_lev_idx_bounds.min; lev<=m_lev_idx_bounds.max; ++lev) {
               if (m_vert_dim_pos==0) {
-                auto w = m_weight2d ? w2d(lev,i) : w1d(lev);
-                sview(offset+i) += fview(lev,i)*w;
+                auto w = m_weight2d ? w2d[p](lev,i) : w1d(lev);
+                s += fview(lev,i)*w;
               } else {
-                auto w = m_weight2d ? w2d(i,lev) : w1d(lev);
-                sview(offset+i) += fview(i,lev)*w;
+                auto w = m_weight2d ? w2d[p](i,lev) : w1d(lev);
+                s += fview(i,lev)*w;
               }
             }
             // If m_average=false, wint=1
             if (m_average) {
-              sview(offset+i) /= m_weight2d ? wint[offset+i] : wint[0];
+              s /= m_weight2d ? wint[idx] : wint[0];
             }
-          }
-          offset += spl.dims()[0];
-        }
+            sview(idx) = s;
+          });
+        });
         break;
       }
       case 3:
       {
+        // Threads process contiguous ranges of indices along the partitioned dim
+        // (which cannot be the vertical dim, unless there is only one part).
+        // The stat indices (gi,gj) correspond to the two non-lev dims of f.
         auto sview = m_stat_field.nd_view_nonconst<Real,2>();
-        auto part_dim = m_field.part_dim();
-        auto part_dim_name = m_field.layout().names()[part_dim];
-        int offset_i = 0;
-        int offset_j = 0;
-        int i,j;
-
-        // We need to figure out which non-lev dim of f (i or j) correspond
-        // to the non-level dim of the weight2d (if weight is 2d).
-        // E.g., with w(nlev,ncol), f1(nlev,ndim,ncol) vs f2(ncol,ndim,nlev)
-        int& offset_wint = m_w_first_non_lev_dim_same_as_f ? offset_i : offset_j;
-        int& wint_non_lev_i = m_w_first_non_lev_dim_same_as_f ? i : j;
-
-        for (int p=0; p<m_field.nparts(); ++p) {
-          auto fpl = m_field.part_layout(p);
-          auto spl = stat_layout(fpl);
-          auto fview = m_field.part_nd_view<T,3>(p);
-          if (m_weight2d) {
-            w2d = m_weight_field.part_nd_view<Real,2>(p);
-          }
-          for (i=0; i<spl.dims()[0]; ++i) {
-            for (j=0; j<spl.dims()[1]; ++j) {
+        const int first_non_lev_dim = m_vert_dim_pos==0 ? 1 : 0;
+        const int part_dim = m_field.part_dim();
+        const int outer_dim = part_dim!=m_vert_dim_pos ? part_dim : first_non_lev_dim;
+        const bool outer_is_i = outer_dim==first_non_lev_dim;
+        const int ninner = sview.extent_int(outer_is_i ? 1 : 0);
+
+        FieldParts<T,3> parts (m_field,outer_dim);
+        parallel_chunks("FieldVerticalContraction",parts.size(),
+                        [&](const int, const int beg, const int end) {
+          parts.for_each(beg,end,[&](const int p, const int io, const int idx) {
+            const auto fview = parts.view(p);
+            for (int jo=0; jo<ninner; ++jo) {
+              // Local (i,j) and global (gi,gj) non-lev indices
+              const int i  = outer_is_i ? io  : jo;
+              const int j  = outer_is_i ? jo  : io;
+              const int gi = outer_is_i ? idx : jo;
+              const int gj = outer_is_i ? jo  : idx;
+
+              // If w is 2d, its non-lev dim corresponds to either i or j
+              // E.g., with w(nlev,ncol), f1(nlev,ndim,ncol) vs f2(ncol,ndim,nlev)
+              Real s = 0;
               for (int lev=m_lev_idx_bounds.min; lev<=m_lev_idx_bounds.max; ++lev) {
                 if (m_vert_dim_pos==0) {
-                  auto w = m_weight2d ? 
-                    (m_w_first_non_lev_dim_same_as_f ? w2d(lev,i) : w2d(lev,j)) : w1d(lev);
-                  sview(i+offset_i,j+offset_j) += fview(lev,i,j)*w;
+                  auto w = m_weight2d ?
+                    (m_w_first_non_lev_dim_same_as_f ? w2d[p](lev,i) : w2d[p](lev,j)) : w1d(lev);
+                  s += fview(lev,i,j)*w;
                 } else if (m_vert_dim_pos==1) {
-                  auto w = m_weight2d ? 
-                    (m_w_first_non_lev_dim_same_as_f ? w2d(i,lev) : w2d(lev,j)) : w1d(lev);
-                  sview(i+offset_i,j+offset_j) += fview(i,lev,j)*w;
+                  auto w = m_weight2d ?
+                    (m_w_first_non_lev_dim_same_as_f ? w2d[p](i,lev) : w2d[p](lev,j)) : w1d(lev);
+                  s += fview(i,lev,j)*w;
                 } else {
-                  auto w = m_weight2d ? 
-                    (m_w_first_non_lev_dim_same_as_f ? w2d(i,lev) : w2d(j,lev)) : w1d(lev);
-                  sview(i+offset_i,j+offset_j) += fview(i,j,lev)*w;
+                  auto w = m_weight2d ?
+                    (m_w_first_non_lev_dim_same_as_f ? w2d[p](i,lev) : w2d[p](j,lev)) : w1d(lev);
+                  s += fview(i,j,lev)*w;
                 }
               }
 
               if (m_average) {
-                sview(i+offset_i,j+offset_j) /=
-                  m_weight2d ? wint[offset_wint+wint_non_lev_i] : wint[0];
+                s /= m_weight2d ? wint[m_w_first_non_lev_dim_same_as_f ? gi : gj] : wint[0];
               }
+              sview(gi,gj) = s;
             }
-          }
-
-          // Update offset into i/j dim of stat, based on which of the two is partitioned
-          if (m_stat_field.layout().dim_idx(part_dim_name)==0) {
-            offset_i += spl.dims()[0];
-          } else {
-            offset_j += spl.dims()[1];
-          }
-        }
+          });
+        });
         break;
       }
       default:
@@ -310,6 +313,7 @@ protected:
   bool            m_average;                // Whether we normalize by integral of w
   bool            m_constant_weight = true; // If true, pre-compute the weight integral
   bool            m_weight2d = false;       // For 2d/3d fields, whether w is 1d or 2d
+  std::vector<view_Nd_host<const Real,2>> m_w2d;  // Views of the parts of w, if 2d
 
   // Only used if rank(f)=3, rank(w)=2. If true, then the non-lev dim in w corresponds
   // to the first non-lev dim in m_field, otherwise it corresponds to the second
@@ -1,8 +1,9 @@
 #include "profiling/stats/cldera_field_zonal_mean.hpp"
-#include "profiling/utils/cldera_subview_utils.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
 
 #include <algorithm>
 #include <limits>
+#include <type_traits>
 
 namespace cldera {
 
@@ -42,7 +43,53 @@ set_aux_fields_impl ()
       "  - lat layout : " + m_lat.layout().to_string() + "\n"
       "  - area layout: " + m_area.layout().to_string() + "\n");
 
+  // Weight of each column (0 outside the lat bounds), and whether each (flattened)
+  // stat entry is within the level bounds. They only depend on the static lat/area
+  // fields and on the bounds, so the compute kernels do not need to check bounds
+  FieldParts<Real,1> lat (m_lat,0);
+  FieldParts<Real,1> area (m_area,0);
+  m_col_weights.resize(lat.size());
+  lat.for_each(0,lat.size(),[&](const int p, const int icol, const int idx) {
+    m_col_weights[idx] = m_lat_bounds.contains(lat.view(p)(icol),true,true)
+                       ? area.view(p)(icol) : 0;
+  });
+
+  const auto sl = stat_layout(m_field.layout());
+  const int lev_dim = sl.has_dim("lev") ? sl.idim("lev") : -1;
+  int lev_stride = 1;
+  for (int d=lev_dim+1; lev_dim>=0 and d<sl.rank(); ++d) {
+    lev_stride *= sl.extent(d);
+  }
+  m_lev_mask.resize(sl.size());
+  for (int k=0; k<sl.size(); ++k) {
+    m_lev_mask[k] = lev_dim<0 or m_lev_bounds.contains((k/lev_stride) % sl.extent(lev_dim),true,true);
+  }
+
   // Compute zonal area (the scaling factor of the zonal integral)
+  if (use_repro_sums()) {
+    ReproSum zonal_area;
+    for (int ipart = 0; ipart < m_field.nparts(); ++ipart) {
+      const auto& part_layout = m_area.part_layout(ipart);
+      const auto& lat_part_data = m_lat.part_data<const Real>(ipart);
+      const auto& area_part_data = m_area.part_data<const Real>(ipart);
+      for (int part_index = 0; part_index < part_layout.size(); ++part_index) {
+        const Real lat_val = lat_part_data[part_index];
+        if (lat_val > m_lat_bounds.min && lat_val < m_lat_bounds.max) {
+          zonal_area += area_part_data[part_index];
+        }
+      }
+    }
+    ReductionBatch batch;
+    batch.add(&zonal_area,1,get_repro_sum_op());
+    batch.reduce(m_comm,name()+"_initialize");
+    m_zonal_area = zonal_area.value();
+    EKAT_REQUIRE_MSG (m_zonal_area > 0,
+        "Error! Zonal area should be positive.\n"
+        " - stat name : " << name() << "\n"
+        " - zonal area: " << m_zonal_area << "\n");
+    return;
+  }
+
   m_zonal_area = 0.0;
   Real c = 0;
   Real temp, y;
@@ -67,12 +114,6 @@ set_aux_fields_impl ()
       " - zonal area: " << m_zonal_area << "\n");
 }
 
-void FieldZonalMean::create_stat_field ()
-{
-  FieldStat::create_stat_field();
-  m_temp_memory.resize(size_of(m_field.data_type())*m_stat_field.layout().size());
-}
-
 void FieldZonalMean::
 compute_impl ()
 {
@@ -114,78 +155,111 @@ do_compute_impl ()
 {
   // Get n-dimensional stat field
   auto stat_view = m_stat_field.nd_view_nonconst<T,N-1>();
-  Kokkos::deep_copy(stat_view, 0);
-
-  const auto& stat_dims = m_stat_field.layout().dims();
+  const int stat_size = m_stat_field.layout().size();
 
   const int col_dim = m_field.layout().idim("ncol");
 
-  auto temp_c = view_Nd_host<T,N-1>(reinterpret_cast<T*>(m_temp_memory.data()), m_stat_field.layout().kokkos_layout());
-  Kokkos::deep_copy(temp_c, 0);
-
-  // Find, if present, the index of level dimension (in the layout stripped of ncol)
-  const bool has_lev = m_stat_field.layout().has_dim("lev");
-  const int lev_dim = has_lev ? m_stat_field.layout().idim("lev") : -1;
-
-  // Small lambda to perform the Golub-Kahan summation
-  T temp, y;
-  auto update_stat = [&](const T& fval, T& sval, T& cval, const Real& area) {
-    y = fval*area - cval;
-    temp = sval + y;
-    cval = (temp-sval) - y;
-    sval = temp;
-  };
-  for (int ipart = 0; ipart < m_field.nparts(); ++ipart) {
-    const auto  field_part_data = m_field.part_data<const T>(ipart);
-    const auto  area_view = m_area.part_view<const Real>(ipart);
-    const auto  lat_view = m_lat.part_view<const Real>(ipart);
-
-    const auto& fpl = m_field.part_layout(ipart);
-    const int ncols = fpl.extent("ncol");
+  // Each thread integrates over a contiguous range of columns, for all the
+  // stat entries, using the Golub-Kahan summation. The partial integrals
+  // are then combined in a fixed order.
+  FieldParts<T,N> parts (m_field,col_dim);
+  const int ncols = parts.size();
+  const Real* col_w = m_col_weights.data();
+  const char* lev_mask = m_lev_mask.data();
+  const int inner = parts.inner;
 
-    auto fview = m_field.part_nd_view<const T,N>(ipart);
+  if constexpr (std::is_same<T,Real>::value) {
+    if (use_repro_sums()) {
+      // Partial sums can be merged in any order, since the result does not depend on it
+      const auto* sums = parallel_accumulate("FieldZonalMean",ncols,stat_size,
+                                             ReproSum(),m_temp_memory,
+                                             [&](const int beg, const int end, ReproSum* acc) {
+        parts.for_each(beg,end,[&](const int p, const int icol, const int idx) {
+          const Real a = col_w[idx];
+          if (a==0) {
+            return;
+          }
+          parts.for_each_in_slice(p,icol,[&](const int k, const T val) {
+            if (lev_mask[k]) {
+              acc[k] += val*a;
+            }
+          });
+        });
+      },[](ReproSum& dst, const ReproSum& src) { dst += src; });
+      m_repro_sums.assign(sums,sums+stat_size);
+      all_reduce_repro_sums();
+      return;
+    }
+  }
 
-    for (int icol=0; icol<ncols; ++icol) {
-      const auto lat = lat_view(icol);
-      if (not m_lat_bounds.contains(lat,true,true)) {
-        continue;
-      }
-      const auto area = area_view (icol);
-
-      // This are compile-time if statements, so they are compiled away
-      if constexpr (N==1) {
-        auto f_at_col = slice(fview,col_dim,icol);
-        update_stat(f_at_col(),stat_view(),temp_c(),area);
-      } else if constexpr (N==2) {
-        auto f_at_col = slice(fview,col_dim,icol);
-        for (int idim=0; idim<stat_dims[0]; ++idim) {
-          if (lev_dim==0 and not m_lev_bounds.contains(idim,true,true)) {
-            continue;
+  const auto* zonal_sum = parallel_accumulate("FieldZonalMean",ncols,stat_size,
+                                              KahanSum<T>(),m_temp_memory,
+                                              [&](const int beg, const int end, KahanSum<T>* acc) {
+    if (not parts.contiguous_runs) {
+      parts.for_each(beg,end,[&](const int p, const int icol, const int idx) {
+        const Real a = col_w[idx];
+        if (a==0) {
+          return;
+        }
+        parts.for_each_in_slice(p,icol,[&](const int k, const T val) {
+          if (lev_mask[k]) {
+            acc[k] += val*a;
           }
-          update_stat(f_at_col(idim),stat_view(idim),temp_c(idim),area);
+        });
+      });
+      return;
+    }
+    // Either columns are contiguous (vectorized weighted sum along the run),
+    // or column slices are (vectorized update of the slice accumulators)
+    parts.for_each_run(beg,end,[&](const int o, const int idx, const T* x, const int n) {
+      KahanSum<T>* o_acc = acc + o*inner;
+      if (inner==1) {
+        if (lev_mask[o]) {
+          LaneKahanSum<T> lanes;
+          lanes.add(x,col_w+idx,n);
+          o_acc[0] += lanes.reduce();
         }
       } else {
-        auto f_at_col = slice(fview,col_dim,icol);
-
-        for (int idim=0; idim<stat_dims[0]; ++idim) {
-          if (lev_dim==0 and not m_lev_bounds.contains(idim,true,true)) {
-            continue;
-          }
-          for (int jdim=0; jdim<stat_dims[1]; ++jdim) {
-            if (lev_dim==1 and not m_lev_bounds.contains(jdim,true,true)) {
-              continue;
-            }
-            update_stat(f_at_col(idim,jdim),stat_view(idim,jdim),temp_c(idim,jdim),area);
+        for (int i=0; i<n; ++i) {
+          if (col_w[idx+i]!=0) {
+            compensated_add(o_acc,x+i*inner,inner,col_w[idx+i],lev_mask+o*inner);
           }
         }
       }
-    }
+    });
+  },[](KahanSum<T>& dst, const KahanSum<T>& src) { dst += src; });
+  for (int k=0; k<stat_size; ++k) {
+    stat_view.data()[k] = zonal_sum[k].sum;
+  }
+
+  // Global reduction is deferred, so that it can be batched with other stats
+  all_reduce(stat_view.data(),stat_size,MPI_SUM);
+}
+
+void FieldZonalMean::
+finalize_impl ()
+{
+  const auto dt = m_field.data_type();
+  if (dt==IntType) {
+    do_finalize_impl<int>();
+  } else {
+    do_finalize_impl<Real>();
   }
-  // Clock MPI ops
-  track_mpi_all_reduce(m_comm,stat_view.data(),m_stat_field.layout().size(),MPI_SUM,name());
+}
 
-  for (int i = 0; i < stat_view.size(); ++i)
-    stat_view.data()[i] /= m_zonal_area;
+template <typename T>
+void FieldZonalMean::
+do_finalize_impl ()
+{
+  auto stat_data = m_stat_field.data_nonconst<T>();
+  const int size = m_stat_field.layout().size();
+  if constexpr (std::is_same<T,Real>::value) {
+    if (use_repro_sums()) {
+      store_repro_sums(stat_data);
+    }
+  }
+  for (int i = 0; i < size; ++i)
+    stat_data[i] /= m_zonal_area;
 }
 
 } // namespace cldera
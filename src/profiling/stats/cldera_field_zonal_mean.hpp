@@ -22,8 +22,6 @@ public:
     return {"lat", "area"};
   }
 
-  void create_stat_field () override;
-
 protected:
 
   void set_aux_fields_impl () override;
@@ -33,6 +31,16 @@ protected:
   template <typename T, int N>
   void do_compute_impl ();
 
+  void finalize_impl () override;
+
+  template <typename T>
+  void do_finalize_impl ();
+
+  // Sums of ints are exact, hence already reproducible
+  bool use_repro_sums () const {
+    return reproducible_sums() and m_field.data_type()==DataType::RealType;
+  }
+
   const Bounds<Real> m_lat_bounds;
   const Bounds<int>  m_lev_bounds;
 
@@ -40,6 +48,10 @@ protected:
   Real m_zonal_area = 0.0;
 
   std::vector<char> m_temp_memory;
+
+  // Built when aux fields are set: weight of each column, and level-bounds mask of each stat entry
+  std::vector<Real> m_col_weights;
+  std::vector<char> m_lev_mask;
 };
 
 } // namespace cldera
@@ -0,0 +1,326 @@
+#include "cldera_fused_field_stats.hpp"
+#include "profiling/stats/cldera_field_stat_along_axis.hpp"
+#include "profiling/stats/cldera_field_masked_integral.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace cldera {
+
+FusedFieldStats::
+FusedFieldStats (const Field& f)
+ : m_field (f)
+ , m_timer_name ("profiling::compute_fused_" + f.name())
+{
+  EKAT_REQUIRE_MSG (f.committed(),
+      "Error! Field must be committed before creating fused stats on it.\n"
+      " - field name: " + f.name() + "\n");
+}
+
+int FusedFieldStats::
+required_dim (const FieldStat& stat) const
+{
+  const auto& layout = m_field.layout();
+  switch (stat.fused_kernel()) {
+    case FusedKernel::SumAlongColumns:
+    case FusedKernel::MaxAlongColumns:
+    case FusedKernel::MinAlongColumns:
+    {
+      const auto& axis = dynamic_cast<const FieldStatAlongAxis&>(stat).get_axis_name();
+      return layout.has_dim_name(axis) ? layout.dim_idx(axis) : -1;
+    }
+    case FusedKernel::MaskedIntegral:
+    {
+      const auto& mask_dim = dynamic_cast<const FieldMaskedIntegral&>(stat).get_mask_dim_name();
+      return layout.dim_idx(mask_dim);
+    }
+    case FusedKernel::GlobalSum:
+      // The global sum depends on the order of the entries, so traverse
+      // the field like FieldGlobalSum does, to get the same result
+      return m_field.part_dim();
+    default:
+      return -1;
+  }
+}
+
+bool FusedFieldStats::
+can_fuse (const FieldStat& stat) const
+{
+  if (stat.fused_kernel()==FusedKernel::None or
+      not stat.m_stat_field.committed() or
+      stat.m_field.name()!=m_field.name()) {
+    return false;
+  }
+
+  // Parts can only be stacked along the partitioned dim, and all stats
+  // must agree on the traversal dim
+  const int dim = required_dim(stat);
+  if (dim<0) {
+    return true;
+  }
+  if (m_field.nparts()>1 and dim!=m_field.part_dim()) {
+    return false;
+  }
+  return m_dim<0 or m_dim==dim;
+}
+
+void FusedFieldStats::
+add_stat (const std::shared_ptr<FieldStat>& stat)
+{
+  EKAT_REQUIRE_MSG (can_fuse(*stat),
+      "Error! Stat cannot be computed together with the other stats on this field.\n"
+      " - field name: " + m_field.name() + "\n"
+      " - stat name : " + stat->name() + "\n");
+
+  const int dim = required_dim(*stat);
+  if (dim>=0) {
+    m_dim = dim;
+  }
+  m_stats.push_back(stat);
+  if (stat->fused_kernel()==FusedKernel::MaskedIntegral) {
+    m_masked.push_back(std::dynamic_pointer_cast<FieldMaskedIntegral>(stat));
+  }
+}
+
+void FusedFieldStats::
+compute_local (const TimeStamp& timestamp, ReductionBatch& batch)
+{
+  auto& ts = timing::TimingSession::instance();
+  ts.start_timer (m_timer_name);
+
+  for (auto& s : m_stats) {
+    s->m_timestamp = timestamp;
+    s->m_batch = &batch;
+  }
+
+  const auto dt   = m_field.data_type();
+  const int  rank = m_field.layout().rank();
+  if (dt==DataType::RealType) {
+    switch (rank) {
+      case 1: do_compute_local<Real,1>(); break;
+      case 2: do_compute_local<Real,2>(); break;
+      case 3: do_compute_local<Real,3>(); break;
+    }
+  } else if (dt==DataType::IntType) {
+    switch (rank) {
+      case 1: do_compute_local<int,1>(); break;
+      case 2: do_compute_local<int,2>(); break;
+      case 3: do_compute_local<int,3>(); break;
+    }
+  } else {
+    EKAT_ERROR_MSG ("Error! Unexpected/unsupported field data type.\n"
+        " - field name: " + m_field.name() + "\n"
+        " - field data type: " + e2str(m_field.data_type()) + "\n");
+  }
+
+  // Global reductions are deferred, so that they can be batched with other stats
+  for (auto& s : m_stats) {
+    s->register_reductions();
+  }
+
+  ts.stop_timer (m_timer_name);
+}
+
+template<>
+std::vector<FusedFieldStats::Accumulators<Real>>&
+FusedFieldStats::accumulators<Real> () { return m_real_acc; }
+
+template<>
+std::vector<FusedFieldStats::Accumulators<int>>&
+FusedFieldStats::accumulators<int> () { return m_int_acc; }
+
+template<typename T, int N>
+void FusedFieldStats::
+do_compute_local ()
+{
+  // NOTE: with one part, stats on the whole field work with any dim
+  const int dim = m_dim>=0 ? m_dim : m_field.part_dim();
+  FieldParts<T,N> parts (m_field,dim);
+  const int n = parts.size();
+  const int nchunks = num_chunks(n);
+
+  // Number of field entries in each slice along the traversal dim
+  const auto& dims = m_field.layout().dims();
+  int slice_size = 1;
+  for (int d=0; d<N; ++d) {
+    slice_size *= d==dim ? 1 : dims[d];
+  }
+
+  bool sum = false, max = false, min = false;
+  bool col_sum = false, col_max = false, col_min = false;
+  for (const auto& s : m_stats) {
+    switch (s->fused_kernel()) {
+      case FusedKernel::GlobalSum:        sum     = true; break;
+      case FusedKernel::GlobalMax:        max     = true; break;
+      case FusedKernel::GlobalMin:        min     = true; break;
+      case FusedKernel::SumAlongColumns:  col_sum = true; break;
+      case FusedKernel::MaxAlongColumns:  col_max = true; break;
+      case FusedKernel::MinAlongColumns:  col_min = true; break;
+      default: break;
+    }
+  }
+
+  const int nmasked = m_masked.size();
+  auto& mask_entries = m_mask_entries;
+  auto& mask_weights = m_mask_weights;
+  mask_entries.resize(nmasked);
+  mask_weights.resize(nmasked);
+  for (int s=0; s<nmasked; ++s) {
+    const auto& mi = *m_masked[s];
+    mask_entries[s] = mi.m_mask_stat_entries.data();
+    if (mi.m_use_weight) {
+      mask_weights[s] = mi.m_weight_field.view<const Real>();
+    }
+  }
+
+  // Size the per-chunk accumulators (no-op after the first call)
+  auto& accs = accumulators<T>();
+  accs.resize(nchunks);
+  for (auto& a : accs) {
+    a.col_sum.resize(col_sum ? slice_size : 0);
+    a.col_max.resize(col_max ? slice_size : 0);
+    a.col_min.resize(col_min ? slice_size : 0);
+    a.masked.resize(nmasked);
+    a.masked_row.resize(nmasked);
+    a.masked_w.resize(nmasked);
+    for (int s=0; s<nmasked; ++s) {
+      a.masked[s].resize(m_masked[s]->m_mask_val_to_stat_entry.size()*slice_size);
+    }
+  }
+
+  // Each thread reads each entry in its range of indices once, and feeds it
+  // to all the accumulators. The branches are the same for all entries.
+  constexpr T lowest  = -std::numeric_limits<T>::max();
+  constexpr T highest =  std::numeric_limits<T>::max();
+  parallel_chunks("FusedFieldStats",n,[&](const int ichunk, const int beg, const int end) {
+    auto& a = accs[ichunk];
+    a.sum = KahanSum<T>();
+    a.max = lowest;
+    a.min = highest;
+    std::fill(a.col_sum.begin(),a.col_sum.end(),KahanSum<T>());
+    std::fill(a.col_max.begin(),a.col_max.end(),lowest);
+    std::fill(a.col_min.begin(),a.col_min.end(),highest);
+    for (auto& m : a.masked) {
+      std::fill(m.begin(),m.end(),0);
+    }
+
+    auto set_masked_rows = [&](const int idx) {
+      for (int s=0; s<nmasked; ++s) {
+        a.masked_row[s] = a.masked[s].data() + mask_entries[s][idx]*slice_size;
+        a.masked_w[s] = mask_weights[s].size()>0 ? mask_weights[s](idx) : 1;
+      }
+    };
+    auto add_entry = [&](const int k, const T val) {
+      if (max) { a.max = std::max(a.max,val); }
+      if (min) { a.min = std::min(a.min,val); }
+      if (col_max) { a.col_max[k] = std::max(a.col_max[k],val); }
+      if (col_min) { a.col_min[k] = std::min(a.col_min[k],val); }
+      for (int s=0; s<nmasked; ++s) {
+        a.masked_row[s][k] += val * a.masked_w[s];
+      }
+    };
+    const bool per_entry = max or min or col_max or col_min or nmasked>0;
+
+    if (not parts.contiguous_runs) {
+      parts.for_each(beg,end,[&](const int p, const int i, const int idx) {
+        set_masked_rows(idx);
+        parts.for_each_in_slice(p,i,[&](const int k, const T val) {
+          if (sum) { a.sum += val; }
+          if (col_sum) { a.col_sum[k] += val; }
+          add_entry(k,val);
+        });
+      });
+      return;
+    }
+
+    // Sums use the same vectorized compensated kernels, on the same runs,
+    // as FieldGlobalSum and FieldSumAlongColumns, so that fusing the stats
+    // does not change their result. Each entry of the other accumulators
+    // gets the contributions in the same order as in the loop above.
+    const int inner = parts.inner;
+    LaneKahanSum<T> lanes;
+    parts.for_each_run(beg,end,[&](const int o, const int idx, const T* x, const int nrun) {
+      if (sum) {
+        lanes.add(x,nrun*inner);
+      }
+      if (col_sum) {
+        KahanSum<T>* o_acc = a.col_sum.data() + o*inner;
+        if (inner==1) {
+          LaneKahanSum<T> col_lanes;
+          col_lanes.add(x,nrun);
+          o_acc[0] += col_lanes.reduce();
+        } else {
+          for (int i=0; i<nrun; ++i) {
+            compensated_add(o_acc,x+i*inner,inner);
+          }
+        }
+      }
+      if (per_entry) {
+        for (int i=0; i<nrun; ++i) {
+          set_masked_rows(idx+i);
+          for (int j=0; j<inner; ++j) {
+            add_entry(o*inner+j,x[i*inner+j]);
+          }
+        }
+      }
+    });
+    if (sum) {
+      a.sum += lanes.reduce();
+    }
+  });
+
+  // Combine the chunk results in chunk order, like the individual stats do
+  auto& acc = accs[0];
+  KahanSum<T> total;
+  for (int ichunk=0; ichunk<nchunks; ++ichunk) {
+    total += accs[ichunk].sum;
+    acc.max = std::max(acc.max,accs[ichunk].max);
+    acc.min = std::min(acc.min,accs[ichunk].min);
+  }
+  Kokkos::parallel_for(kernel_label("FusedFieldStats::join"),HostRangePolicy(0,slice_size),
+                       [&](const int k) {
+    for (int ichunk=1; ichunk<nchunks; ++ichunk) {
+      const auto& src = accs[ichunk];
+      if (col_sum) { acc.col_sum[k] += src.col_sum[k]; }
+      if (col_max) { acc.col_max[k] = std::max(acc.col_max[k],src.col_max[k]); }
+      if (col_min) { acc.col_min[k] = std::min(acc.col_min[k],src.col_min[k]); }
+      for (int s=0; s<nmasked; ++s) {
+        const int num_mask_ids = acc.masked[s].size() / slice_size;
+        for (int midx=0; midx<num_mask_ids; ++midx) {
+          acc.masked[s][midx*slice_size+k] += src.masked[s][midx*slice_size+k];
+        }
+      }
+    }
+  });
+
+  // Store local values in the stat fields
+  for (auto& s : m_stats) {
+    if (s->fused_kernel()==FusedKernel::MaskedIntegral) {
+      // Masked integrals have Real data type, and a different ordering
+      continue;
+    }
+    auto stat_data = s->m_stat_field.template data_nonconst<T>();
+    switch (s->fused_kernel()) {
+      case FusedKernel::GlobalSum: stat_data[0] = total.sum; break;
+      case FusedKernel::GlobalMax: stat_data[0] = acc.max;   break;
+      case FusedKernel::GlobalMin: stat_data[0] = acc.min;   break;
+      case FusedKernel::SumAlongColumns:
+        for (int k=0; k<slice_size; ++k) {
+          stat_data[k] = acc.col_sum[k].sum;
+        }
+        break;
+      case FusedKernel::MaxAlongColumns:
+        std::copy(acc.col_max.begin(),acc.col_max.end(),stat_data);
+        break;
+      case FusedKernel::MinAlongColumns:
+        std::copy(acc.col_min.begin(),acc.col_min.end(),stat_data);
+        break;
+      default: break;
+    }
+  }
+  for (int s=0; s<nmasked; ++s) {
+    m_masked[s]->store_local_integrals(acc.masked[s].data());
+  }
+}
+
+} // namespace cldera
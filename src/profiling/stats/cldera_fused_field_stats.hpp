@@ -0,0 +1,96 @@
+#ifndef CLDERA_FUSED_FIELD_STATS_HPP
+#define CLDERA_FUSED_FIELD_STATS_HPP
+
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace cldera {
+
+class FieldMaskedIntegral;
+
+/*
+ * A group of stats on the same field, whose local part is computed
+ * with a single traversal of the field
+ *
+ * Stats whose fused_kernel() is not None reduce the field entries into a few
+ * accumulators (a scalar, one value per column slice entry, or one value per
+ * mask id and slice entry). Computing them one at a time reads the whole
+ * field once per stat. Here, the field is traversed only once: each thread
+ * processes a contiguous range of indices along the traversal dimension (the
+ * columns dimension, for stats along columns and masked integrals), and feeds
+ * each entry to the accumulators of all the stats.
+ *
+ * Partial results are combined in chunk order, like in the stats' own kernels,
+ * so results are reproducible. Once the local values are stored, the stats
+ * register their global reductions in the batch, and must be completed as
+ * usual, via FieldStat::finalize_compute.
+ */
+
+class FusedFieldStats
+{
+public:
+  explicit FusedFieldStats (const Field& f);
+
+  // Whether the stat can be computed as part of this group
+  bool can_fuse (const FieldStat& stat) const;
+
+  void add_stat (const std::shared_ptr<FieldStat>& stat);
+
+  const std::vector<std::shared_ptr<FieldStat>>& get_stats () const { return m_stats; }
+  int num_stats () const { return m_stats.size(); }
+
+  // Compute the local part of all the stats, and add their global reductions to the batch
+  void compute_local (const TimeStamp& timestamp, ReductionBatch& batch);
+
+private:
+  // Index along dim of the traversal dimension required by the stat, or -1 if any dim works
+  int required_dim (const FieldStat& stat) const;
+
+  template<typename T, int N>
+  void do_compute_local ();
+
+  // Per-chunk accumulators. Only the ones needed by the stats are sized/used.
+  template<typename T>
+  struct Accumulators {
+    KahanSum<T>               sum;
+    T                         max;
+    T                         min;
+    std::vector<KahanSum<T>>  col_sum;
+    std::vector<T>            col_max;
+    std::vector<T>            col_min;
+
+    // One (mask_id,slice_entry) array per masked integral stat, plus the
+    // row/weight of the index currently processed
+    std::vector<std::vector<Real>>  masked;
+    std::vector<Real*>              masked_row;
+    std::vector<Real>               masked_w;
+  };
+
+  template<typename T>
+  std::vector<Accumulators<T>>& accumulators ();
+
+  Field   m_field;
+
+  // The traversal dimension (-1 until a stat requires a specific one)
+  int     m_dim = -1;
+
+  std::vector<std::shared_ptr<FieldStat>>           m_stats;
+  std::vector<std::shared_ptr<FieldMaskedIntegral>> m_masked;
+
+  std::vector<Accumulators<Real>>   m_real_acc;
+  std::vector<Accumulators<int>>    m_int_acc;
+
+  // Mask entries and weights of the masked integral stats (sized at the first call)
+  std::vector<const int*>                 m_mask_entries;
+  std::vector<view_1d_host<const Real>>   m_mask_weights;
+
+  // Prebuilt, so that timing the computation does not allocate
+  std::string   m_timer_name;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_FUSED_FIELD_STATS_HPP
@@ -11,6 +11,7 @@
 #include "cldera_field_bounding_box.hpp"
 #include "cldera_field_pnetcdf_reference.hpp"
 #include "cldera_field_zonal_mean.hpp"
+#include "cldera_field_lat_binned_mean.hpp"
 #include "cldera_field_vertical_contraction.hpp"
 #include "cldera_field_stat_pipe.hpp"
 #include "cldera_field_masked_integral.hpp"
@@ -36,6 +37,7 @@ void register_stats ()
   factory.register_product("bounded",&create_stat<FieldBounded>);
   factory.register_product("bounding_box",&create_stat<FieldBoundingBox>);
   factory.register_product("zonal_mean",&create_stat<FieldZonalMean>);
+  factory.register_product("lat_binned_mean",&create_stat<FieldLatBinnedMean>);
 
   factory.register_product("pnetcdf_reference",&create_stat<FieldPnetcdfReference>);
   factory.register_product("vertical_contraction",&create_stat<FieldVerticalContraction>);
@@ -0,0 +1,150 @@
+#ifndef CLDERA_SHARED_FIELD_STAT_HPP
+#define CLDERA_SHARED_FIELD_STAT_HPP
+
+#include "cldera_field_stat.hpp"
+
+namespace cldera
+{
+
+/*
+ * A consumer of a stat shared by several requests (or pipe stages)
+ *
+ * Stats with the same signature (see FieldStat::signature) compute the same
+ * thing, so they only need to be built and computed once. Each request gets
+ * its own SharedFieldStat (with its own name), but all the consumers of the
+ * same stat share a single underlying stat, which is set up by the first
+ * consumer, and computed only once per step, no matter how many consumers
+ * compute it. The stat field of each consumer is a renamed (shallow) copy
+ * of the underlying stat field, so no additional memory is needed.
+ */
+
+class SharedFieldStat : public FieldStat
+{
+public:
+  // Create the first consumer of a stat
+  SharedFieldStat (const ekat::Comm& comm,
+                   const ekat::ParameterList& pl,
+                   const std::shared_ptr<FieldStat>& stat)
+   : FieldStat(comm,pl)
+   , m_node (std::make_shared<Node>())
+  {
+    m_node->stat = stat;
+  }
+
+  // Create another consumer of the same stat as other
+  SharedFieldStat (const ekat::Comm& comm,
+                   const ekat::ParameterList& pl,
+                   const SharedFieldStat& other)
+   : FieldStat(comm,pl)
+   , m_node (other.m_node)
+  { /* Nothing to do here */ }
+
+  std::string type () const override { return m_node->stat->type(); }
+
+  FieldLayout stat_layout (const FieldLayout& fl) const override {
+    return m_node->stat->stat_layout(fl);
+  }
+
+  std::vector<std::string> get_aux_fields_names () const override {
+    return m_node->stat->get_aux_fields_names();
+  }
+
+  DataType stat_data_type () const override { return m_node->stat->stat_data_type(); }
+
+  void set_arena (FieldArena* arena) override {
+    FieldStat::set_arena(arena);
+    m_node->stat->set_arena(arena);
+  }
+
+  void create_stat_field () override {
+    auto& stat = *m_node->stat;
+    if (not stat.get_stat_field().committed()) {
+      stat.create_stat_field();
+    }
+    m_stat_field = stat.get_stat_field();
+    m_stat_field.rename(m_name);
+  }
+
+  // Consumers that need the stat to be complete as soon as they compute it
+  // (e.g., pipe inner stages), rather than after the reductions batch is
+  // reduced, must call this. The shared stat will then do its own reductions.
+  void set_eager () { m_node->eager = true; }
+
+  const std::shared_ptr<FieldStat>& get_shared_stat () const { return m_node->stat; }
+
+  // Number of consumers of the shared stat
+  int num_consumers () const { return m_node.use_count(); }
+
+protected:
+
+  void set_field_impl (const Field& f) override {
+    auto& n = *m_node;
+    if (not n.field_set) {
+      n.stat->set_field(f);
+      n.field_set = true;
+    }
+  }
+
+  void set_aux_fields_impl () override {
+    auto& n = *m_node;
+    if (not n.aux_fields_set) {
+      n.stat->set_aux_fields(m_aux_fields);
+      n.aux_fields_set = true;
+    }
+
+    // Shared stat may have created some aux fields, so grab them
+    for (const auto& it : n.stat->get_aux_fields()) {
+      m_aux_fields[it.first] = it.second;
+    }
+  }
+
+  void compute_impl () override {
+    // Recompute only if this consumer already used the current result,
+    // if the result is for another time (consumers may not compute the
+    // stat at every step), or if nobody computed the stat yet
+    auto& n = *m_node;
+    if (n.epoch==0 or m_epoch==n.epoch or not (n.time==m_timestamp)) {
+      ++n.epoch;
+      n.time = m_timestamp;
+      if (n.eager) {
+        n.stat->compute(m_timestamp);
+      } else {
+        n.stat->compute_local(m_timestamp,*m_batch);
+        n.pending_finalize = true;
+      }
+    }
+    m_epoch = n.epoch;
+  }
+
+  void finalize_impl () override {
+    auto& n = *m_node;
+    if (n.pending_finalize) {
+      n.stat->finalize_compute();
+      n.pending_finalize = false;
+    }
+  }
+
+  struct Node {
+    std::shared_ptr<FieldStat>    stat;
+
+    bool  field_set         = false;
+    bool  aux_fields_set    = false;
+    bool  eager             = false;
+    bool  pending_finalize  = false;
+
+    // Number of times the stat was computed (last one at time)
+    long long   epoch = 0;
+    TimeStamp   time;
+  };
+
+  std::shared_ptr<Node>   m_node;
+
+  // Epoch of the node when this consumer last computed the stat. If it matches
+  // the node epoch, this consumer already used the current result. Unlike a
+  // set of consumers, this requires no allocation at every step.
+  long long               m_epoch = 0;
+};
+
+} // namespace cldera
+
+#endif // CLDERA_SHARED_FIELD_STAT_HPP
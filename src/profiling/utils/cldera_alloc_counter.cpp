@@ -0,0 +1,70 @@
+#include "profiling/utils/cldera_alloc_counter.hpp"
+
+#ifdef CLDERA_ENABLE_ALLOC_COUNTER
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<long long> g_num_allocations (0);
+
+void* counted_alloc_nothrow (std::size_t size) noexcept {
+  ++g_num_allocations;
+  return std::malloc(size==0 ? 1 : size);
+}
+
+void* counted_alloc_nothrow (std::size_t size, std::align_val_t al) noexcept {
+  ++g_num_allocations;
+  // aligned_alloc wants the size to be a multiple of the alignment
+  const auto align = static_cast<std::size_t>(al);
+  const auto padded = size==0 ? align : (size+align-1)/align*align;
+  return std::aligned_alloc(align,padded);
+}
+
+template<typename... Args>
+void* counted_alloc (Args... args) {
+  void* p = counted_alloc_nothrow(args...);
+  if (p==nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+} // anonymous namespace
+
+// All the replaceable forms of the global operator new are replaced,
+// so that we do not rely on how the standard library implements each one.
+// Both malloc and aligned_alloc memory is released with free.
+void* operator new (std::size_t size) { return counted_alloc(size); }
+void* operator new[] (std::size_t size) { return counted_alloc(size); }
+void* operator new (std::size_t size, std::align_val_t al) { return counted_alloc(size,al); }
+void* operator new[] (std::size_t size, std::align_val_t al) { return counted_alloc(size,al); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc_nothrow(size); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc_nothrow(size); }
+void* operator new (std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return counted_alloc_nothrow(size,al); }
+void* operator new[] (std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return counted_alloc_nothrow(size,al); }
+
+void operator delete (void* p) noexcept { std::free(p); }
+void operator delete[] (void* p) noexcept { std::free(p); }
+void operator delete (void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[] (void* p, std::size_t) noexcept { std::free(p); }
+void operator delete (void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[] (void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete (void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[] (void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete (void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[] (void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace cldera {
+long long num_allocations () { return g_num_allocations.load(); }
+} // namespace cldera
+
+#else
+
+namespace cldera {
+long long num_allocations () { return 0; }
+} // namespace cldera
+
+#endif // CLDERA_ENABLE_ALLOC_COUNTER
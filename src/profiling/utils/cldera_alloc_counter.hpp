@@ -0,0 +1,28 @@
+#ifndef CLDERA_ALLOC_COUNTER_HPP
+#define CLDERA_ALLOC_COUNTER_HPP
+
+#include "cldera_config.h"
+
+namespace cldera {
+
+/*
+ * Count of heap allocations done by the process so far
+ *
+ * If CLDERA_ENABLE_ALLOC_COUNTER is on, all forms of the global operator new
+ * (plain, array, aligned, nothrow) are replaced with ones that count the calls
+ * (across all threads), and forward to malloc/aligned_alloc.
+ * This is meant for testing, e.g. to check that computing stats does not
+ * allocate once the first step is done. If the option is off, this always
+ * returns 0, and the global operator new is left alone.
+ *
+ * NOTE: ONLY calls to operator new are counted. Memory obtained by calling
+ *       malloc/calloc/aligned_alloc/posix_memalign directly is NOT counted.
+ *       This includes Kokkos views if Kokkos allocates with malloc (as
+ *       HostSpace does in Kokkos 3), as well as MPI and pnetcdf buffers.
+ */
+
+long long num_allocations ();
+
+} // namespace cldera
+
+#endif // CLDERA_ALLOC_COUNTER_HPP
@@ -91,23 +91,35 @@ dump (std::ostream& out, const ekat::Comm& comm) const
 }
 
 void TimingSession::
-start_timer (const std::string& timer_name)
+start_timer (const char* timer_name)
 {
   if (session_active) {
-    auto& timer = timers[timer_name];
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    auto& timer = get_timer(timer_name);
     timer.start();
   }
 }
 
 void TimingSession::
-stop_timer (const std::string& timer_name)
+stop_timer (const char* timer_name)
 {
   if (session_active) {
-    auto& timer = timers[timer_name];
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    auto& timer = get_timer(timer_name);
     timer.stop();
   }
 }
 
+Timer& TimingSession::
+get_timer (const char* timer_name)
+{
+  auto it = timers.find(timer_name);
+  if (it==timers.end()) {
+    it = timers.emplace(timer_name,Timer()).first;
+  }
+  return it->second;
+}
+
 void TimingSession::
 toggle_session (const bool on)
 {
@@ -117,8 +129,9 @@ toggle_session (const bool on)
 void TimingSession::
 clean_up ()
 {
-  TimingSession ts;
-  std::swap(ts,*this);
+  std::lock_guard<std::mutex> lock(timers_mutex);
+  timers.clear();
+  session_active = true;
 }
 
 } // namespace timing
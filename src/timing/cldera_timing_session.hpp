@@ -6,6 +6,7 @@
 #include <ekat/mpi/ekat_comm.hpp>
 
 #include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
 
@@ -15,13 +16,16 @@ namespace timing {
 // This class stores timers, so that it can later dump
 // all stats to file. The class follows the singleton
 // pattern, so the same data can be accessed from anywhere
-// in the host app.
+// in the host app. Timers can be started/stopped from
+// different threads (e.g., the async output thread), as long
+// as each timer is used by one thread at a time.
 
 struct TimingSession
 {
 public:
+  // Transparent comparator, so that timers can be found without building a std::string
   template<typename T>
-  using strmap_t = std::map<std::string,T>;
+  using strmap_t = std::map<std::string,T,std::less<>>;
 
   // Create a separate, individual instance
   TimingSession () = default;
@@ -36,9 +40,12 @@ public:
   void dump (      std::ostream& out,
              const ekat::Comm& comm) const;
 
-  // Start/stop a given timer
-  void start_timer (const std::string& timer_name);
-  void stop_timer (const std::string& timer_name);
+  // Start/stop a given timer. Passing a string literal does not allocate
+  // (except the first time, when the timer is created)
+  void start_timer (const std::string& timer_name) { start_timer(timer_name.c_str()); }
+  void stop_timer (const std::string& timer_name) { stop_timer(timer_name.c_str()); }
+  void start_timer (const char* timer_name);
+  void stop_timer (const char* timer_name);
 
   // Toggle on/off actual timing
   void toggle_session (const bool on);
@@ -49,10 +56,15 @@ public:
   void clean_up ();
 private:
 
+  // Get a timer, creating it if not yet present
+  Timer& get_timer (const char* timer_name);
+
   // map[timer_name] = timer_history
   strmap_t<Timer>   timers;
 
   bool session_active = true;
+
+  mutable std::mutex timers_mutex;
 };
 
 } // namespace timing
@@ -5,6 +5,7 @@
 
 #include <catch2/catch.hpp>
 
+#include <iomanip>
 #include <iostream>
 
 void toggle_timing (const bool on) {
@@ -85,7 +86,8 @@ void write_bad ()
 void write (const std::string& fname_prefix,
             const cldera::io::pnetcdf::IOMode mode,
             const int num_steps = 1,
-            const int data_offset = 0)
+            const int data_offset = 0,
+            const bool buffered = false)
 {
   // Do timings
   toggle_timing(true);
@@ -143,6 +145,12 @@ void write (const std::string& fname_prefix,
   // Add decomposition
   add_decomp (*file,"lat",my_lat);
 
+  // Queue the writes of each step, and complete them at once
+  if (buffered) {
+    attach_buffer (*file);
+    REQUIRE (file->buffer_size>0);
+  }
+
   // Create data in an rank-independent way
   int nlats = my_lat.size();
   std::vector<double>     tdata(nlats*nglon);
@@ -161,6 +169,12 @@ void write (const std::string& fname_prefix,
     write_var(*file,"I",idata.data());
 
     update_time(*file,step+data_offset);
+
+    if (buffered) {
+      REQUIRE (file->requests.size()>0);
+      wait_all(*file);
+      REQUIRE (file->requests.size()==0);
+    }
   }
 
   close_file(*file);
@@ -302,6 +316,9 @@ TEST_CASE ("pnetcdf_io") {
   write ("restarted",IOMode::Write,1,0);
   write ("restarted",IOMode::Append,1,1);
 
+  // Same, but with buffered nonblocking writes
+  write ("buffered",IOMode::Write,2,0,true);
+
   // Print timing stats, just for fun
   std::stringstream blackhole;
   std::ostream& cout = std::cout;
@@ -310,3 +327,191 @@ TEST_CASE ("pnetcdf_io") {
   std::ostream& out = comm.am_i_root() ? cout : null;
   TimingSession::instance().dump(out,comm);
 }
+
+TEST_CASE ("pnetcdf_decomp_write") {
+  // Write a decomposed (ncol,lev) variable of roughly the size of an ne30
+  // 3d field, with a block decomposition (one contiguous run of columns per
+  // rank) and a cyclic one (every column is a separate run), and read it back
+  using namespace cldera::io::pnetcdf;
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  constexpr int ngcols = 48602;
+  constexpr int nlevs  = 72;
+  constexpr int nsteps = 3;
+
+  for (const bool cyclic : {false, true}) {
+    std::vector<int> my_cols;
+    for (int gid=0; gid<ngcols; ++gid) {
+      const int owner = cyclic ? gid % size
+                               : static_cast<long long>(gid)*size/ngcols;
+      if (owner==rank) {
+        my_cols.push_back(gid);
+      }
+    }
+    const int ncols = my_cols.size();
+
+    const std::string decomp_name = cyclic ? "cyclic" : "block";
+    const std::string fname = "decomp_write_" + decomp_name + "_np" + std::to_string(size) + ".nc";
+    auto file = open_file (fname,comm,IOMode::Write);
+    add_dim (*file,"ncol",ncols,true);
+    add_dim (*file,"lev",nlevs);
+    add_var (*file,"T","double",{"ncol","lev"},true);
+    enddef (*file);
+    add_decomp (*file,"ncol",my_cols);
+
+    std::vector<double> data(ncols*nlevs);
+    for (int step=0; step<nsteps; ++step) {
+      for (int i=0; i<ncols; ++i) {
+        for (int k=0; k<nlevs; ++k) {
+          data[i*nlevs+k] = step*ngcols*nlevs + my_cols[i]*nlevs + k;
+        }
+      }
+      write_var (*file,"T",data.data());
+    }
+    close_file (*file);
+
+    // Check the data was written correctly, by reading back the last record
+    file = open_file (fname,comm,IOMode::Read);
+    add_decomp (*file,"ncol",my_cols);
+    std::vector<double> read_data(ncols*nlevs);
+    read_var (*file,"T",read_data.data(),nsteps-1);
+    close_file (*file);
+    REQUIRE (read_data==data);
+  }
+}
+
+TEST_CASE ("pnetcdf_rank4_vars") {
+  // Write rank-4 decomposed vars (plus time), with the decomposed dim at all
+  // possible positions, two records at a time, and read them back. With a
+  // block decomposition, the vars with ncol as outermost dim need no packing.
+  using namespace cldera::io::pnetcdf;
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  constexpr int ngcols = 10;
+  const std::vector<std::string> names = {"ncol","a","b","c"};
+  const std::vector<int> lens = {ngcols,2,3,2};
+  const std::vector<std::vector<int>> layouts = {{0,1,2,3},{1,0,2,3},{1,2,0,3},{1,2,3,0}};
+
+  for (const bool cyclic : {false, true}) {
+    std::vector<int> my_cols;
+    for (int gid=0; gid<ngcols; ++gid) {
+      const int owner = cyclic ? gid % size : gid*size/ngcols;
+      if (owner==rank) {
+        my_cols.push_back(gid);
+      }
+    }
+    const int ncols = my_cols.size();
+
+    const std::string fname = std::string("rank4_") + (cyclic ? "cyclic" : "block") +
+                              "_np" + std::to_string(size) + ".nc";
+    auto file = open_file (fname,comm,IOMode::Write);
+    add_dim (*file,"ncol",ncols,true);
+    for (int i=1; i<4; ++i) {
+      add_dim (*file,names[i],lens[i]);
+    }
+    for (size_t v=0; v<layouts.size(); ++v) {
+      std::vector<std::string> dims;
+      for (auto d : layouts[v]) {
+        dims.push_back(names[d]);
+      }
+      add_var (*file,"V" + std::to_string(v),"double",dims,true);
+    }
+    enddef (*file);
+    add_decomp (*file,"ncol",my_cols);
+
+    // Value of each entry: record*10000 + global (row-major) index
+    const int var_size = ncols*2*3*2;
+    std::vector<std::vector<double>> data(layouts.size(),std::vector<double>(2*var_size));
+    for (size_t v=0; v<layouts.size(); ++v) {
+      const auto& l = layouts[v];
+      for (int t=0; t<2; ++t) {
+        for (int idx=0; idx<var_size; ++idx) {
+          int rem = idx;
+          long long gidx = 0, stride = 1;
+          for (int i=3; i>=0; --i) {
+            const int len = l[i]==0 ? ncols : lens[l[i]];
+            const int j = rem % len;
+            rem /= len;
+            gidx += stride*(l[i]==0 ? my_cols[j] : j);
+            stride *= lens[l[i]];
+          }
+          data[v][t*var_size+idx] = t*10000 + gidx;
+        }
+      }
+      write_var (*file,"V" + std::to_string(v),data[v].data(),2);
+    }
+    close_file (*file);
+
+    file = open_file (fname,comm,IOMode::Read);
+    add_decomp (*file,"ncol",my_cols);
+    for (size_t v=0; v<layouts.size(); ++v) {
+      std::vector<double> read_data(var_size);
+      for (int t=0; t<2; ++t) {
+        read_var (*file,"V" + std::to_string(v),read_data.data(),t);
+        REQUIRE (std::equal(read_data.begin(),read_data.end(),data[v].begin()+t*var_size));
+      }
+    }
+    close_file (*file);
+  }
+}
+
+TEST_CASE ("pnetcdf_decomp_read") {
+  // Tile the ipcc mask (on ne4pg2) to grids of increasing size, and read it
+  // back with a cyclic decomposition (every column is a separate run), which
+  // is the worst case for the reads of masks and reference data in the stats.
+  using namespace cldera::io::pnetcdf;
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  auto mask_file = open_file ("../../data/ipcc_mask_ne4pg2.nc",comm,IOMode::Read);
+  const int nmask = mask_file->dims.at("ncol")->len;
+  std::vector<int> mask(nmask);
+  read_var (*mask_file,"mask",mask.data());
+  close_file (*mask_file);
+
+  for (const int ntiles : {1, 64, 512}) {
+    const int ngcols = ntiles*nmask;
+    auto get_cols = [&](const bool cyclic) {
+      std::vector<int> cols;
+      for (int gid=0; gid<ngcols; ++gid) {
+        const int owner = cyclic ? gid % size
+                                 : static_cast<long long>(gid)*size/ngcols;
+        if (owner==rank) {
+          cols.push_back(gid);
+        }
+      }
+      return cols;
+    };
+
+    const std::string fname = "decomp_read_tiles" + std::to_string(ntiles) +
+                              "_np" + std::to_string(size) + ".nc";
+    auto block_cols = get_cols(false);
+    std::vector<int> data(block_cols.size());
+    for (size_t i=0; i<block_cols.size(); ++i) {
+      data[i] = mask[block_cols[i] % nmask];
+    }
+    auto file = open_file (fname,comm,IOMode::Write);
+    add_dim (*file,"ncol",block_cols.size(),true);
+    add_var (*file,"mask","int",{"ncol"},false);
+    enddef (*file);
+    add_decomp (*file,"ncol",block_cols);
+    write_var (*file,"mask",data.data());
+    close_file (*file);
+
+    auto cyclic_cols = get_cols(true);
+    std::vector<int> read_data(cyclic_cols.size());
+    file = open_file (fname,comm,IOMode::Read);
+    add_decomp (*file,"ncol",cyclic_cols);
+    read_var (*file,"mask",read_data.data());
+    close_file (*file);
+
+    for (size_t i=0; i<cyclic_cols.size(); ++i) {
+      REQUIRE (read_data[i]==mask[cyclic_cols[i] % nmask]);
+    }
+  }
+}
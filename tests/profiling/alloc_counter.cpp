@@ -0,0 +1,196 @@
+#include "profiling/cldera_profiling_interface.hpp"
+#include "profiling/cldera_profiling_types.hpp"
+#include "profiling/utils/cldera_alloc_counter.hpp"
+
+#include <ekat/ekat_assert.hpp>
+
+#include <mpi.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Synthetic driver checking that, once the first step is done, computing
+// the stats does not allocate any memory on the heap. The global operator
+// new is replaced by one that counts allocations (CLDERA_ENABLE_ALLOC_COUNTER).
+// Output is flushed only at clean up, so writing records is also checked.
+// Stats cover the steady-state paths of the stats plan: fused stats, shared
+// (duplicate) stats, pipes with a shared inner stage, masked integrals,
+// stats computed every other step, and async reductions.
+
+int main (int argc, char** argv)
+{
+  using namespace cldera;
+
+  MPI_Init(&argc,&argv);
+
+  int size, rank;
+  MPI_Comm_size(MPI_COMM_WORLD,&size);
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+  const std::string name = "alloc_counter_np" + std::to_string(size);
+
+  constexpr int ncols = 24;
+  constexpr int nlevs = 4;
+  constexpr int nsteps = 6;
+  // The first step creates the timers, and the scratch buffers of the stats and
+  // of the reduction batch. With async reductions, the stats of the first step
+  // are completed (and stored in the archive) at the second step, which sets
+  // up the output files and their records
+  constexpr int nwarmup = 2;
+
+  // The session file is read from the cwd, and other drivers (e.g., in_transit)
+  // may run at the same time, so run in our own directory (which is why the
+  // mask file path has an extra ..)
+  if (rank==0) {
+    mkdir(name.c_str(),0755);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  EKAT_REQUIRE_MSG (chdir(name.c_str())==0,
+      "Error! Could not move to directory '" + name + "'.\n");
+
+  if (rank==0) {
+    std::ofstream session("cldera_profiling_config.yaml");
+    session << name << ": " << name << ".yaml\n";
+    session.close();
+
+    std::ofstream params(name + ".yaml");
+    params << "%YAML 1.0\n"
+              "---\n"
+              "Timing Filename: " << name << "_timings.txt\n"
+              "Async Stats Reductions: true\n"
+              "Profiling Output:\n"
+              "  filename_prefix: " << name << "\n"
+              "  Flush Frequency: " << 2*nsteps << "\n"
+              "Fields To Track: [T]\n"
+              "T:\n"
+              "  Compute Stats: [T_gmax, T_gmax_dup, T_gmin, T_gsum, T_gavg, T_cavg, T_zmean,\n"
+              "                  T_vmax, T_vavg, T_mint, T_cmax_every2]\n"
+              "  T_gmax:\n"
+              "    type: global_max\n"
+              "  T_gmax_dup:\n"
+              "    type: global_max\n"
+              "  T_vmax:\n"
+              "    type: pipe\n"
+              "    inner:\n"
+              "      type: vertical_contraction\n"
+              "      level_bounds: [1,2]\n"
+              "    outer:\n"
+              "      type: global_max\n"
+              "  T_vavg:\n"
+              "    type: pipe\n"
+              "    inner:\n"
+              "      type: vertical_contraction\n"
+              "      level_bounds: [1,2]\n"
+              "    outer:\n"
+              "      type: global_avg\n"
+              "  T_mint:\n"
+              "    type: masked_integral\n"
+              "    mask_file_name: ../../../data/ipcc_mask_ne4pg2.nc\n"
+              "  T_cmax_every2:\n"
+              "    type: max_along_columns\n"
+              "    compute_every: 2\n"
+              "  T_gmin:\n"
+              "    type: global_min\n"
+              "  T_gsum:\n"
+              "    type: global_sum\n"
+              "  T_gavg:\n"
+              "    type: global_avg\n"
+              "  T_cavg:\n"
+              "    type: avg_along_columns\n"
+              "  T_zmean:\n"
+              "    type: zonal_mean\n"
+              "    Latitude Bounds: [-1.0, 1.0]\n"
+              "...\n";
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  const int ymd = 20220915;
+  const int tod = 43000;
+  const char* context_name = name.c_str();
+  cldera_init_c(context_name,MPI_Comm_c2f(MPI_COMM_WORLD),ymd,tod,ymd,tod,ymd,tod+nsteps*1800);
+
+  // Columns are split in contiguous blocks across ranks, and each
+  // block in (up to) two chunks, padded to pcols, like in E3SM
+  const int beg = rank*ncols/size;
+  const int my_ncols = (rank+1)*ncols/size - beg;
+  const int nparts = std::min(2,my_ncols);
+  const int pcols = ncols;
+  std::vector<int> part_beg(nparts+1);
+  for (int p=0; p<=nparts; ++p) {
+    part_beg[p] = beg + p*my_ncols/nparts;
+  }
+
+  std::vector<std::vector<Real>> T(nparts,std::vector<Real>(nlevs*pcols));
+  std::vector<std::vector<Real>> lat(nparts,std::vector<Real>(pcols,0));
+  std::vector<std::vector<Real>> area(nparts,std::vector<Real>(pcols,1));
+  std::vector<std::vector<int>>  gids(nparts,std::vector<int>(pcols));
+
+  const char* real = "real";
+  const char* integer = "int";
+  const char* lev_name = "lev";
+  const char* col_name = "ncol";
+  const char* dimnames_3d[2] = {lev_name,col_name};
+  const char* dimnames_2d[1] = {col_name};
+  const int dims_3d[2] = {nlevs,my_ncols};
+  const int dims_2d[1] = {my_ncols};
+  for (const std::string fname : {"T","lat","area","col_gids"}) {
+    const char* n = fname.c_str();
+    const bool is_3d = fname=="T";
+    const char*& dtype = fname=="col_gids" ? integer : real;
+    cldera_add_partitioned_field_c(n,is_3d ? 2 : 1,is_3d ? dims_3d : dims_2d,
+                                   is_3d ? dimnames_3d : dimnames_2d,
+                                   nparts,is_3d ? 1 : 0,pcols,true,dtype);
+    for (int p=0; p<nparts; ++p) {
+      cldera_set_field_part_extent_c(n,p,part_beg[p+1]-part_beg[p]);
+      const void* data;
+      if (fname=="T") {
+        data = T[p].data();
+      } else if (fname=="lat") {
+        data = lat[p].data();
+      } else if (fname=="area") {
+        data = area[p].data();
+      } else {
+        for (int i=0; i<pcols; ++i) {
+          gids[p][i] = part_beg[p] + i + 1;
+        }
+        data = gids[p].data();
+      }
+      cldera_set_field_part_data_c(n,p,data,dtype);
+    }
+  }
+  cldera_commit_all_fields_c();
+
+  // E3SM calls this at run_t0 too, but no stats are computed
+  cldera_compute_stats_c(ymd,tod);
+  int nfails = 0;
+  for (int step=0; step<nsteps; ++step) {
+    for (int p=0; p<nparts; ++p) {
+      for (int lev=0; lev<nlevs; ++lev) {
+        for (int i=0; i<part_beg[p+1]-part_beg[p]; ++i) {
+          T[p][lev*pcols+i] = step*1000 + (part_beg[p]+i)*nlevs + lev;
+        }
+      }
+    }
+    const long long before = num_allocations();
+    cldera_compute_stats_c(ymd,tod+(step+1)*1800);
+    const long long nallocs = num_allocations() - before;
+    if (step>=nwarmup and nallocs>0) {
+      printf(" [alloc_counter] rank %d, step %d: %lld heap allocations while computing stats\n",
+             rank,step,nallocs);
+      ++nfails;
+    }
+  }
+
+  cldera_clean_up_c();
+
+  int nfails_global;
+  MPI_Allreduce(&nfails,&nfails_global,1,MPI_INT,MPI_SUM,MPI_COMM_WORLD);
+
+  MPI_Finalize();
+  return nfails_global==0 ? 0 : 1;
+}
@@ -2,6 +2,7 @@
 
 #include "profiling/cldera_profiling_archive.hpp"
 #include "profiling/stats/cldera_field_global_max.hpp"
+#include "profiling/stats/cldera_field_global_min.hpp"
 
 TEST_CASE ("archive") {
   using namespace cldera;
@@ -32,3 +33,238 @@ TEST_CASE ("archive") {
   archive.update_stat("foo",foo_max.name(),foo_max.compute(ts));
   archive.end_timestep(ts+=86400);
 }
+
+TEST_CASE ("archive_cadence") {
+  using namespace cldera;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp ts(ymd,tod);
+
+  ekat::ParameterList params;
+  params.set<std::string>("filename_prefix","archive_cadence_tests");
+
+  ProfilingArchive archive(comm,ts,ts,params);
+
+  std::vector<Real> foo_data (20,3.0);
+  archive.add_field(Field("foo",{5,4},{"col","lev"},foo_data.data()));
+  auto foo = archive.get_field("foo");
+
+  FieldGlobalMax foo_max(comm,ekat::ParameterList("foo_max"));
+  FieldGlobalMax foo_max_every2(comm,ekat::ParameterList("foo_max_every2"));
+  for (auto s : {&foo_max,&foo_max_every2}) {
+    s->set_field(foo);
+    s->create_stat_field();
+  }
+  archive.set_stat_cadence("foo",foo_max_every2.name(),"every_2_steps");
+  REQUIRE_THROWS (archive.set_stat_cadence("bar",foo_max_every2.name(),"every_2_steps"));
+
+  // The cadence stream gets one time slice every other step
+  for (int step=0; step<4; ++step) {
+    archive.update_stat("foo",foo_max.name(),foo_max.compute(ts));
+    if (step%2==0) {
+      archive.update_stat("foo",foo_max_every2.name(),foo_max_every2.compute(ts));
+    }
+    archive.end_timestep(ts+=3600);
+  }
+}
+
+TEST_CASE ("archive_flush") {
+  using namespace cldera;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+
+  // Keep 3 records in memory (the last one is written by the destructor),
+  // with and without buffered nonblocking writes. With a tiny byte cap,
+  // records are written one at a time. With async output, they are written
+  // by the I/O thread (or synchronously, if MPI does not support it).
+  // All files must have the same content.
+  for (const std::string prefix : {"archive_flush_tests","archive_flush_capped_tests",
+                                   "archive_flush_async_tests"}) {
+    int ymd = 20220915;
+    int tod = 43000;
+    TimeStamp ts(ymd,tod);
+
+    ekat::ParameterList params;
+    params.set<std::string>("filename_prefix",prefix);
+    params.set("Flush Frequency",3);
+    if (prefix=="archive_flush_capped_tests") {
+      params.set("Flush Max Bytes",1);
+    } else if (prefix=="archive_flush_async_tests") {
+      params.set("Async Output",true);
+    } else {
+      params.set("Buffered Output",true);
+    }
+
+    ProfilingArchive archive(comm,ts,ts,params);
+
+    std::vector<Real> foo_data (20,0.0);
+    archive.add_field(Field("foo",{5,4},{"col","lev"},foo_data.data()));
+    auto foo = archive.get_field("foo");
+
+    FieldGlobalMax foo_max(comm,ekat::ParameterList("foo_max"));
+    foo_max.set_field(foo);
+    foo_max.create_stat_field();
+    for (int step=0; step<7; ++step) {
+      foo_data[step] = step;
+      archive.update_stat("foo",foo_max.name(),foo_max.compute(ts));
+      archive.end_timestep(ts+=3600);
+    }
+  }
+}
+
+TEST_CASE ("archive_packed_scalars") {
+  using namespace cldera;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+
+  // Scalar stats are stored as columns of a single (time,nscalar) var
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp ts(ymd,tod);
+
+  ekat::ParameterList params;
+  params.set<std::string>("filename_prefix","archive_packed_tests");
+  params.set("Flush Frequency",3);
+  params.set("Pack Scalar Stats",true);
+
+  ProfilingArchive archive(comm,ts,ts,params);
+
+  std::vector<Real> foo_data (20,0.0);
+  archive.add_field(Field("foo",{5,4},{"col","lev"},foo_data.data()));
+  auto foo = archive.get_field("foo");
+
+  FieldGlobalMax foo_max(comm,ekat::ParameterList("foo_max"));
+  FieldGlobalMin foo_min(comm,ekat::ParameterList("foo_min"));
+  for (FieldStat* s : std::vector<FieldStat*>{&foo_max,&foo_min}) {
+    s->set_field(foo);
+    s->create_stat_field();
+  }
+  // Packed stats can keep their own nsd, but not their own precision
+  archive.set_stat_output_format("foo",foo_min.name(),"",3);
+  for (int step=0; step<7; ++step) {
+    foo_data[step] = step;
+    archive.update_stat("foo",foo_max.name(),foo_max.compute(ts));
+    archive.update_stat("foo",foo_min.name(),foo_min.compute(ts));
+    archive.end_timestep(ts+=3600);
+  }
+}
+
+TEST_CASE ("archive_output_format") {
+  using namespace cldera;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+
+  // By default, stats are written as float. One stat is written as double,
+  // but keeping only 3 significant digits (i.e., 10 bits of mantissa)
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp ts(ymd,tod);
+
+  ekat::ParameterList params;
+  params.set<std::string>("filename_prefix","archive_format_tests");
+  params.set<std::string>("Output Precision","float");
+
+  ProfilingArchive archive(comm,ts,ts,params);
+
+  std::vector<Real> foo_data (20,1.23456789);
+  archive.add_field(Field("foo",{5,4},{"col","lev"},foo_data.data()));
+  auto foo = archive.get_field("foo");
+
+  FieldGlobalMax foo_max(comm,ekat::ParameterList("foo_max"));
+  FieldGlobalMax foo_max_rounded(comm,ekat::ParameterList("foo_max_rounded"));
+  for (auto s : {&foo_max,&foo_max_rounded}) {
+    s->set_field(foo);
+    s->create_stat_field();
+  }
+  REQUIRE_THROWS (archive.set_stat_output_format("foo",foo_max_rounded.name(),"half",3));
+  archive.set_stat_output_format("foo",foo_max_rounded.name(),"double",3);
+
+  archive.update_stat("foo",foo_max.name(),foo_max.compute(ts));
+  archive.update_stat("foo",foo_max_rounded.name(),foo_max_rounded.compute(ts));
+  archive.end_timestep(ts+=3600);
+}
+
+TEST_CASE ("archive_hierarchy") {
+  using namespace cldera;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+
+  // The 4-steps stream is built from the 2-steps one, and the daily stream
+  // from the raw steps. Starting at noon, with 1h steps, the first day
+  // ends after 12 steps.
+  int ymd = 20220915;
+  int tod = 43200;
+  TimeStamp ts(ymd,tod);
+
+  ekat::ParameterList params;
+  params.set<std::string>("filename_prefix","archive_hierarchy_tests");
+  params.set("Flush Frequency",3);
+  params.set("time_averaging_window_sizes",std::vector<int>{1,2,4});
+  params.set("time_averaging_calendar_windows",std::vector<std::string>{"daily"});
+
+  auto bad_params = params;
+  bad_params.set("time_averaging_calendar_windows",std::vector<std::string>{"weekly"});
+  REQUIRE_THROWS (ProfilingArchive(comm,ts,ts,bad_params));
+
+  ProfilingArchive archive(comm,ts,ts,params);
+
+  std::vector<Real> foo_data (20,0);
+  archive.add_field(Field("foo",{5,4},{"col","lev"},foo_data.data()));
+  auto foo = archive.get_field("foo");
+
+  FieldGlobalMax foo_max(comm,ekat::ParameterList("foo_max"));
+  foo_max.set_field(foo);
+  foo_max.create_stat_field();
+
+  for (int step=0; step<16; ++step) {
+    std::fill(foo_data.begin(),foo_data.end(),step);
+    archive.update_stat("foo",foo_max.name(),foo_max.compute(ts));
+    archive.end_timestep(ts+=3600);
+  }
+}
+
+TEST_CASE ("archive_stat_handles") {
+  using namespace cldera;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp ts(ymd,tod);
+
+  ekat::ParameterList params;
+  params.set<std::string>("filename_prefix","archive_handles_tests");
+
+  ProfilingArchive archive(comm,ts,ts,params);
+
+  std::vector<Real> foo_data (20,3.0);
+  archive.add_field(Field("foo",{5,4},{"col","lev"},foo_data.data()));
+  auto foo = archive.get_field("foo");
+
+  FieldGlobalMax foo_max(comm,ekat::ParameterList("foo_max"));
+  FieldGlobalMin foo_min(comm,ekat::ParameterList("foo_min"));
+  for (auto s : std::vector<FieldStat*>{&foo_max,&foo_min}) {
+    s->set_field(foo);
+    s->create_stat_field();
+  }
+  REQUIRE_THROWS (archive.get_stat_handle("bar",foo_max.name()));
+
+  // Handles are resolved once, and can be mixed with the name-based calls
+  const int h_max = archive.get_stat_handle("foo",foo_max.name());
+  const int h_min = archive.get_stat_handle("foo",foo_min.name());
+  REQUIRE (h_max!=h_min);
+  REQUIRE (archive.get_stat_handle("foo",foo_max.name())==h_max);
+  REQUIRE_THROWS (archive.update_stat(h_min+1,foo_max.compute(ts)));
+
+  // New cadences may move the stats accumulators
+  REQUIRE_THROWS (archive.set_stat_cadence("foo","foo_other","every_2_steps"));
+
+  for (int step=0; step<2; ++step) {
+    archive.update_stat(h_max,foo_max.compute(ts));
+    archive.update_stat("foo",foo_min.name(),foo_min.compute(ts));
+    archive.end_timestep(ts+=3600);
+  }
+}
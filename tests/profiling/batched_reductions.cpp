@@ -0,0 +1,218 @@
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/cldera_reduction_batch.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <numeric>
+#include <map>
+
+TEST_CASE ("reduction_batch") {
+  using namespace cldera;
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  ReductionBatch batch;
+
+  std::vector<int>    isum = {rank, 2*rank};
+  std::vector<Real>   dsum1 = {1.0*rank};
+  std::vector<Real>   dsum2 = {1.0, 2.0, 3.0};
+  std::vector<Real>   dmax = {1.0*rank, -1.0*rank};
+  long long           lsum = 1;
+
+  batch.add(isum.data(),isum.size(),MPI_SUM);
+  batch.add(dsum1.data(),dsum1.size(),MPI_SUM);
+  batch.add(dmax.data(),dmax.size(),MPI_MAX);
+  batch.add(dsum2.data(),dsum2.size(),MPI_SUM);
+  batch.add(&lsum,1,MPI_SUM);
+
+  REQUIRE (batch.num_entries()==5);
+  REQUIRE (batch.num_collectives()==4);
+
+  batch.reduce(comm);
+  REQUIRE (batch.empty());
+
+  const int rsum = size*(size-1)/2;
+  REQUIRE (isum[0]==rsum);
+  REQUIRE (isum[1]==2*rsum);
+  REQUIRE (dsum1[0]==rsum);
+  REQUIRE (dsum2[0]==size);
+  REQUIRE (dsum2[1]==2*size);
+  REQUIRE (dsum2[2]==3*size);
+  REQUIRE (dmax[0]==size-1);
+  REQUIRE (dmax[1]==0);
+  REQUIRE (lsum==size);
+
+  // The batch can be reused
+  int val = 1;
+  batch.add(&val,1,MPI_MAX);
+  REQUIRE (batch.num_collectives()==1);
+  batch.reduce(comm);
+  REQUIRE (val==1);
+
+  // Non-blocking version
+  isum = {rank, 2*rank};
+  dmax = {1.0*rank, -1.0*rank};
+  batch.add(isum.data(),isum.size(),MPI_SUM);
+  batch.add(dmax.data(),dmax.size(),MPI_MAX);
+  batch.post(comm);
+  REQUIRE (batch.pending());
+  REQUIRE_THROWS (batch.add(&val,1,MPI_MAX));
+  REQUIRE_THROWS (batch.reduce(comm));
+  batch.wait();
+  REQUIRE (not batch.pending());
+  REQUIRE (batch.empty());
+  REQUIRE (isum[0]==rsum);
+  REQUIRE (isum[1]==2*rsum);
+  REQUIRE (dmax[0]==size-1);
+  REQUIRE (dmax[1]==0);
+}
+
+TEST_CASE ("reduction_batch_contiguous") {
+  using namespace cldera;
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  // Adjacent buffers are merged, and reduced in place
+  ReductionBatch batch;
+  std::vector<Real> buf = {1.0*rank, 2.0*rank, 3.0*rank, 4.0*rank};
+  batch.add(buf.data(),1,MPI_SUM);
+  batch.add(buf.data()+1,2,MPI_SUM);
+  batch.add(buf.data()+3,1,MPI_SUM);
+  REQUIRE (batch.num_entries()==1);
+  REQUIRE (batch.num_collectives()==1);
+
+  // Non adjacent ones are not
+  Real other = rank;
+  batch.add(&other,1,MPI_SUM);
+  REQUIRE (batch.num_entries()==2);
+
+  batch.reduce(comm);
+  const int rsum = size*(size-1)/2;
+  for (int i=0; i<4; ++i) {
+    REQUIRE (buf[i]==(i+1)*rsum);
+  }
+  REQUIRE (other==rsum);
+}
+
+TEST_CASE ("batched_stats") {
+  using namespace cldera;
+
+  register_stats();
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Field dimensions
+  constexpr int nlevs = 4;
+  constexpr int ncols = 8;
+  constexpr int nparts = 2;
+  constexpr int part_size = ncols / nparts;
+
+  // Create input field, as well as lat/area. All values are integers,
+  // so that the result of sums does not depend on the order of operations
+  Field f   ("f",   {nlevs,ncols}, {"lev","ncol"}, nparts, 1, DataAccess::Copy);
+  Field lat ("lat", {ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  Field area("area",{ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  for (int i = 0; i < nparts; ++i) {
+    f.set_part_extent(i, part_size);
+    lat.set_part_extent(i, part_size);
+    area.set_part_extent(i, part_size);
+  }
+  f.commit();
+  lat.commit();
+  area.commit();
+
+  std::vector<Real> fdata(part_size*nlevs), lat_data(part_size), area_data(part_size);
+  for (int i = 0; i < nparts; ++i) {
+    std::iota(fdata.begin(),fdata.end(),rank*nlevs*ncols + i*nlevs*part_size);
+    for (int icol=0; icol<part_size; ++icol) {
+      lat_data[icol] = (icol % 2)==0 ? -0.5 : 0.5;
+      area_data[icol] = 1 + icol;
+    }
+    f.copy_part_data(i, fdata.data());
+    lat.copy_part_data(i, lat_data.data());
+    area.copy_part_data(i, area_data.data());
+  }
+
+  // Create identical sets of stats: one will be computed one stat at a time,
+  // the others will batch all reductions together (blocking and non-blocking)
+  auto create_stats = [&] () {
+    auto& factory = StatFactory::instance();
+    std::vector<std::shared_ptr<FieldStat>> stats;
+    for (std::string type : {"global_max", "global_min", "global_sum", "global_avg",
+                             "max_along_columns", "min_along_columns",
+                             "sum_along_columns", "avg_along_columns"}) {
+      ekat::ParameterList pl(type);
+      stats.push_back(factory.create(type,comm,pl));
+    }
+    ekat::ParameterList zm_pl("zonal_mean");
+    zm_pl.set<std::vector<Real>>("Latitude Bounds", {0.0, 1.0});
+    stats.push_back(factory.create("zonal_mean",comm,zm_pl));
+
+    ekat::ParameterList pipe_pl ("pipe");
+    pipe_pl.sublist("outer").set<std::string>("type","global_max");
+    pipe_pl.sublist("inner").set<std::string>("type","vertical_contraction");
+    pipe_pl.sublist("inner").set<std::vector<int>>("level_bounds",{0,nlevs-1});
+    stats.push_back(factory.create("pipe",comm,pipe_pl));
+
+    for (auto& s : stats) {
+      s->set_field(f);
+      if (s->get_aux_fields_names().size()>0) {
+        s->set_aux_fields(lat,area);
+      }
+      s->create_stat_field();
+    }
+    return stats;
+  };
+
+  auto single_stats = create_stats();
+  auto batch_stats  = create_stats();
+  auto async_stats  = create_stats();
+
+  ReductionBatch batch;
+  for (auto& s : batch_stats) {
+    s->compute_local(time,batch);
+  }
+
+  // All stats have Real data type, and we only have SUM, MAX, MIN ops,
+  // except for the number of columns in the avg stats
+  REQUIRE (batch.num_collectives()==4);
+  batch.reduce(comm);
+  for (auto& s : batch_stats) {
+    s->finalize_compute();
+  }
+
+  // Non-blocking reductions must give the same results
+  for (auto& s : async_stats) {
+    s->compute_local(time,batch);
+  }
+  batch.post(comm);
+  batch.wait();
+  for (auto& s : async_stats) {
+    s->finalize_compute();
+  }
+
+  for (size_t i=0; i<single_stats.size(); ++i) {
+    auto single = single_stats[i]->compute(time);
+    const auto& batched = batch_stats[i]->get_stat_field();
+    const auto& async   = async_stats[i]->get_stat_field();
+    REQUIRE (single.layout()==batched.layout());
+    REQUIRE (single.layout()==async.layout());
+    const int n = single.layout().size();
+    for (int j=0; j<n; ++j) {
+      REQUIRE (single.data<Real>()[j]==batched.data<Real>()[j]);
+      REQUIRE (single.data<Real>()[j]==async.data<Real>()[j]);
+    }
+  }
+}
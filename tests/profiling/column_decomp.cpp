@@ -0,0 +1,68 @@
+#include <catch2/catch.hpp>
+
+#include "profiling/cldera_column_decomp.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <algorithm>
+
+TEST_CASE ("column_decomp") {
+  using namespace cldera;
+  namespace pnc = io::pnetcdf;
+
+  const ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  // Columns are dealt cyclically, and split in two parts on each rank.
+  // Like in E3SM, gids start from 1.
+  constexpr int ngcols = 12;
+  std::vector<int> gids;
+  for (int gid=rank; gid<ngcols; gid+=size) {
+    gids.push_back(gid+1);
+  }
+  const int ncols = gids.size();
+  const int nparts = std::min(2,ncols);
+  Field col_gids("col_gids",{ncols},{"ncol"},nparts,0,DataAccess::View,IntType);
+  for (int p=0,beg=0; p<nparts; ++p) {
+    const int end = (p+1)*ncols/nparts;
+    col_gids.set_part_extent(p,end-beg);
+    col_gids.set_part_data(p,gids.data()+beg);
+    beg = end;
+  }
+  col_gids.commit();
+
+  auto decomp = ColumnDecomp::get(comm,col_gids);
+  REQUIRE (decomp->min_gid()==1);
+  REQUIRE (decomp->num_global_cols()==ngcols);
+  REQUIRE (static_cast<int>(decomp->offsets().size())==ncols);
+  for (int i=0; i<ncols; ++i) {
+    REQUIRE (decomp->offsets()[i]==gids[i]-1);
+  }
+
+  // As long as it is alive, the same decomp is returned
+  REQUIRE (ColumnDecomp::get(comm,col_gids)==decomp);
+
+  // Attach the same decomp to several files, both for writing and reading
+  std::vector<double> data(ncols);
+  for (int i=0; i<ncols; ++i) {
+    data[i] = 10*gids[i];
+  }
+  for (const std::string suffix : {"a","b"}) {
+    const std::string fname = "column_decomp_" + suffix + "_np" + std::to_string(size) + ".nc";
+    auto file = pnc::open_file(fname,comm,pnc::IOMode::Write);
+    pnc::add_dim(*file,"ncol",ncols,true);
+    pnc::add_var(*file,"x","double",{"ncol"},false);
+    pnc::enddef(*file);
+    decomp->attach(*file);
+    pnc::write_var(*file,"x",data.data());
+    pnc::close_file(*file);
+
+    file = pnc::open_file(fname,comm,pnc::IOMode::Read);
+    decomp->attach(*file);
+    std::vector<double> read_data(ncols);
+    pnc::read_var(*file,"x",read_data.data());
+    pnc::close_file(*file);
+    REQUIRE (read_data==data);
+  }
+}
@@ -299,5 +299,74 @@ TEST_CASE ("stats_tests") {
       for (int i = 0; i < dim0*dim1; ++i)
         REQUIRE (zonal_mean_expected[i]==zonal_mean_field.data<Real>()[i]);
     }
+
+    // Test lat binned mean (with and without lon bins)
+    SECTION ("lat_binned_mean") {
+      Field area("area", {dim2}, {"ncol"}, nparts, 0);
+      const Real area_data[] = {0.5, 1.0, 1.5, 2.0};
+      for (int i = 0; i < nparts; ++i) {
+        area.set_part_extent(i, part_size);
+        area.set_part_data(i, &area_data[part_size*i]);
+      }
+      area.commit();
+
+      // Value of foo at column icol and (flattened) lev/dim index k
+      auto foo_val = [&](const int icol, const int k) {
+        return foo_data[icol / part_size][k*part_size + icol % part_size];
+      };
+
+      auto& factory = StatFactory::instance();
+      auto pl = ekat::ParameterList("lat_binned_mean");
+      pl.set<std::vector<Real>>("Latitude Bin Edges", {-1.0, 0.0, 0.0});
+      REQUIRE_THROWS(factory.create("lat_binned_mean",comm,pl)); // Edges not increasing
+
+      // An empty bin is set to the mask value
+      auto empty_bin_pl = pl;
+      empty_bin_pl.set<std::vector<Real>>("Latitude Bin Edges", {-1.0, 0.0, 1.0, 2.0});
+      empty_bin_pl.set("Mask Value",-999.0);
+      auto empty_bin_stat = factory.create("lat_binned_mean",comm,empty_bin_pl);
+      empty_bin_stat->set_field(foo);
+      empty_bin_stat->set_aux_fields(lat, area);
+      empty_bin_stat->create_stat_field();
+      const auto empty_bin_field = empty_bin_stat->compute(time);
+
+      // Columns 0,3 are in the first bin, columns 1,2 in the second
+      pl.set<std::vector<Real>>("Latitude Bin Edges", {-1.0, 0.0, 1.0});
+      auto lat_stat = factory.create("lat_binned_mean",comm,pl);
+      lat_stat->set_field(foo);
+      REQUIRE_THROWS(lat_stat->set_aux_fields(dum_lat, area)); // dum_lat wrong name
+      lat_stat->set_aux_fields(lat, area);
+      lat_stat->create_stat_field();
+      const auto& lat_layout = lat_stat->get_stat_field().layout();
+      REQUIRE (lat_layout.names()==std::vector<std::string>{"lat_bin","lev","dim"});
+      REQUIRE (lat_layout.dims()==std::vector<int>{2,dim0,dim1});
+      const auto lat_field = lat_stat->compute(time);
+      for (int k = 0; k < dim0*dim1; ++k) {
+        const Real south = (foo_val(0,k)*area_data[0] + foo_val(3,k)*area_data[3]) / (area_data[0]+area_data[3]);
+        const Real north = (foo_val(1,k)*area_data[1] + foo_val(2,k)*area_data[2]) / (area_data[1]+area_data[2]);
+        REQUIRE (lat_field.data<Real>()[k]==south);
+        REQUIRE (lat_field.data<Real>()[dim0*dim1+k]==north);
+        REQUIRE (empty_bin_field.data<Real>()[k]==south);
+        REQUIRE (empty_bin_field.data<Real>()[dim0*dim1+k]==north);
+        REQUIRE (empty_bin_field.data<Real>()[2*dim0*dim1+k]==-999.0);
+      }
+
+      // With lon bins too, each bin contains exactly one column
+      pl.set<std::vector<Real>>("Longitude Bin Edges", {-1.0, 0.0, 1.0});
+      auto latlon_stat = factory.create("lat_binned_mean",comm,pl);
+      latlon_stat->set_field(foo);
+      REQUIRE_THROWS(latlon_stat->set_aux_fields(lat, area)); // lon missing
+      latlon_stat->set_aux_fields(lat, lon, area);
+      latlon_stat->create_stat_field();
+      REQUIRE (latlon_stat->get_stat_field().layout().dims()==std::vector<int>{2,2,dim0,dim1});
+      const auto latlon_field = latlon_stat->compute(time);
+      const int bin_col[] = {0, 3, 1, 2};
+      for (int b = 0; b < 4; ++b) {
+        const int icol = bin_col[b];
+        for (int k = 0; k < dim0*dim1; ++k) {
+          REQUIRE (latlon_field.data<Real>()[b*dim0*dim1+k]==(foo_val(icol,k)*area_data[icol])/area_data[icol]);
+        }
+      }
+    }
   }
 }
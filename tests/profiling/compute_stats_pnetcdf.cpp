@@ -6,7 +6,10 @@
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <numeric>
 
 TEST_CASE ("stats - pnetcdf") {
   using namespace cldera;
@@ -162,3 +165,109 @@ TEST_CASE ("stats - pnetcdf") {
   //const auto pnetcdf_comparison_field = pnetcdf_reference_stat->compute(foo);
 
 }
+
+TEST_CASE ("stats - pnetcdf_reference") {
+  // Write a small reference file, with one slice every two steps, and check
+  // that the stat uses the right slice (or interpolates between two slices)
+  // at every step, including past the last slice in the file.
+  using namespace cldera;
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  constexpr int ngcols = 8;
+  constexpr int nlevs = 2;
+  constexpr int ntime = 4;
+  constexpr int ratio = 2;
+
+  const int beg = rank*ngcols/size;
+  const int ncols = (rank+1)*ngcols/size - beg;
+  std::vector<int> my_cols(ncols);
+  std::iota(my_cols.begin(),my_cols.end(),beg);
+
+  // Reference data: 10*t + lev + gid/100. Deviation is 1 everywhere.
+  auto base = [&](const int k, const int i) {
+    return k + (beg+i)/100.0;
+  };
+  const std::string fname = "pnetcdf_reference_np" + std::to_string(size) + ".nc";
+  {
+    using namespace io::pnetcdf;
+    auto file = open_file (fname,comm,IOMode::Write);
+    add_time (*file,"double");
+    add_dim (*file,"lev",nlevs);
+    add_dim (*file,"ncol",ncols,true);
+    add_var (*file,"Tref","float",{"lev","ncol"},true);
+    add_var (*file,"Tdev","float",{"lev","ncol"},true);
+    enddef (*file);
+    add_decomp (*file,"ncol",my_cols);
+    std::vector<float> ref(nlevs*ncols), dev(nlevs*ncols,1);
+    for (int t=0; t<ntime; ++t) {
+      for (int k=0; k<nlevs; ++k) {
+        for (int i=0; i<ncols; ++i) {
+          ref[k*ncols+i] = 10*t + base(k,i);
+        }
+      }
+      update_time (*file,double(t));
+      write_var (*file,"Tref",ref.data());
+      write_var (*file,"Tdev",dev.data());
+    }
+    close_file (*file);
+  }
+
+  // Geometry, all inside the lat/lon box, and a zero field
+  std::vector<Real> latlon(ncols,0.5);
+  std::vector<int>  gids(ncols);
+  std::vector<Real> T(nlevs*ncols,0);
+  std::iota(gids.begin(),gids.end(),beg+1);
+  auto lat = std::make_shared<Field>("lat",std::vector<int>{ncols},std::vector<std::string>{"ncol"},1,0);
+  auto lon = std::make_shared<Field>("lon",std::vector<int>{ncols},std::vector<std::string>{"ncol"},1,0);
+  auto col_gids = std::make_shared<Field>("col_gids",std::vector<int>{ncols},std::vector<std::string>{"ncol"},
+                                          1,0,DataAccess::View,IntType);
+  Field foo("foo",{nlevs,ncols},{"lev","ncol"},1,1);
+  for (auto f : {lat,lon}) {
+    f->set_part_extent(0,ncols);
+    f->set_part_data(0,latlon.data());
+    f->commit();
+  }
+  col_gids->set_part_extent(0,ncols);
+  col_gids->set_part_data(0,gids.data());
+  col_gids->commit();
+  foo.set_part_extent(0,ncols);
+  foo.set_part_data(0,T.data());
+  foo.commit();
+
+  // Two reference stats (with and without interpolation) on the same field,
+  // computed at the same steps, so that their reads (and prefetches) overlap
+  std::vector<std::unique_ptr<FieldPnetcdfReference>> stats;
+  for (const bool interp : {false, true}) {
+    ekat::ParameterList pl(interp ? "ref_interp" : "ref");
+    pl.set<std::vector<Real>>("Latitude Bounds",{0.0,1.0});
+    pl.set<std::vector<Real>>("Longitude Bounds",{0.0,1.0});
+    pl.set<std::string>("Pnetcdf Filename",fname);
+    pl.set<std::string>("Reference Field Name","Tref");
+    pl.set<std::string>("Reference Deviation Field Name","Tdev");
+    pl.set("Time Step Ratio",ratio);
+    pl.set("Time Interpolation",interp);
+
+    stats.emplace_back(new FieldPnetcdfReference(comm,pl));
+    stats.back()->initialize(lat,lon,col_gids);
+    stats.back()->set_field(foo);
+    stats.back()->create_stat_field();
+  }
+
+  for (int step=1; step<=2*ratio*ntime; ++step) {
+    for (const bool interp : {false, true}) {
+      const auto& out = stats[interp ? 1 : 0]->compute(TimeStamp());
+      const auto data = out.data<Real>();
+      const double tref = interp ? 10.0*std::min(step,ratio*(ntime-1))/ratio
+                                 : 10.0*std::min(step/ratio,ntime-1);
+      for (int k=0; k<nlevs; ++k) {
+        for (int i=0; i<ncols; ++i) {
+          const double ref = tref + base(k,i);
+          REQUIRE (data[k*ncols+i]==Approx(ref*ref).epsilon(1e-5));
+        }
+      }
+    }
+  }
+}
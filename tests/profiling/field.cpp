@@ -1,4 +1,5 @@
 #include "profiling/cldera_field.hpp"
+#include "profiling/cldera_field_arena.hpp"
 
 #include <catch2/catch.hpp>
 
@@ -37,6 +38,7 @@ TEST_CASE ("field") {
     REQUIRE_THROWS (foo.set_data(foo_data.data())); // Data already set
     REQUIRE_THROWS (baz.set_part_extent(3,1)); // part idx OOB
     REQUIRE_THROWS (baz.set_part_extent(1,10)); // part size OOB
+    REQUIRE_THROWS (baz.set_part_extent(1,-1)); // part size must be non-negative
     REQUIRE_THROWS (foobar.set_part_data<Real>(0,foo_data.data())); // Not a View field
     REQUIRE_THROWS (bar.set_data<int>(nullptr)); // Invalid pointer
     REQUIRE_THROWS (bar.set_data(foo_data.data())); // Invalid data type
@@ -172,6 +174,36 @@ TEST_CASE ("field") {
     }
   }
 
+  // A part with no columns (e.g., an empty host chunk) is valid
+  SECTION ("empty_part") {
+    constexpr int ncols = 3;
+    constexpr int nlevs = 2;
+
+    std::vector<Real> v_data (ncols*nlevs);
+    std::iota(v_data.begin(),v_data.end(),0.0);
+
+    Field v("v",{ncols,nlevs},{"ncol","lev"},2,0);
+    v.set_part_extent(0,ncols);
+    v.set_part_extent(1,0);
+    v.set_part_data(0,v_data.data());
+    v.set_part_data(1,v_data.data());
+    v.commit();
+
+    Field c("c",{ncols,nlevs},{"ncol","lev"},2,0,DataAccess::Copy);
+    c.set_part_extent(0,0);
+    c.set_part_extent(1,ncols);
+    c.commit();
+    c.copy_part_data(1,v_data.data());
+
+    REQUIRE (v.part_layout(1).size()==0);
+    REQUIRE (v.part_view<Real>(1).size()==0);
+    REQUIRE (c.part_layout(0).size()==0);
+    REQUIRE (c.part_offset(1)==0);
+    for (int i=0; i<ncols*nlevs; ++i) {
+      REQUIRE (c.part_data<Real>(1)[i]==v.part_data<Real>(0)[i]);
+    }
+  }
+
   SECTION ("update") {
     constexpr int ncols = 3;
     constexpr int nlevs = 4;
@@ -241,4 +273,46 @@ TEST_CASE ("field") {
     yr.update(xr,1,1);
     REQUIRE (check(yr,xr,3));
   }
+
+  SECTION ("arena") {
+    constexpr int ncols = 5;
+    constexpr int nlevs = 4;
+
+    FieldArena arena(256);
+
+    // Parts and fields from the same pool are back-to-back
+    Field a("a",{nlevs,ncols},{"lev","col"},2,1,DataAccess::Copy,DataType::RealType);
+    a.set_part_extent(0,2);
+    a.set_part_extent(1,3);
+    Field b("b",{nlevs},{"lev"},DataAccess::Copy,DataType::RealType);
+    a.commit(arena,"real");
+    b.commit(arena,"real");
+    REQUIRE (a.part_data<Real>(1)==a.part_data<Real>(0)+2*nlevs);
+    REQUIRE (b.data<Real>()==a.part_data<Real>(1)+3*nlevs);
+
+    // Different pools use different slabs, and a new slab is
+    // started when a chunk does not fit in the current one
+    Field c("c",{ncols},{"col"},DataAccess::Copy,DataType::IntType);
+    Field d("d",{2*ncols},{"col"},DataAccess::Copy,DataType::RealType);
+    c.commit(arena,"int");
+    d.commit(arena,"real");
+    REQUIRE (arena.num_slabs()==3);
+    REQUIRE (arena.size()==(nlevs*ncols+nlevs+2*ncols)*sizeof(Real)+ncols*sizeof(int));
+
+    // Fields do not overlap
+    Kokkos::deep_copy(a.part_view_nonconst<Real>(0),1.0);
+    Kokkos::deep_copy(a.part_view_nonconst<Real>(1),2.0);
+    b.deep_copy(3.0);
+    d.deep_copy(4.0);
+    REQUIRE (a.part_data<Real>(0)[2*nlevs-1]==1.0);
+    REQUIRE (a.part_data<Real>(1)[3*nlevs-1]==2.0);
+    REQUIRE (b.data<Real>()[nlevs-1]==3.0);
+
+    // View fields do not use the arena
+    std::vector<Real> e_data(ncols);
+    Field e("e",{ncols},{"col"},DataAccess::View,DataType::RealType);
+    e.set_part_data(0,e_data.data());
+    e.commit(arena,"real");
+    REQUIRE (e.data<Real>()==e_data.data());
+  }
 }
@@ -0,0 +1,179 @@
+#include "profiling/stats/cldera_fused_field_stats.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/cldera_reduction_batch.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+TEST_CASE ("fused_stats") {
+  using namespace cldera;
+
+  register_stats();
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Field dimensions: parts of 16 columns, like EAM physics chunks
+  constexpr int ncols = 2048;
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  constexpr int nparts = ncols / pcols;
+  constexpr int nregions = 7;
+
+  // Integer values (see below for the values of f)
+  auto create_field = [&](const std::string& name, const std::vector<int>& dims,
+                          const std::vector<std::string>& names, const DataType dt) {
+    Field f(name,dims,names,nparts,0,DataAccess::Copy,dt);
+    for (int p=0; p<nparts; ++p) {
+      f.set_part_extent(p,pcols);
+    }
+    f.commit();
+    for (int p=0; p<nparts; ++p) {
+      const int n = f.part_layout(p).size();
+      const int offset = p*n;
+      if (dt==DataType::IntType) {
+        auto data = f.part_data_nonconst<int>(p);
+        for (int i=0; i<n; ++i) {
+          data[i] = (offset+i) % 97 - 3*rank;
+        }
+      } else {
+        auto data = f.part_data_nonconst<Real>(p);
+        for (int i=0; i<n; ++i) {
+          data[i] = (offset+i) % 89 - 2*rank;
+        }
+      }
+    }
+    return f;
+  };
+
+  Field f  = create_field("f",{ncols,nlevs},{"ncol","lev"},DataType::RealType);
+  Field fi = create_field("fi",{ncols,nlevs},{"ncol","lev"},DataType::IntType);
+
+  // Values of f are not integers, so that sums depend on the order of operations:
+  // fused sums must add the entries in the same way as the single stats do
+  for (int p=0; p<nparts; ++p) {
+    const int n = f.part_layout(p).size();
+    auto data = f.part_data_nonconst<Real>(p);
+    for (int i=0; i<n; ++i) {
+      data[i] = std::sin(p*n + i + rank) * 1000 / 7;
+    }
+  }
+  Field lat  = create_field("lat",{ncols},{"ncol"},DataType::RealType);
+  Field area = create_field("area",{ncols},{"ncol"},DataType::RealType);
+  for (int p=0; p<nparts; ++p) {
+    auto a = area.part_data_nonconst<Real>(p);
+    for (int i=0; i<pcols; ++i) {
+      a[i] = 1 + (p*pcols+i) % 3;
+    }
+  }
+
+  Field mask    ("mask",    FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  Field col_gids("col_gids",FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  mask.commit();
+  col_gids.commit();
+  for (int icol=0; icol<ncols; ++icol) {
+    mask.data_nonconst<int>()[icol] = icol % nregions;
+    col_gids.data_nonconst<int>()[icol] = rank*ncols + icol + 1;
+  }
+
+  // Create the same stats twice: one set is computed one stat at a time,
+  // the other with a single traversal of the field
+  auto create_stats = [&](const Field& field, const bool real_only) {
+    auto& factory = StatFactory::instance();
+    std::vector<std::string> types = {"global_max", "global_min", "global_sum",
+                                      "max_along_columns", "min_along_columns",
+                                      "sum_along_columns"};
+    if (real_only) {
+      for (std::string type : {"global_avg", "avg_along_columns", "zonal_mean"}) {
+        types.push_back(type);
+      }
+    }
+    std::vector<std::shared_ptr<FieldStat>> stats;
+    for (const auto& type : types) {
+      ekat::ParameterList pl(type);
+      if (type=="zonal_mean") {
+        pl.set<std::vector<Real>>("Latitude Bounds", {0.0, 50.0});
+      }
+      stats.push_back(factory.create(type,comm,pl));
+    }
+    ekat::ParameterList mi_pl("masked_integral");
+    mi_pl.set<std::string>("mask_field","mask");
+    mi_pl.set("average",false);
+    stats.push_back(factory.create("masked_integral",comm,mi_pl));
+    if (real_only) {
+      ekat::ParameterList wmi_pl("weighted_masked_integral");
+      wmi_pl.set<std::string>("mask_field","mask");
+      wmi_pl.set<std::string>("weight_field","area");
+      wmi_pl.set("average",false);
+      stats.push_back(factory.create("masked_integral",comm,wmi_pl));
+    }
+
+    std::map<std::string,Field> aux = {
+      {"lat",lat}, {"area",area}, {"mask",mask}, {"col_gids",col_gids}
+    };
+    for (auto& s : stats) {
+      s->set_field(field);
+      s->set_aux_fields(aux);
+      s->create_stat_field();
+    }
+    return stats;
+  };
+
+  for (const auto& field : {f,fi}) {
+    const bool real_only = field.data_type()==DataType::RealType;
+    auto single_stats = create_stats(field,real_only);
+    auto fused_stats  = create_stats(field,real_only);
+
+    FusedFieldStats fused(field);
+    for (auto& s : fused_stats) {
+      if (fused.can_fuse(*s)) {
+        fused.add_stat(s);
+      } else {
+        // Only zonal mean cannot be fused
+        REQUIRE (s->type()=="zonal_mean");
+      }
+    }
+    REQUIRE (fused.num_stats()==static_cast<int>(fused_stats.size()) - (real_only ? 1 : 0));
+
+    // A stat on a different field cannot be fused
+    REQUIRE (not fused.can_fuse(*create_stats(field.name()=="f" ? fi : f,false)[0]));
+
+    ReductionBatch batch;
+    fused.compute_local(time,batch);
+    batch.reduce(comm);
+    for (auto& s : fused.get_stats()) {
+      s->finalize_compute();
+    }
+
+    for (size_t i=0; i<single_stats.size(); ++i) {
+      if (not fused.can_fuse(*single_stats[i])) {
+        continue;
+      }
+      const auto& single = single_stats[i]->compute(time);
+      const auto& fstat  = fused_stats[i]->get_stat_field();
+      REQUIRE (single.layout()==fstat.layout());
+      REQUIRE (single.data_type()==fstat.data_type());
+      const int n = single.layout().size();
+      for (int j=0; j<n; ++j) {
+        if (single.data_type()==DataType::IntType) {
+          REQUIRE (single.data<int>()[j]==fstat.data<int>()[j]);
+        } else if (single_stats[i]->type()=="masked_integral" or comm.size()>2) {
+          // Single masked integrals add the entries in region-sorted order.
+          // Also, with more than two ranks, MPI may add the contributions of
+          // the ranks in an order that depends on how many values are reduced
+          // at once. In these cases, results only agree up to rounding
+          REQUIRE (single.data<Real>()[j]==Approx(fstat.data<Real>()[j]).epsilon(1e-12).margin(1e-9));
+        } else {
+          REQUIRE (single.data<Real>()[j]==fstat.data<Real>()[j]);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,152 @@
+#include "profiling/cldera_profiling_interface.hpp"
+#include "profiling/cldera_profiling_types.hpp"
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Synthetic driver for in-transit analysis ranks. The last ranks of
+// MPI_COMM_WORLD compute the stats, while the others run a fake model,
+// which only updates its fields at every step. The stats do not depend
+// on the number of ranks, and are checked with ncdump (see CMakeLists.txt).
+
+int main (int argc, char** argv)
+{
+  using namespace cldera;
+
+  MPI_Init(&argc,&argv);
+
+  int size, rank;
+  MPI_Comm_size(MPI_COMM_WORLD,&size);
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+  const int num_in_transit = size==1 ? 0 : std::max(1,size/4);
+  const std::string name = "in_transit_np" + std::to_string(size);
+
+  constexpr int ncols = 24;
+  constexpr int nlevs = 4;
+  constexpr int nsteps = 3;
+
+  if (rank==0) {
+    // Tests with different number of ranks may run at the same time, so write
+    // the (identical) session file in a tmp file, and atomically move it
+    const std::string tmp = name + ".cldera_profiling_config.yaml";
+    std::ofstream session(tmp);
+    for (int np=1; np<=128; ++np) {
+      session << "in_transit_np" << np << ": in_transit_np" << np << ".yaml\n";
+    }
+    session.close();
+    std::rename(tmp.c_str(),"cldera_profiling_config.yaml");
+
+    std::ofstream params(name + ".yaml");
+    params << "%YAML 1.0\n"
+              "---\n"
+              "Timing Filename: " << name << "_timings.txt\n"
+              "In-Transit Ranks: " << num_in_transit << "\n"
+              "Profiling Output:\n"
+              "  filename_prefix: " << name << "\n"
+              "Fields To Track: [T]\n"
+              "T:\n"
+              "  Compute Stats: [T_gmax, T_gsum, T_zmean]\n"
+              "  T_gmax:\n"
+              "    type: global_max\n"
+              "  T_gsum:\n"
+              "    type: global_sum\n"
+              "  T_zmean:\n"
+              "    type: zonal_mean\n"
+              "    Latitude Bounds: [-1.0, 1.0]\n"
+              "...\n";
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  const char* context_name = name.c_str();
+  const int ymd = 20220915;
+  const int tod = 43000;
+  cldera_init_c(context_name,MPI_Comm_c2f(MPI_COMM_WORLD),ymd,tod,ymd,tod,ymd,tod+nsteps*1800);
+
+  // On in-transit ranks, all the work was done inside cldera_init_c
+  MPI_Fint model_fcomm;
+  cldera_get_model_comm_c(model_fcomm);
+  MPI_Comm model_comm = MPI_Comm_f2c(model_fcomm);
+  if (model_comm!=MPI_COMM_NULL) {
+    int model_size, model_rank;
+    MPI_Comm_size(model_comm,&model_size);
+    MPI_Comm_rank(model_comm,&model_rank);
+
+    // Columns are split in contiguous blocks across model ranks, and each
+    // block in (up to) two chunks, padded to pcols, like in E3SM
+    const int beg = model_rank*ncols/model_size;
+    const int my_ncols = (model_rank+1)*ncols/model_size - beg;
+    const int nparts = std::min(2,my_ncols);
+    const int pcols = ncols;
+    std::vector<int> part_beg(nparts+1);
+    for (int p=0; p<=nparts; ++p) {
+      part_beg[p] = beg + p*my_ncols/nparts;
+    }
+
+    std::vector<std::vector<Real>> T(nparts,std::vector<Real>(nlevs*pcols));
+    std::vector<std::vector<Real>> lat(nparts,std::vector<Real>(pcols,0));
+    std::vector<std::vector<Real>> area(nparts,std::vector<Real>(pcols,1));
+    std::vector<std::vector<int>>  gids(nparts,std::vector<int>(pcols));
+
+    const char* real = "real";
+    const char* integer = "int";
+    const char* lev_name = "lev";
+    const char* col_name = "ncol";
+    const char* dimnames_3d[2] = {lev_name,col_name};
+    const char* dimnames_2d[1] = {col_name};
+    const int dims_3d[2] = {nlevs,my_ncols};
+    const int dims_2d[1] = {my_ncols};
+    for (const std::string fname : {"T","lat","area","col_gids"}) {
+      const char* n = fname.c_str();
+      const bool is_3d = fname=="T";
+      const char*& dtype = fname=="col_gids" ? integer : real;
+      cldera_add_partitioned_field_c(n,is_3d ? 2 : 1,is_3d ? dims_3d : dims_2d,
+                                     is_3d ? dimnames_3d : dimnames_2d,
+                                     nparts,is_3d ? 1 : 0,pcols,true,dtype);
+      for (int p=0; p<nparts; ++p) {
+        cldera_set_field_part_extent_c(n,p,part_beg[p+1]-part_beg[p]);
+        const void* data;
+        if (fname=="T") {
+          data = T[p].data();
+        } else if (fname=="lat") {
+          data = lat[p].data();
+        } else if (fname=="area") {
+          data = area[p].data();
+        } else {
+          for (int i=0; i<pcols; ++i) {
+            gids[p][i] = part_beg[p] + i + 1;
+          }
+          data = gids[p].data();
+        }
+        cldera_set_field_part_data_c(n,p,data,dtype);
+      }
+    }
+    cldera_commit_all_fields_c();
+
+    // E3SM calls this at run_t0 too, but no stats are computed
+    cldera_compute_stats_c(ymd,tod);
+    for (int step=0; step<nsteps; ++step) {
+      for (int p=0; p<nparts; ++p) {
+        for (int lev=0; lev<nlevs; ++lev) {
+          for (int i=0; i<part_beg[p+1]-part_beg[p]; ++i) {
+            T[p][lev*pcols+i] = step*1000 + (part_beg[p]+i)*nlevs + lev;
+          }
+        }
+      }
+      cldera_compute_stats_c(ymd,tod+(step+1)*1800);
+    }
+
+    cldera_clean_up_c();
+    if (model_comm!=MPI_COMM_WORLD) {
+      MPI_Comm_free(&model_comm);
+    }
+  }
+
+  MPI_Finalize();
+  return 0;
+}
@@ -7,6 +7,7 @@
 #include <catch2/catch.hpp>
 
 #include <map>
+#include <numeric>
 
 TEST_CASE ("masked_integral") {
   using namespace cldera;
@@ -318,3 +319,95 @@ TEST_CASE ("masked_integral") {
   io::pnetcdf::update_time(*ofile,1.0);
   io::pnetcdf::close_file(*ofile);
 }
+
+TEST_CASE ("masked_integral_tiled_mask") {
+  using namespace cldera;
+
+  register_stats ();
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Read the whole ne4pg2 mask on all ranks
+  std::string mask_filename = "../../data/ipcc_mask_ne4pg2.nc";
+  auto mask_file = io::pnetcdf::open_file(mask_filename,comm,io::pnetcdf::IOMode::Read);
+  const int ne4_ncols = mask_file->dims.at("ncol")->len;
+  std::vector<int> all_cols(ne4_ncols);
+  std::iota(all_cols.begin(),all_cols.end(),0);
+  io::pnetcdf::add_decomp(*mask_file,"ncol",all_cols);
+  std::vector<int> ne4_mask(ne4_ncols);
+  io::pnetcdf::read_var(*mask_file,"mask",ne4_mask.data());
+  io::pnetcdf::close_file(*mask_file);
+
+  // Tile the mask to ne120pg2 sizes, distributed over the ranks in
+  // parts of 16 columns, like EAM physics chunks
+  constexpr int ne120_ncols = 6*120*120*4;
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  const int my_ncols = (ne120_ncols / comm.size() / pcols) * pcols;
+  const int nparts = my_ncols / pcols;
+
+  Field mask    ("mask",    FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  Field col_gids("col_gids",FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  mask.commit();
+  col_gids.commit();
+  for (int icol=0; icol<my_ncols; ++icol) {
+    const int gid = comm.rank()*my_ncols + icol;
+    col_gids.data_nonconst<int>()[icol] = gid + 1;
+    mask.data_nonconst<int>()[icol] = ne4_mask[gid % ne4_ncols];
+  }
+
+  // Integer values, so that sums do not depend on the order of operations
+  Field f("f",{my_ncols,nlevs},{"ncol","lev"},nparts,0,DataAccess::Copy);
+  for (int p=0; p<nparts; ++p) {
+    f.set_part_extent(p,pcols);
+  }
+  f.commit();
+  for (int p=0; p<nparts; ++p) {
+    auto v = f.part_nd_view_nonconst<Real,2>(p);
+    for (int i=0; i<pcols; ++i) {
+      for (int k=0; k<nlevs; ++k) {
+        v(i,k) = (p*pcols + i + k) % 7;
+      }
+    }
+  }
+
+  ekat::ParameterList pl("masked_integral");
+  pl.set<std::string>("mask_field","mask");
+  pl.set("average",false);
+  auto stat = StatFactory::instance().create("masked_integral",comm,pl);
+  stat->set_field(f);
+  stat->set_aux_fields({{"mask",mask},{"col_gids",col_gids}});
+  stat->create_stat_field();
+
+  // Reference: look up the region of each column in a map, one column at a time
+  std::map<int,int> mask_val_to_idx;
+  for (auto v : ne4_mask) {
+    mask_val_to_idx[v] = 0;
+  }
+  int num_regions = 0;
+  for (auto& it : mask_val_to_idx) {
+    it.second = num_regions++;
+  }
+  std::vector<Real> ref(num_regions*nlevs,0);
+  for (int p=0; p<nparts; ++p) {
+    auto v = f.part_nd_view<Real,2>(p);
+    for (int i=0; i<pcols; ++i) {
+      const int r = mask_val_to_idx.at(mask.data<int>()[p*pcols+i]);
+      for (int k=0; k<nlevs; ++k) {
+        ref[r*nlevs+k] += v(i,k);
+      }
+    }
+  }
+  comm.all_reduce(ref.data(),ref.size(),MPI_SUM);
+
+  // Check results
+  const auto& out = stat->compute(time);
+  REQUIRE (out.layout().size()==num_regions*nlevs);
+  for (int j=0; j<num_regions*nlevs; ++j) {
+    REQUIRE (out.data<Real>()[j]==ref[j]);
+  }
+}
@@ -1,5 +1,7 @@
 #include "profiling/stats/cldera_field_stat.hpp"
 #include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/stats/cldera_field_stat_pipe.hpp"
+#include "profiling/stats/cldera_shared_field_stat.hpp"
 
 #include <ekat/mpi/ekat_comm.hpp>
 
@@ -73,3 +75,79 @@ TEST_CASE ("vertical_contraction") {
   REQUIRE (stat_pipe.layout()==stat_gsum.layout());
   REQUIRE (stat_gsum.data<Real>()[0] == stat_pipe.data<Real>()[0]);
 }
+
+TEST_CASE ("shared_stats") {
+  using namespace cldera;
+
+  register_stats();
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  constexpr int nlevs = 4;
+  constexpr int ncols = 4;
+
+  Field s3d("scalar3d", {ncols,nlevs}, {"ncol","lev"}, 1, 0, DataAccess::Copy);
+  s3d.commit();
+  std::iota(s3d.data_nonconst<Real>(),s3d.data_nonconst<Real>()+ncols*nlevs,0);
+
+  // Two pipes with the same inner stage (but different names and outer stages)
+  auto& f = StatFactory::instance();
+  auto create_pipe = [&](const std::string& name, const std::string& outer,
+                         const std::vector<int>& level_bounds) {
+    ekat::ParameterList pl (name);
+    pl.sublist("outer").set<std::string>("type",outer);
+    pl.sublist("inner").set<std::string>("type","vertical_contraction");
+    pl.sublist("inner").set("level_bounds",level_bounds);
+    return std::dynamic_pointer_cast<FieldStatPipe>(f.create("pipe",comm,pl));
+  };
+
+  auto pmax = create_pipe("pmax","global_max",{1,2});
+  auto pmin = create_pipe("pmin","global_min",{1,2});
+  auto pother = create_pipe("pother","global_max",{0,2});
+  auto pmax_ref = create_pipe("pmax_ref","global_max",{1,2});
+  auto pmin_ref = create_pipe("pmin_ref","global_min",{1,2});
+
+  // Signatures do not depend on stats names, but do depend on params and field
+  const auto sig = pmax->get_inner()->signature(s3d.name());
+  REQUIRE (sig==pmin->get_inner()->signature(s3d.name()));
+  REQUIRE (sig!=pother->get_inner()->signature(s3d.name()));
+  REQUIRE (sig!=pmax->get_inner()->signature("other_field"));
+  REQUIRE (pmax->signature(s3d.name())!=pmin->signature(s3d.name()));
+  REQUIRE (pmax->signature(s3d.name())==pmax_ref->signature(s3d.name()));
+
+  // Share the inner stage between the two pipes. The shared stat must have
+  // a different name than its consumers (or their timers would clash)
+  ekat::ParameterList inner_pl ("shared_inner");
+  inner_pl.set<std::vector<int>>("level_bounds",{1,2});
+  auto inner = f.create("vertical_contraction",comm,inner_pl);
+  REQUIRE (inner->signature(s3d.name())==sig);
+
+  auto shared_max = std::make_shared<SharedFieldStat>(comm,pmax->get_inner()->get_params(),inner);
+  auto shared_min = std::make_shared<SharedFieldStat>(comm,pmin->get_inner()->get_params(),*shared_max);
+  shared_max->set_eager();
+  pmax->set_inner(shared_max);
+  pmin->set_inner(shared_min);
+  REQUIRE (shared_max->num_consumers()==2);
+
+  for (auto p : {pmax,pmin,pmax_ref,pmin_ref}) {
+    p->set_field(s3d);
+    p->create_stat_field();
+  }
+  REQUIRE_THROWS (pmax->set_inner(inner));
+
+  // Consumers alias the shared stat field
+  REQUIRE (shared_max->get_stat_field().data<Real>()==inner->get_stat_field().data<Real>());
+  REQUIRE (shared_min->get_stat_field().data<Real>()==inner->get_stat_field().data<Real>());
+  REQUIRE (shared_min->get_stat_field().name()=="pmin_inner");
+
+  for (int step=0; step<2; ++step) {
+    // Change data at every step, to make sure the shared stat is recomputed
+    s3d.data_nonconst<Real>()[step] += 100;
+    REQUIRE (pmax->compute(time).data<Real>()[0]==pmax_ref->compute(time).data<Real>()[0]);
+    REQUIRE (pmin->compute(time).data<Real>()[0]==pmin_ref->compute(time).data<Real>()[0]);
+  }
+}
@@ -0,0 +1,214 @@
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/cldera_repro_sum.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+// Deterministic value for a global index, with a wide range of magnitudes
+double value (const int gid, const int k) {
+  std::mt19937_64 engine(gid*131 + k);
+  std::uniform_real_distribution<double> pdf(-1,1);
+  return pdf(engine) * std::pow(10.0,(gid+k) % 9 - 4);
+}
+
+} // anonymous namespace
+
+TEST_CASE ("repro_sum") {
+  using namespace cldera;
+
+  constexpr int n = 10000;
+  std::vector<double> x(n);
+  for (int i=0; i<n; ++i) {
+    x[i] = value(i,0);
+  }
+
+  ReproSum ref;
+  for (auto v : x) {
+    ref += v;
+  }
+
+  // Any order, and any split in partial sums, gives the same result, bitwise
+  std::mt19937_64 engine(Catch::rngSeed());
+  for (int trial=0; trial<5; ++trial) {
+    std::shuffle(x.begin(),x.end(),engine);
+    const int nsplits = 1 + trial*7;
+    std::vector<ReproSum> partials(nsplits);
+    for (int i=0; i<n; ++i) {
+      partials[(i*7919) % nsplits] += x[i];
+    }
+    ReproSum sum;
+    for (int s=nsplits-1; s>=0; --s) {
+      sum += partials[s];
+    }
+    REQUIRE (sum.value()==ref.value());
+  }
+
+  // Cancellations are exact
+  ReproSum cancel;
+  cancel += 1e30;
+  cancel += 1.0;
+  cancel += -1e30;
+  REQUIRE (cancel.value()==1.0);
+
+  // Non-finite values propagate
+  ReproSum inf;
+  inf += 1.0;
+  inf += std::numeric_limits<double>::infinity();
+  REQUIRE (std::isinf(inf.value()));
+}
+
+TEST_CASE ("repro_stats") {
+  using namespace cldera;
+
+  // REQUIRE_THROWS causes some start_timer calls to not be matched
+  // by a corresponding stop_timer. For this test, we can just disable timings
+  timing::TimingSession::instance().toggle_session(false);
+
+  register_stats();
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+  const int rank = comm.rank();
+  const int size = comm.size();
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  constexpr int ncols = 1000;
+  constexpr int nlevs = 5;
+  constexpr int nregions = 4;
+  const Bounds<Real> lat_bounds (-30,30);
+
+  auto lat_of  = [](const int gid) { return value(gid,100)*90/std::pow(10.0,(gid+100)%9-4); };
+  auto area_of = [](const int gid) { return 1 + std::abs(value(gid,200)); };
+
+  // Serial results, using all the global columns (in gid order)
+  ReproSum gsum, zarea;
+  std::vector<ReproSum> csum(nlevs), zsum(nlevs), msum(nregions*nlevs);
+  for (int gid=0; gid<ncols; ++gid) {
+    const Real lat = lat_of(gid);
+    const Real area = area_of(gid);
+    const bool in_zone = lat_bounds.contains(lat,true,true);
+    if (lat > lat_bounds.min && lat < lat_bounds.max) {
+      zarea += area;
+    }
+    for (int k=0; k<nlevs; ++k) {
+      const Real v = value(gid,k);
+      gsum += v;
+      csum[k] += v;
+      if (in_zone) {
+        zsum[k] += v*area;
+      }
+      msum[(gid % nregions)*nlevs+k] += v*area;
+    }
+  }
+
+  // Distribute columns in two different ways, with parts of different sizes.
+  // Results must match the serial ones bitwise, for any number of ranks
+  for (const bool cyclic : {true, false}) {
+    std::vector<int> my_gids;
+    for (int gid=0; gid<ncols; ++gid) {
+      if ((cyclic and gid % size == rank) or
+          (not cyclic and gid*size/ncols == rank)) {
+        my_gids.push_back(gid);
+      }
+    }
+    const int my_ncols = my_gids.size();
+    const int pcols = cyclic ? 7 : 16;
+    const int nparts = (my_ncols + pcols - 1) / pcols;
+
+    Field f   ("f",   {my_ncols,nlevs}, {"ncol","lev"}, nparts, 0, DataAccess::Copy);
+    Field lat ("lat", {my_ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+    Field area("area",{my_ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+    for (int p=0; p<nparts; ++p) {
+      const int n = std::min(pcols,my_ncols-p*pcols);
+      for (auto fld : {&f,&lat,&area}) {
+        fld->set_part_extent(p,n);
+      }
+    }
+    for (auto fld : {&f,&lat,&area}) {
+      fld->commit();
+    }
+    for (int p=0; p<nparts; ++p) {
+      auto fv = f.part_nd_view_nonconst<Real,2>(p);
+      auto lv = lat.part_nd_view_nonconst<Real,1>(p);
+      auto av = area.part_nd_view_nonconst<Real,1>(p);
+      for (int i=0; i<f.part_layout(p).dims()[0]; ++i) {
+        const int gid = my_gids[p*pcols+i];
+        lv(i) = lat_of(gid);
+        av(i) = area_of(gid);
+        for (int k=0; k<nlevs; ++k) {
+          fv(i,k) = value(gid,k);
+        }
+      }
+    }
+
+    // Masked integral wants single-part mask, weight, and col gids
+    Field mask    ("mask",    FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+    Field col_gids("col_gids",FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+    Field weight  ("weight",  FieldLayout({my_ncols},{"ncol"}),DataAccess::Copy);
+    mask.commit();
+    col_gids.commit();
+    weight.commit();
+    for (int i=0; i<my_ncols; ++i) {
+      mask.data_nonconst<int>()[i] = my_gids[i] % nregions;
+      col_gids.data_nonconst<int>()[i] = my_gids[i] + 1;
+      weight.data_nonconst<Real>()[i] = area_of(my_gids[i]);
+    }
+
+    auto create_stat = [&](const std::string& type, ekat::ParameterList pl) {
+      pl.set("reproducible",true);
+      auto stat = StatFactory::instance().create(type,comm,pl);
+      stat->set_field(f);
+      stat->set_aux_fields(std::map<std::string,Field>{
+        {"lat",lat}, {"area",area}, {"mask",mask}, {"col_gids",col_gids}, {"weight",weight}
+      });
+      stat->create_stat_field();
+      return stat;
+    };
+
+    auto gsum_stat = create_stat("global_sum",ekat::ParameterList("gsum"));
+    auto gavg_stat = create_stat("global_avg",ekat::ParameterList("gavg"));
+    auto csum_stat = create_stat("sum_along_columns",ekat::ParameterList("csum"));
+    ekat::ParameterList zpl("zmean");
+    zpl.set("Latitude Bounds",lat_bounds.to_vector());
+    auto zmean_stat = create_stat("zonal_mean",zpl);
+    ekat::ParameterList mpl("mint");
+    mpl.set<std::string>("mask_field","mask");
+    mpl.set<std::string>("weight_field","weight");
+    mpl.set("average",false);
+    auto mint_stat = create_stat("masked_integral",mpl);
+
+    REQUIRE (gsum_stat->fused_kernel()==FusedKernel::None);
+
+    // Batch all reductions, like the profiling interface does
+    ReductionBatch batch;
+    for (auto s : {gsum_stat,gavg_stat,csum_stat,zmean_stat,mint_stat}) {
+      s->compute_local(time,batch);
+    }
+    batch.reduce(comm);
+
+    REQUIRE (gsum_stat->finalize_compute().data<Real>()[0]==gsum.value());
+    REQUIRE (gavg_stat->finalize_compute().data<Real>()[0]==gsum.value()/(ncols*nlevs));
+    const auto& cs = csum_stat->finalize_compute();
+    const auto& zm = zmean_stat->finalize_compute();
+    for (int k=0; k<nlevs; ++k) {
+      REQUIRE (cs.data<Real>()[k]==csum[k].value());
+      REQUIRE (zm.data<Real>()[k]==zsum[k].value()/zarea.value());
+    }
+    const auto& mi = mint_stat->finalize_compute().nd_view<Real,2>();
+    for (int r=0; r<nregions; ++r) {
+      for (int k=0; k<nlevs; ++k) {
+        REQUIRE (mi(r,k)==msum[r*nlevs+k].value());
+      }
+    }
+  }
+}
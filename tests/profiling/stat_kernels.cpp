@@ -0,0 +1,305 @@
+#include "profiling/stats/cldera_field_stat.hpp"
+#include "profiling/stats/cldera_register_stats.hpp"
+#include "profiling/stats/cldera_field_stat_kernels.hpp"
+
+#include <ekat/mpi/ekat_comm.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+TEST_CASE ("stat_kernels") {
+  using namespace cldera;
+
+  register_stats();
+
+  ekat::Comm comm(MPI_COMM_WORLD);
+
+  int ymd = 20220915;
+  int tod = 43000;
+  TimeStamp time(ymd,tod);
+
+  // Sizes of a ne30pg2 grid, with 72 levels, split in chunks
+  // of 16 columns, like EAM does with physics chunks
+  constexpr int ncols = 21600;
+  constexpr int nlevs = 72;
+  constexpr int pcols = 16;
+  constexpr int nparts = ncols / pcols;
+  constexpr int nregions = 10;
+
+  Field f   ("f",   {ncols,nlevs}, {"ncol","lev"}, nparts, 0, DataAccess::Copy);
+  Field lat ("lat", {ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  Field lon ("lon", {ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  Field area("area",{ncols}, {"ncol"}, nparts, 0, DataAccess::Copy);
+  for (int p=0; p<nparts; ++p) {
+    f.set_part_extent(p, pcols);
+    lat.set_part_extent(p, pcols);
+    lon.set_part_extent(p, pcols);
+    area.set_part_extent(p, pcols);
+  }
+  f.commit();
+  lat.commit();
+  lon.commit();
+  area.commit();
+
+  // Masked integral wants single-part mask and col gids
+  Field mask    ("mask",    FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  Field col_gids("col_gids",FieldLayout({ncols},{"ncol"}),DataAccess::Copy,DataType::IntType);
+  mask.commit();
+  col_gids.commit();
+
+  std::vector<Real> fdata(ncols*nlevs), lat_data(ncols), lon_data(ncols), area_data(ncols);
+  std::mt19937_64 engine(Catch::rngSeed());
+  std::uniform_real_distribution<Real> pdf(0,1);
+  for (auto& v : fdata) {
+    v = 100*pdf(engine);
+  }
+  for (int icol=0; icol<ncols; ++icol) {
+    lat_data[icol]  = -90 + 180*pdf(engine);
+    lon_data[icol]  = 360*pdf(engine);
+    area_data[icol] = 1 + pdf(engine);
+    mask.data_nonconst<int>()[icol] = icol % nregions;
+    col_gids.data_nonconst<int>()[icol] = icol+1;
+  }
+  for (int p=0; p<nparts; ++p) {
+    f.copy_part_data(p, fdata.data()+p*pcols*nlevs);
+    lat.copy_part_data(p, lat_data.data()+p*pcols);
+    lon.copy_part_data(p, lon_data.data()+p*pcols);
+    area.copy_part_data(p, area_data.data()+p*pcols);
+  }
+
+  auto& factory = StatFactory::instance();
+  auto create_stat = [&](const std::string& type, ekat::ParameterList pl) {
+    pl.set<std::string>("type",type);
+    auto stat = factory.create(type,comm,pl);
+    stat->set_field(f);
+    std::map<std::string,Field> aux = {
+      {"lat",lat}, {"lon",lon}, {"area",area}, {"mask",mask}, {"col_gids",col_gids}
+    };
+    stat->set_aux_fields(aux);
+    stat->create_stat_field();
+    return stat;
+  };
+
+  const Bounds<Real> lat_bounds (-30,30);
+  const Bounds<Real> lon_bounds (0,180);
+
+  std::map<std::string,std::shared_ptr<FieldStat>> stats;
+  stats["global_sum"] = create_stat("global_sum",ekat::ParameterList("global_sum"));
+  stats["global_max"] = create_stat("global_max",ekat::ParameterList("global_max"));
+  stats["global_min"] = create_stat("global_min",ekat::ParameterList("global_min"));
+  stats["sum_along_columns"] = create_stat("sum_along_columns",ekat::ParameterList("sum_along_columns"));
+  stats["max_along_columns"] = create_stat("max_along_columns",ekat::ParameterList("max_along_columns"));
+  {
+    ekat::ParameterList pl("zonal_mean");
+    pl.set("Latitude Bounds",lat_bounds.to_vector());
+    stats["zonal_mean"] = create_stat("zonal_mean",pl);
+  }
+  {
+    ekat::ParameterList pl("bounding_box");
+    pl.set("Latitude Bounds",lat_bounds.to_vector());
+    pl.set("Longitude Bounds",lon_bounds.to_vector());
+    stats["bounding_box"] = create_stat("bounding_box",pl);
+  }
+  {
+    ekat::ParameterList pl("vertical_contraction");
+    pl.set<std::vector<int>>("level_bounds",{0,nlevs-1});
+    stats["vertical_contraction"] = create_stat("vertical_contraction",pl);
+  }
+  {
+    ekat::ParameterList pl("masked_integral");
+    pl.set<std::string>("mask_field","mask");
+    pl.set("average",false);
+    stats["masked_integral"] = create_stat("masked_integral",pl);
+  }
+
+  auto get_data = [](const Field& s) {
+    const int n = s.layout().size();
+    const Real* data = s.data<Real>();
+    return std::vector<Real>(data,data+n);
+  };
+
+  SECTION ("correctness") {
+    // Compute serial results
+    KahanSum<Real> sum;
+    Real max = fdata[0], min = fdata[0];
+    std::vector<KahanSum<Real>> col_sum(nlevs), zonal(nlevs);
+    std::vector<Real> col_max(nlevs,fdata[0]);
+    std::vector<Real> vert_avg(ncols,0);
+    std::vector<Real> masked(nregions*nlevs,0);
+    KahanSum<Real> zonal_area;
+    for (int icol=0; icol<ncols; ++icol) {
+      const bool in_zone = lat_bounds.contains(lat_data[icol],true,true);
+      if (in_zone) {
+        zonal_area += area_data[icol];
+      }
+      for (int ilev=0; ilev<nlevs; ++ilev) {
+        const Real v = fdata[icol*nlevs+ilev];
+        sum += v;
+        max = std::max(max,v);
+        min = std::min(min,v);
+        col_sum[ilev] += v;
+        col_max[ilev] = std::max(col_max[ilev],v);
+        vert_avg[icol] += v;
+        masked[(icol % nregions)*nlevs+ilev] += v;
+        if (in_zone) {
+          zonal[ilev] += v*area_data[icol];
+        }
+      }
+      vert_avg[icol] /= nlevs;
+    }
+
+    // Compute stats twice: results must match bitwise
+    for (auto& it : stats) {
+      const auto& name = it.first;
+      auto& stat = it.second;
+
+      auto out = get_data(stat->compute(time));
+      REQUIRE (out==get_data(stat->compute(time)));
+
+      if (name=="global_sum") {
+        REQUIRE (out[0]==Approx(sum.sum).epsilon(1e-12));
+      } else if (name=="global_max") {
+        REQUIRE (out[0]==max);
+      } else if (name=="global_min") {
+        REQUIRE (out[0]==min);
+      } else if (name=="sum_along_columns") {
+        for (int ilev=0; ilev<nlevs; ++ilev) {
+          REQUIRE (out[ilev]==Approx(col_sum[ilev].sum).epsilon(1e-12));
+        }
+      } else if (name=="max_along_columns") {
+        REQUIRE (out==col_max);
+      } else if (name=="zonal_mean") {
+        for (int ilev=0; ilev<nlevs; ++ilev) {
+          REQUIRE (out[ilev]==Approx(zonal[ilev].sum/zonal_area.sum).epsilon(1e-12));
+        }
+      } else if (name=="bounding_box") {
+        for (int icol=0; icol<ncols; ++icol) {
+          if (lat_bounds.contains(lat_data[icol]) and lon_bounds.contains(lon_data[icol])) {
+            for (int ilev=0; ilev<nlevs; ++ilev) {
+              REQUIRE (out[icol*nlevs+ilev]==fdata[icol*nlevs+ilev]);
+            }
+          }
+        }
+      } else if (name=="vertical_contraction") {
+        // Each column is summed serially, so results must match bitwise
+        REQUIRE (out==vert_avg);
+      } else if (name=="masked_integral") {
+        for (int i=0; i<nregions*nlevs; ++i) {
+          REQUIRE (out[i]==Approx(masked[i]).epsilon(1e-12));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE ("compensated_sums") {
+  using namespace cldera;
+
+  // Ill-conditioned data: large values of alternating sign, plus small ones
+  constexpr int n = 100003;
+  std::vector<Real> x(n);
+  std::mt19937_64 engine(Catch::rngSeed());
+  std::uniform_real_distribution<Real> pdf(0,1);
+  for (int i=0; i<n; ++i) {
+    x[i] = (i%2==0 ? 1e10 : -1e10)*(1+pdf(engine)) + pdf(engine);
+  }
+
+  // Correctly rounded sum (Shewchuk's algorithm, with exact partial sums)
+  auto exact_sum = [](const std::vector<Real>& v) {
+    std::vector<Real> partials;
+    for (Real val : v) {
+      int i = 0;
+      for (Real p : partials) {
+        if (std::abs(val)<std::abs(p)) {
+          std::swap(val,p);
+        }
+        const Real hi = val + p;
+        const Real lo = p - (hi - val);
+        if (lo!=0) {
+          partials[i++] = lo;
+        }
+        val = hi;
+      }
+      partials.resize(i);
+      partials.push_back(val);
+    }
+    Real sum = 0;
+    for (auto p : partials) {
+      sum += p;
+    }
+    return sum;
+  };
+
+  // Reference: scalar Kahan sum, and the exact sum
+  KahanSum<Real> scalar;
+  Real abs_sum = 0;
+  for (auto v : x) {
+    scalar += v;
+    abs_sum += std::abs(v);
+  }
+  const Real exact = exact_sum(x);
+
+  // The lane-parallel sum has the same error bound as the scalar Kahan sum,
+  // that is, (2u + O(n*u^2))*sum|x_i|
+  LaneKahanSum<Real> lanes;
+  lanes.add(x.data(),n);
+  const Real lane_sum = lanes.reduce().sum;
+  const Real u = std::numeric_limits<Real>::epsilon() / 2;
+  const Real bound = (2*u + n*u*u)*abs_sum;
+  REQUIRE (std::abs(lane_sum - exact) <= bound);
+  REQUIRE (std::abs(scalar.sum - exact) <= bound);
+  REQUIRE (std::abs(lane_sum - scalar.sum) <= 2*bound);
+
+  // Splitting the data in several calls gives a result within the same bound
+  LaneKahanSum<Real> split;
+  split.add(x.data(),n/3);
+  split.add(x.data()+n/3,n-n/3);
+  REQUIRE (std::abs(split.reduce().sum - exact) <= bound);
+
+  // Weighted sum, skipping entries with 0 weight (even if they are NaN)
+  std::vector<Real> w(n), wx;
+  for (int i=0; i<n; ++i) {
+    w[i] = i%3==0 ? 0 : 0.5;
+    if (w[i]==0) {
+      x[i] = std::numeric_limits<Real>::quiet_NaN();
+    } else {
+      wx.push_back(x[i]*w[i]);
+    }
+  }
+  LaneKahanSum<Real> w_lanes;
+  w_lanes.add(x.data(),w.data(),n);
+  REQUIRE (std::abs(w_lanes.reduce().sum - exact_sum(wx)) <= bound);
+
+  // Updating many accumulators at once gives the same result as the scalar Kahan sum
+  constexpr int m = 37;
+  std::vector<KahanSum<Real>> acc(m), acc_ref(m);
+  std::vector<char> mask(m);
+  for (int j=0; j<m; ++j) {
+    mask[j] = j%4!=0;
+  }
+  for (int i=1; i+m<=n; i+=3*m) {
+    compensated_add(acc.data(),x.data()+i,m,0.5,mask.data());
+    for (int j=0; j<m; ++j) {
+      if (mask[j]) {
+        acc_ref[j] += x[i+j]*0.5;
+      }
+    }
+  }
+  for (int j=0; j<m; ++j) {
+    REQUIRE (acc[j].sum==acc_ref[j].sum);
+  }
+
+  // Integer sums are exact
+  std::vector<int> xi(n);
+  long long exact_i = 0;
+  for (int i=0; i<n; ++i) {
+    xi[i] = (i*7919) % 1000 - 500;
+    exact_i += xi[i];
+  }
+  LaneKahanSum<int> lanes_i;
+  lanes_i.add(xi.data(),n);
+  REQUIRE (lanes_i.reduce().sum==exact_i);
+}